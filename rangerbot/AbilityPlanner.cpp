@@ -0,0 +1,205 @@
+
+#include "AbilityPlanner.h"
+
+#include <algorithm>
+
+using std::vector;
+
+void AbilityPlanner::plan(const vector<Ally> &allies, const vector<Enemy> &enemies, int rows, int cols,
+                          const vector<bool> &passable, SplashGrid &splash, vector<Action> &actions) {
+  actions.clear();
+  m_rows = rows;
+  m_cols = cols;
+  m_threats.clear();
+  for (const Enemy &enemy : enemies) {
+    m_threats.push_back(ThreatMap::Threat{enemy.x, enemy.y, enemy.damage, enemy.attack_range_sq});
+  }
+  // everyone has already moved by now
+  m_danger.compute(m_threats, rows, cols, false);
+
+  m_occupied.assign(static_cast<size_t>(rows * cols), false);
+  m_ally_index.reset(rows, cols);
+  for (unsigned int i = 0; i < allies.size(); ++i) {
+    m_ally_index.insert(allies[i].x, allies[i].y, i);
+    m_occupied[allies[i].y * cols + allies[i].x] = true;
+  }
+  m_ally_index.build();
+  m_enemy_index.reset(rows, cols);
+  for (unsigned int i = 0; i < enemies.size(); ++i) {
+    m_enemy_index.insert(enemies[i].x, enemies[i].y, i);
+    m_occupied[enemies[i].y * cols + enemies[i].x] = true;
+  }
+  m_enemy_index.build();
+
+  planOvercharge(allies, actions);
+  planJavelin(allies, enemies, actions);
+  planBlink(allies, passable, splash, actions);
+  planRestore(allies, Role::Healer, Ability::Heal, actions);
+  planRestore(allies, Role::Worker, Ability::Repair, actions);
+}
+
+void AbilityPlanner::planOvercharge(const vector<Ally> &allies, vector<Action> &actions) {
+  // overcharge resets the target's heat, so it's only worth it on something that already fired and can fire again
+  m_candidates.clear();
+  for (unsigned int healer = 0; healer < allies.size(); ++healer) {
+    const Ally &h = allies[healer];
+    if (h.role != Role::Healer || !h.ability_ready) {
+      continue;
+    }
+    m_ally_index.forEachWithin(h.x, h.y, h.ability_range_sq, [&](unsigned int target, unsigned int) {
+      const Ally &t = allies[target];
+      if (t.role == Role::Healer || t.role == Role::Worker || t.role == Role::Structure || t.attack_ready ||
+          t.damage <= 0) {
+        return;
+      }
+      bool has_enemy_in_range = false;
+      m_enemy_index.forEachWithin(t.x, t.y, t.attack_range_sq, [&](unsigned int, unsigned int) {
+        has_enemy_in_range = true;
+      });
+      if (has_enemy_in_range) {
+        m_candidates.push_back(Candidate{t.damage, healer, target});
+      }
+    });
+  }
+  std::stable_sort(m_candidates.begin(), m_candidates.end(),
+                   [](const Candidate &a, const Candidate &b) { return a.value > b.value; });
+
+  m_unit_used.assign(allies.size(), false);
+  m_target_used.assign(allies.size(), false);
+  for (const Candidate &candidate : m_candidates) {
+    if (m_unit_used[candidate.unit] || m_target_used[candidate.target]) {
+      continue;
+    }
+    m_unit_used[candidate.unit] = true;
+    m_target_used[candidate.target] = true;
+    actions.push_back(Action{Ability::Overcharge, allies[candidate.unit].id, allies[candidate.target].id, 0, 0});
+  }
+}
+
+void AbilityPlanner::planJavelin(const vector<Ally> &allies, const vector<Enemy> &enemies, vector<Action> &actions) {
+  m_remaining.resize(enemies.size());
+  for (unsigned int i = 0; i < enemies.size(); ++i) {
+    m_remaining[i] = enemies[i].health;
+  }
+  for (const Ally &knight : allies) {
+    if (knight.role != Role::Knight || !knight.ability_ready) {
+      continue;
+    }
+    int best_value = 0;
+    int best_target = -1;
+    int best_damage = 0;
+    m_enemy_index.forEachWithin(knight.x, knight.y, knight.ability_range_sq, [&](unsigned int target, unsigned int) {
+      const Enemy &enemy = enemies[target];
+      const int damage = std::max(knight.damage - enemy.defense, 0);
+      if (m_remaining[target] <= 0 || damage == 0) {
+        return;
+      }
+      // kills first, then whatever hits us hardest
+      int value = std::min(damage, m_remaining[target]) + enemy.damage;
+      if (damage >= m_remaining[target]) {
+        value += 1000;
+      }
+      if (value > best_value) {
+        best_value = value;
+        best_target = target;
+        best_damage = damage;
+      }
+    });
+    if (best_target >= 0) {
+      m_remaining[best_target] -= best_damage;
+      actions.push_back(Action{Ability::Javelin, knight.id, enemies[best_target].id, 0, 0});
+    }
+  }
+}
+
+void AbilityPlanner::planBlink(const vector<Ally> &allies, const vector<bool> &passable, SplashGrid &splash,
+                               vector<Action> &actions) {
+  // only mages that couldn't find anything to hit where they stand
+  for (const Ally &mage : allies) {
+    if (mage.role != Role::Mage || !mage.ability_ready || !mage.attack_ready) {
+      continue;
+    }
+    int reach = 0;
+    while (static_cast<unsigned int>(reach * reach) < mage.ability_range_sq) {
+      ++reach;
+    }
+    float best_score = 0.0f;
+    int best_x = -1, best_y = -1, best_target_x = -1, best_target_y = -1;
+    for (int y = std::max(mage.y - reach, 0); y <= std::min(mage.y + reach, m_rows - 1); ++y) {
+      for (int x = std::max(mage.x - reach, 0); x <= std::min(mage.x + reach, m_cols - 1); ++x) {
+        const int i = y * m_cols + x;
+        const int dx = x - mage.x;
+        const int dy = y - mage.y;
+        if (!passable[i] || m_occupied[i] ||
+            static_cast<unsigned int>(dx * dx + dy * dy) > mage.ability_range_sq) {
+          continue;
+        }
+        int target_x, target_y;
+        if (!splash.bestTargetInRange(x, y, mage.attack_range_sq, target_x, target_y)) {
+          continue;
+        }
+        // splash value and danger are both in health
+        const float score = splash.valueAt(target_x, target_y) - m_danger.at(x, y);
+        if (score > best_score) {
+          best_score = score;
+          best_x = x;
+          best_y = y;
+          best_target_x = target_x;
+          best_target_y = target_y;
+        }
+      }
+    }
+    if (best_x < 0) {
+      continue;
+    }
+    m_occupied[mage.y * m_cols + mage.x] = false;
+    m_occupied[best_y * m_cols + best_x] = true;
+    actions.push_back(Action{Ability::Blink, mage.id, splash.enemyAt(best_target_x, best_target_y), best_x, best_y});
+    splash.applySplash(best_target_x, best_target_y);
+  }
+}
+
+void AbilityPlanner::planRestore(const vector<Ally> &allies, Role restorer, Ability ability,
+                                 vector<Action> &actions) {
+  // workers repair adjacent structures, healers heal robots in attack range
+  const unsigned int repair_range_sq = 2;
+  m_candidates.clear();
+  for (unsigned int unit = 0; unit < allies.size(); ++unit) {
+    const Ally &u = allies[unit];
+    if (u.role != restorer || u.restore <= 0) {
+      continue;
+    }
+    const bool ready = restorer == Role::Healer ? u.attack_ready : u.can_act;
+    if (!ready) {
+      continue;
+    }
+    const unsigned int range_sq = restorer == Role::Healer ? u.attack_range_sq : repair_range_sq;
+    m_ally_index.forEachWithin(u.x, u.y, range_sq, [&](unsigned int target, unsigned int) {
+      const Ally &t = allies[target];
+      const bool is_structure = t.role == Role::Structure;
+      if (t.health >= t.max_health || (restorer == Role::Healer ? is_structure : !is_structure || !t.can_act)) {
+        return;
+      }
+      // whatever is about to get shot needs it most
+      int value = std::min(t.max_health - t.health, u.restore) + m_danger.at(t.x, t.y);
+      m_candidates.push_back(Candidate{value, unit, target});
+    });
+  }
+  std::stable_sort(m_candidates.begin(), m_candidates.end(),
+                   [](const Candidate &a, const Candidate &b) { return a.value > b.value; });
+
+  m_unit_used.assign(allies.size(), false);
+  m_remaining.resize(allies.size());
+  for (unsigned int i = 0; i < allies.size(); ++i) {
+    m_remaining[i] = allies[i].max_health - allies[i].health;
+  }
+  for (const Candidate &candidate : m_candidates) {
+    // several restorers can share a target, as long as none of it goes to waste
+    if (m_unit_used[candidate.unit] || m_remaining[candidate.target] <= 0) {
+      continue;
+    }
+    m_unit_used[candidate.unit] = true;
+    m_remaining[candidate.target] -= allies[candidate.unit].restore;
+    actions.push_back(Action{ability, allies[candidate.unit].id, allies[candidate.target].id, 0, 0});
+  }
+}
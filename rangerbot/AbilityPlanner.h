@@ -0,0 +1,105 @@
+#ifndef RANGERBOT_ABILITYPLANNER_H
+#define RANGERBOT_ABILITYPLANNER_H
+
+#include <vector>
+
+#include "SpatialIndex.h"
+#include "SplashGrid.h"
+#include "ThreatMap.h"
+
+/*
+ * Decides every ability use (plus heals and repairs) for the turn at once, so two healers don't overcharge the same
+ * ranger, two knights don't javelin something that's already dead, and heals go to whoever is most likely to be shot
+ * next. Works from plain snapshots of the units, like FocusFireSolver, and is run after the normal attacks so
+ * overcharge can go to units that have already fired.
+ */
+class AbilityPlanner {
+ public:
+  enum class Role {Worker, Knight, Ranger, Mage, Healer, Structure};
+
+  // in the order the actions get issued
+  enum class Ability {Overcharge, Javelin, Blink, Heal, Repair};
+
+  struct Ally {
+    unsigned int id;
+    Role role;
+    int x;
+    int y;
+    int health;
+    int max_health;
+    int damage;
+    // health restored by a heal (healers) or a repair (workers)
+    int restore;
+    unsigned int attack_range_sq;
+    unsigned int ability_range_sq;
+    // attack (or heal) heat is low enough
+    bool attack_ready;
+    // ability is researched and its heat is low enough
+    bool ability_ready;
+    // workers: hasn't harvested, built or repaired yet. structures: finished building.
+    bool can_act;
+  };
+
+  struct Enemy {
+    unsigned int id;
+    int x;
+    int y;
+    int health;
+    int damage;
+    unsigned int attack_range_sq;
+    int defense;
+  };
+
+  struct Action {
+    Ability ability;
+    unsigned int unit_id;
+    unsigned int target_id;
+    // blink destination
+    int x;
+    int y;
+  };
+
+  /*
+   * Fills actions, in priority order. passable is row-major, like MapPreprocessor::passable(). Blinking mages come
+   * with a target to attack from their new tile, which is recorded in splash.
+   */
+  void plan(const std::vector<Ally> &allies, const std::vector<Enemy> &enemies, int rows, int cols,
+            const std::vector<bool> &passable, SplashGrid &splash, std::vector<Action> &actions);
+
+  /*
+   * Total damage the enemies could do to (x, y) this round, as of the last plan().
+   */
+  int dangerAt(int x, int y) const { return m_danger.at(x, y); }
+
+ private:
+  void planOvercharge(const std::vector<Ally> &allies, std::vector<Action> &actions);
+
+  void planJavelin(const std::vector<Ally> &allies, const std::vector<Enemy> &enemies, std::vector<Action> &actions);
+
+  void planBlink(const std::vector<Ally> &allies, const std::vector<bool> &passable, SplashGrid &splash,
+                 std::vector<Action> &actions);
+
+  void planRestore(const std::vector<Ally> &allies, Role restorer, Ability ability, std::vector<Action> &actions);
+
+  struct Candidate {
+    int value;
+    unsigned int unit;
+    unsigned int target;
+  };
+
+  int m_rows = 0;
+  int m_cols = 0;
+  ThreatMap m_danger;
+  std::vector<ThreatMap::Threat> m_threats;
+  std::vector<bool> m_occupied;
+  SpatialIndex m_ally_index;
+  SpatialIndex m_enemy_index;
+  // scratch
+  std::vector<Candidate> m_candidates;
+  std::vector<bool> m_unit_used;
+  std::vector<bool> m_target_used;
+  std::vector<int> m_remaining;
+};
+
+
+#endif //RANGERBOT_ABILITYPLANNER_H
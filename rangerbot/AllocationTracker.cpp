@@ -0,0 +1,273 @@
+
+#include "AllocationTracker.h"
+
+#ifdef RANGERBOT_TRACK_ALLOCATIONS
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <dlfcn.h>
+#include <execinfo.h>
+#ifdef __APPLE__
+#  include <malloc/malloc.h>
+#else
+#  include <malloc.h>
+#endif
+
+#include "Debug.h"
+
+using std::endl;
+
+AllocationStats allocation_totals;
+
+namespace {
+
+// players get 256MB. warn well before that.
+const uint64_t memory_limit_bytes = 256ull << 20;
+const uint64_t memory_warning_bytes = memory_limit_bytes / 4 * 3;
+
+// the report lists this many of the call sites that allocated the most bytes
+const int num_top_sites = 20;
+
+struct CallSite {
+  const void *address;
+  uint64_t allocations;
+  uint64_t bytes;
+};
+
+// open addressing, so recording a site never allocates. sites past this many aren't counted by site.
+const int max_call_sites = 1 << 12;
+CallSite call_sites[max_call_sites];
+uint64_t untracked_site_bytes = 0;
+
+// how far up the stack to look for the first frame that isn't the standard library's
+const int max_site_frames = 16;
+
+struct Frame {
+  const void *address;
+  bool is_library;
+};
+
+// dladdr() is too slow to call on every allocation, so remember what each return address turned out to be
+const int max_frames = 1 << 12;
+Frame frames[max_frames];
+bool walking_stack = false;
+
+AllocationStats turn_start;
+uint64_t turn_peak_live_bytes = 0;
+
+FILE *report_file = nullptr;
+
+size_t usableSize(void *pointer) {
+#ifdef __APPLE__
+  return malloc_size(pointer);
+#else
+  return malloc_usable_size(pointer);
+#endif
+}
+
+size_t slotOf(const void *address) {
+  return (reinterpret_cast<uintptr_t>(address) >> 2) * 0x9E3779B97F4A7C15ull >> 52;
+}
+
+bool startsWith(const char *name, const char *prefix) {
+  return strncmp(name, prefix, strlen(prefix)) == 0;
+}
+
+/*
+ * Whether a return address is inside libstdc++, or inside a std:: template that got instantiated in our own code.
+ * Names only resolve for functions in the dynamic symbol table, so link with -rdynamic.
+ */
+bool isLibraryFrame(const void *address) {
+  size_t slot = slotOf(address);
+  for (int probes = 0; probes < max_frames; ++probes, slot = (slot + 1) % max_frames) {
+    Frame &frame = frames[slot];
+    if (frame.address == address) {
+      return frame.is_library;
+    }
+    if (frame.address == nullptr) {
+      break;
+    }
+  }
+
+  Dl_info info;
+  bool is_library = false;
+  if (dladdr(address, &info) != 0) {
+    const char *prefixes[] = {"_ZNSt", "_ZNKSt", "_ZSt", "_ZNSa", "_ZNKSa", "_ZNSs", "_ZNKSs", "_ZN9__gnu_cxx",
+                              "_ZNK9__gnu_cxx"};
+    is_library = info.dli_fname != nullptr && strstr(info.dli_fname, "libstdc++") != nullptr;
+    for (const char *prefix : prefixes) {
+      is_library = is_library || (info.dli_sname != nullptr && startsWith(info.dli_sname, prefix));
+    }
+  }
+  if (frames[slot].address == nullptr) {
+    frames[slot] = Frame{address, is_library};
+  }
+  return is_library;
+}
+
+/*
+ * The first return address above operator new that isn't the standard library's. Containers allocate through layers of
+ * allocator and container templates, which only get inlined with optimization on. Without this walk, a debug build
+ * (debug=1 in run.sh) would report every container allocation at new_allocator<T>::allocate.
+ */
+__attribute__((always_inline)) inline const void *callSite() {
+  // backtrace() can allocate the first time it's called, while it loads the unwinder
+  if (walking_stack) {
+    return __builtin_return_address(0);
+  }
+  walking_stack = true;
+  void *stack[max_site_frames];
+  const int depth = backtrace(stack, max_site_frames);
+  walking_stack = false;
+  // stack[0] is operator new itself, since this is inlined into it
+  for (int i = 1; i < depth; ++i) {
+    if (!isLibraryFrame(stack[i])) {
+      return stack[i];
+    }
+  }
+  return __builtin_return_address(0);
+}
+
+void recordSite(const void *address, size_t size) {
+  size_t slot = slotOf(address);
+  for (int probes = 0; probes < max_call_sites; ++probes, slot = (slot + 1) % max_call_sites) {
+    CallSite &site = call_sites[slot];
+    if (site.address == address || site.address == nullptr) {
+      site.address = address;
+      ++site.allocations;
+      site.bytes += size;
+      return;
+    }
+  }
+  untracked_site_bytes += size;
+}
+
+void *allocate(size_t size, const void *caller) {
+  void *pointer = malloc(size == 0 ? 1 : size);
+  if (pointer == nullptr) {
+    // we build without exceptions, so there's no bad_alloc to throw
+    abort();
+  }
+  const size_t usable = usableSize(pointer);
+  ++allocation_totals.allocations;
+  allocation_totals.bytes += usable;
+  allocation_totals.live_bytes += usable;
+  turn_peak_live_bytes = std::max(turn_peak_live_bytes, allocation_totals.live_bytes);
+  allocation_totals.peak_live_bytes = std::max(allocation_totals.peak_live_bytes, allocation_totals.live_bytes);
+  recordSite(caller, usable);
+  return pointer;
+}
+
+void deallocate(void *pointer) {
+  if (pointer == nullptr) {
+    return;
+  }
+  allocation_totals.live_bytes -= usableSize(pointer);
+  free(pointer);
+}
+
+double megabytes(uint64_t bytes) {
+  return bytes / static_cast<double>(1 << 20);
+}
+
+}
+
+void *operator new(size_t size) {
+  return allocate(size, callSite());
+}
+
+void *operator new[](size_t size) {
+  return allocate(size, callSite());
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return allocate(size, callSite());
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return allocate(size, callSite());
+}
+
+void operator delete(void *pointer) noexcept {
+  deallocate(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+  deallocate(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+  deallocate(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept {
+  deallocate(pointer);
+}
+
+void allocation_open_report(const char *path) {
+  if (report_file != nullptr) {
+    fclose(report_file);
+  }
+  report_file = fopen(path, "w");
+  if (report_file != nullptr) {
+    fprintf(report_file, "round,allocations,bytes,live_mb,peak_live_mb\n");
+  }
+  turn_start = allocation_totals;
+  turn_peak_live_bytes = allocation_totals.live_bytes;
+}
+
+void allocation_end_turn(unsigned int round) {
+  if (report_file != nullptr) {
+    fprintf(report_file, "%u,%llu,%llu,%.2f,%.2f\n", round,
+            static_cast<unsigned long long>(allocation_totals.allocations - turn_start.allocations),
+            static_cast<unsigned long long>(allocation_totals.bytes - turn_start.bytes),
+            megabytes(allocation_totals.live_bytes), megabytes(turn_peak_live_bytes));
+  }
+  if (turn_peak_live_bytes > memory_warning_bytes) {
+    LOG("WARNING: " << megabytes(turn_peak_live_bytes) << "MB live this turn, the limit is "
+                    << megabytes(memory_limit_bytes) << "MB" << endl);
+    if (report_file != nullptr) {
+      fprintf(report_file, "# warning: %.2fMB live in round %u\n", megabytes(turn_peak_live_bytes), round);
+    }
+  }
+  turn_start = allocation_totals;
+  turn_peak_live_bytes = allocation_totals.live_bytes;
+}
+
+void allocation_write_report() {
+  if (report_file == nullptr) {
+    return;
+  }
+  // sort a copy, so the table can keep counting while we do
+  static CallSite top[max_call_sites];
+  std::copy(call_sites, call_sites + max_call_sites, top);
+  const int num_sites = std::min(num_top_sites, max_call_sites);
+  std::partial_sort(top, top + num_sites, top + max_call_sites, [](const CallSite &a, const CallSite &b) {
+    return a.bytes > b.bytes;
+  });
+
+  fprintf(report_file, "# %llu allocations, %.2fMB allocated, peak %.2fMB live\n",
+          static_cast<unsigned long long>(allocation_totals.allocations), megabytes(allocation_totals.bytes),
+          megabytes(allocation_totals.peak_live_bytes));
+  fprintf(report_file, "# top call sites by bytes, as module+offset for addr2line -f -i -C -e <module> <offset>\n");
+  for (int i = 0; i < num_sites && top[i].address != nullptr; ++i) {
+    Dl_info info;
+    const bool found = dladdr(top[i].address, &info) != 0 && info.dli_fname != nullptr;
+    // the return address is just past the call, so step back into it
+    const uintptr_t offset = reinterpret_cast<uintptr_t>(top[i].address) - 1 -
+                             (found ? reinterpret_cast<uintptr_t>(info.dli_fbase) : 0);
+    fprintf(report_file, "# %s+0x%llx %s: %llu allocations, %.2fMB\n", found ? info.dli_fname : "?",
+            static_cast<unsigned long long>(offset), found && info.dli_sname != nullptr ? info.dli_sname : "",
+            static_cast<unsigned long long>(top[i].allocations), megabytes(top[i].bytes));
+  }
+  if (untracked_site_bytes > 0) {
+    fprintf(report_file, "# %.2fMB from sites that didn't fit in the table\n", megabytes(untracked_site_bytes));
+  }
+  fflush(report_file);
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef RANGERBOT_ALLOCATIONTRACKER_H
+#define RANGERBOT_ALLOCATIONTRACKER_H
+
+#include <cstdint>
+
+/*
+ * Opt-in accounting of everything allocated with operator new. Build with -DRANGERBOT_TRACK_ALLOCATIONS
+ * (track_allocations=1 in run.sh) to replace the global operator new and delete with versions that count allocations,
+ * bytes and live memory, and remember which call sites allocate the most. Without it, none of this is compiled in and
+ * the functions below do nothing.
+ *
+ * allocation_end_turn() writes a line per turn to the report and warns when live memory gets near the player memory
+ * limit. allocation_write_report() adds the top call sites, as addresses for addr2line. A call site is the first frame
+ * above operator new that isn't in the standard library, which needs -rdynamic to tell the frames apart. Profiler spans
+ * also count the allocations made inside them.
+ *
+ * Only memory from operator new is counted, so malloc inside the engine's library isn't. The bot allocates from one
+ * thread, so the counters aren't atomic.
+ */
+
+struct AllocationStats {
+  uint64_t allocations = 0;
+  uint64_t bytes = 0;
+  uint64_t live_bytes = 0;
+  uint64_t peak_live_bytes = 0;
+};
+
+#ifdef RANGERBOT_TRACK_ALLOCATIONS
+
+// since the start of the game
+extern AllocationStats allocation_totals;
+
+void allocation_open_report(const char *path);
+
+void allocation_end_turn(unsigned int round);
+
+void allocation_write_report();
+
+#else
+
+inline void allocation_open_report(const char *) {}
+
+inline void allocation_end_turn(unsigned int) {}
+
+inline void allocation_write_report() {}
+
+#endif
+
+#endif //RANGERBOT_ALLOCATIONTRACKER_H
@@ -0,0 +1,175 @@
+
+#include "CombatSimulator.h"
+
+#include <algorithm>
+#include <limits>
+
+using std::vector;
+
+namespace {
+// heat is lost at this rate every round, and units can only act below it
+const float heat_per_round = 10.0f;
+const float infinite_dist = std::numeric_limits<float>::max();
+}
+
+void CombatTeam::clear() {
+  x.clear();
+  y.clear();
+  health.clear();
+  damage.clear();
+  range_sq.clear();
+  min_range_sq.clear();
+  defense.clear();
+  attack_cooldown.clear();
+  attack_heat.clear();
+  movement_cooldown.clear();
+  movement_heat.clear();
+}
+
+void CombatTeam::add(float unit_x, float unit_y, float unit_health, float unit_damage, float unit_range_sq,
+                     float unit_min_range_sq, float unit_defense, float unit_attack_cooldown, float unit_attack_heat,
+                     float unit_movement_cooldown, float unit_movement_heat) {
+  x.push_back(unit_x);
+  y.push_back(unit_y);
+  health.push_back(unit_health);
+  damage.push_back(unit_damage);
+  range_sq.push_back(unit_range_sq);
+  min_range_sq.push_back(unit_min_range_sq);
+  defense.push_back(unit_defense);
+  attack_cooldown.push_back(unit_attack_cooldown);
+  attack_heat.push_back(unit_attack_heat);
+  movement_cooldown.push_back(unit_movement_cooldown);
+  movement_heat.push_back(unit_movement_heat);
+}
+
+float CombatSimulator::simulate(const CombatTeam &ours, const CombatTeam &theirs, Stance our_stance, int rounds) {
+  m_ours = ours;
+  m_theirs = theirs;
+
+  float dealt = 0.0f;
+  float taken = 0.0f;
+  for (int round = 0; round < rounds; ++round) {
+    // same order as the real game: move, then shoot with the new positions
+    if (our_stance == Stance::Advance) {
+      move(m_ours, m_theirs, 1.0f);
+    } else if (our_stance == Stance::Retreat) {
+      move(m_ours, m_theirs, -1.0f);
+    }
+    move(m_theirs, m_ours, 1.0f);
+
+    // damage is applied simultaneously, so the order of the two sides doesn't matter
+    m_damage_to_theirs.assign(m_theirs.size(), 0.0f);
+    m_damage_to_ours.assign(m_ours.size(), 0.0f);
+    shoot(m_ours, m_theirs, m_damage_to_theirs);
+    shoot(m_theirs, m_ours, m_damage_to_ours);
+    dealt += applyDamage(m_theirs, m_damage_to_theirs);
+    taken += applyDamage(m_ours, m_damage_to_ours);
+  }
+  return dealt - taken;
+}
+
+Stance CombatSimulator::bestStance(const CombatTeam &ours, const CombatTeam &theirs, int rounds) {
+  Stance best_stance = Stance::Advance;
+  float best_score = simulate(ours, theirs, Stance::Advance, rounds);
+  for (const Stance &stance : {Stance::Hold, Stance::Retreat}) {
+    float score = simulate(ours, theirs, stance, rounds);
+    if (score > best_score) {
+      best_score = score;
+      best_stance = stance;
+    }
+  }
+  return best_stance;
+}
+
+void CombatSimulator::move(CombatTeam &movers, const CombatTeam &targets, float direction) {
+  const size_t num_targets = targets.size();
+  m_scratch.resize(num_targets);
+  float *dist_sq = m_scratch.data();
+  const float *target_x = targets.x.data();
+  const float *target_y = targets.y.data();
+  const float *target_health = targets.health.data();
+
+  for (size_t i = 0; i < movers.size(); ++i) {
+    if (movers.health[i] <= 0.0f) {
+      continue;
+    }
+    const float x = movers.x[i];
+    const float y = movers.y[i];
+    // branch-free, so these two loops vectorize
+    for (size_t j = 0; j < num_targets; ++j) {
+      const float dx = target_x[j] - x;
+      const float dy = target_y[j] - y;
+      dist_sq[j] = target_health[j] > 0.0f ? dx * dx + dy * dy : infinite_dist;
+    }
+    float closest = infinite_dist;
+    for (size_t j = 0; j < num_targets; ++j) {
+      closest = std::min(closest, dist_sq[j]);
+    }
+    if (closest == infinite_dist || movers.movement_heat[i] >= heat_per_round) {
+      continue;
+    }
+    const size_t j = std::find(dist_sq, dist_sq + num_targets, closest) - dist_sq;
+    // one king's move toward (or away from) the closest target
+    const float dx = target_x[j] - x;
+    const float dy = target_y[j] - y;
+    movers.x[i] += direction * static_cast<float>((dx > 0.0f) - (dx < 0.0f));
+    movers.y[i] += direction * static_cast<float>((dy > 0.0f) - (dy < 0.0f));
+    movers.movement_heat[i] += movers.movement_cooldown[i];
+  }
+
+  for (size_t i = 0; i < movers.size(); ++i) {
+    movers.movement_heat[i] = std::max(movers.movement_heat[i] - heat_per_round, 0.0f);
+  }
+}
+
+void CombatSimulator::shoot(CombatTeam &shooters, const CombatTeam &targets, vector<float> &incoming_damage) {
+  const size_t num_targets = targets.size();
+  m_scratch.resize(num_targets);
+  float *key = m_scratch.data();
+  const float *target_x = targets.x.data();
+  const float *target_y = targets.y.data();
+  const float *target_health = targets.health.data();
+
+  for (size_t i = 0; i < shooters.size(); ++i) {
+    if (shooters.health[i] <= 0.0f || shooters.damage[i] <= 0.0f || shooters.attack_heat[i] >= heat_per_round) {
+      continue;
+    }
+    const float x = shooters.x[i];
+    const float y = shooters.y[i];
+    const float max_range = shooters.range_sq[i];
+    const float min_range = shooters.min_range_sq[i];
+    // the weakest living target in range has the smallest key
+    for (size_t j = 0; j < num_targets; ++j) {
+      const float dx = target_x[j] - x;
+      const float dy = target_y[j] - y;
+      const float d2 = dx * dx + dy * dy;
+      const bool valid = target_health[j] > 0.0f && d2 <= max_range && d2 > min_range;
+      key[j] = valid ? target_health[j] : infinite_dist;
+    }
+    float weakest = infinite_dist;
+    for (size_t j = 0; j < num_targets; ++j) {
+      weakest = std::min(weakest, key[j]);
+    }
+    if (weakest == infinite_dist) {
+      continue;
+    }
+    const size_t j = std::find(key, key + num_targets, weakest) - key;
+    incoming_damage[j] += std::max(shooters.damage[i] - targets.defense[j], 0.0f);
+    shooters.attack_heat[i] += shooters.attack_cooldown[i];
+  }
+
+  for (size_t i = 0; i < shooters.size(); ++i) {
+    shooters.attack_heat[i] = std::max(shooters.attack_heat[i] - heat_per_round, 0.0f);
+  }
+}
+
+float CombatSimulator::applyDamage(CombatTeam &team, const vector<float> &incoming_damage) {
+  float total = 0.0f;
+  for (size_t i = 0; i < team.size(); ++i) {
+    // overkill doesn't count
+    const float dealt = std::min(incoming_damage[i], std::max(team.health[i], 0.0f));
+    team.health[i] -= dealt;
+    total += dealt;
+  }
+  return total;
+}
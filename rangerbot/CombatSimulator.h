@@ -0,0 +1,78 @@
+#ifndef RANGERBOT_COMBATSIMULATOR_H
+#define RANGERBOT_COMBATSIMULATOR_H
+
+#include <cstddef>
+#include <vector>
+
+/*
+ * What a group of our units does in a fight.
+ */
+enum class Stance {
+  Advance,
+  Hold,
+  Retreat
+};
+
+/*
+ * One side of a local engagement, stored as parallel arrays so the simulator's inner loops vectorize.
+ */
+struct CombatTeam {
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> health;
+  std::vector<float> damage;
+  std::vector<float> range_sq;
+  std::vector<float> min_range_sq;
+  std::vector<float> defense;
+  std::vector<float> attack_cooldown;
+  std::vector<float> attack_heat;
+  std::vector<float> movement_cooldown;
+  std::vector<float> movement_heat;
+
+  size_t size() const { return x.size(); }
+
+  void clear();
+
+  void add(float unit_x, float unit_y, float unit_health, float unit_damage, float unit_range_sq,
+           float unit_min_range_sq, float unit_defense, float unit_attack_cooldown, float unit_attack_heat,
+           float unit_movement_cooldown, float unit_movement_heat);
+};
+
+/*
+ * A deterministic, very rough model of a fight: no terrain, no collisions, no abilities, and everyone shoots the
+ * weakest enemy in range. It's only meant to rank a handful of options against each other, in microseconds.
+ *
+ * The enemy is assumed to always advance.
+ */
+class CombatSimulator {
+ public:
+  /*
+   * Runs the fight for the given number of rounds, with our side following the given stance, and returns damage
+   * dealt minus damage taken.
+   */
+  float simulate(const CombatTeam &ours, const CombatTeam &theirs, Stance our_stance, int rounds);
+
+  /*
+   * Tries every stance. Ties go to the earlier one in Advance, Hold, Retreat order.
+   */
+  Stance bestStance(const CombatTeam &ours, const CombatTeam &theirs, int rounds);
+
+ private:
+  // moves every unit of movers one step toward (direction = 1) or away from (direction = -1) its closest target
+  void move(CombatTeam &movers, const CombatTeam &targets, float direction);
+
+  // adds each ready shooter's shot to incoming_damage (indexed like targets), without applying it yet
+  void shoot(CombatTeam &shooters, const CombatTeam &targets, std::vector<float> &incoming_damage);
+
+  static float applyDamage(CombatTeam &team, const std::vector<float> &incoming_damage);
+
+  // scratch space, reused between simulations
+  CombatTeam m_ours;
+  CombatTeam m_theirs;
+  std::vector<float> m_damage_to_ours;
+  std::vector<float> m_damage_to_theirs;
+  std::vector<float> m_scratch;
+};
+
+
+#endif //RANGERBOT_COMBATSIMULATOR_H
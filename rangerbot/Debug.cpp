@@ -1,6 +1,8 @@
 
 #include "Debug.h"
 
+#include "TurnArena.h"
+
 using namespace bc;
 using std::cout;
 using std::endl;
@@ -30,6 +32,8 @@ void debug_print_status_update(const GameController &gc) {
   LOG(" -- Elpsd " << elapsed << "ms");
 
   LOG(" -- Karb " << gc.get_karbonite());
+  // what the turn arena held at the end of last turn, and the most it ever has
+  LOG(" -- Arena " << TurnArena::get().usedBytes() / 1024 << "/" << TurnArena::get().highWaterBytes() / 1024 << "KB");
 
 
   const auto &units = gc.get_my_units();
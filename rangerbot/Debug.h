@@ -7,10 +7,12 @@
 
 #include "bcpp_api/bc.hpp"
 
+#include "Logger.h"
+
 #ifdef NDEBUG
 #  define LOG(x)
 #else
-#  define LOG(x) do { (std::cout << x); } while(false)
+#  define LOG(x) do { static LogSite log_site(__FILE__, __LINE__); if (log_site.admit()) { LogRecord() << x; } } while(false)
 #endif
 
 void debug_print_status_update(const bc::GameController &gc);
@@ -11,9 +11,10 @@ using std::max;
 Goal DecisionMaker::computeGoal(const UnitTally &unit_tally, const MapPreprocessor &map_preprocessor) {
   Goal result = Goal().set_attack();
 
-  // just eyeballing this limit. each worker mines enough for 4 more workers, assuming enemy takes half the map.
+  // just eyeballing this limit. each worker mines enough for 4 more workers, counting only karbonite on our side of
+  // the map (plus half of the contested tiles).
   // TODO: also take into account dat sweet marz ca$h
-  if (unit_tally.getCount(UnitType::Worker) < max(6U, min(40U, map_preprocessor.totalKarbonite() / (2 * 15 * 4)))) {
+  if (unit_tally.getCount(UnitType::Worker) < max(6U, min(40U, map_preprocessor.reachableKarbonite() / (15 * 4)))) {
     result.set_build_workers();
   }
 
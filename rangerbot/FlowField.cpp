@@ -0,0 +1,201 @@
+
+#include "FlowField.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "MoveOffsets.h"
+
+using std::pair;
+using std::vector;
+
+const int FlowField::num_moves;
+const FlowField::DistType FlowField::step_cost;
+const int FlowField::block_size;
+
+void FlowField::computeDensity(const vector<uint8_t> &occupied, int rows, int cols, vector<uint8_t> &density) {
+  density.assign(static_cast<size_t>(rows * cols), 0);
+  for (int y = 0; y < rows; ++y) {
+    for (int x = 0; x < cols; ++x) {
+      if (!occupied[y * cols + x]) {
+        continue;
+      }
+      for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, rows - 1); ++ny) {
+        for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, cols - 1); ++nx) {
+          ++density[ny * cols + nx];
+        }
+      }
+    }
+  }
+}
+
+void FlowField::compute(int goal_x, int goal_y, const vector<bool> &passable, const vector<uint8_t> &density,
+                        int rows, int cols) {
+  m_rows = rows;
+  m_cols = cols;
+  m_goal_x = goal_x;
+  m_goal_y = goal_y;
+  m_density = density;
+  m_in_region.assign(static_cast<size_t>(rows * cols), true);
+  relaxRegion(passable);
+}
+
+void FlowField::updateDensity(const vector<bool> &passable, const vector<uint8_t> &density) {
+  const int block_rows = (m_rows + block_size - 1) / block_size;
+  const int block_cols = (m_cols + block_size - 1) / block_size;
+  m_dirty_blocks.assign(static_cast<size_t>(block_rows * block_cols), false);
+  bool any_dirty = false;
+  for (int y = 0; y < m_rows; ++y) {
+    for (int x = 0; x < m_cols; ++x) {
+      const int tile = y * m_cols + x;
+      if (density[tile] == m_density[tile]) {
+        continue;
+      }
+      m_density[tile] = density[tile];
+      // the neighboring blocks too, so routes can bend around the change
+      const int block_r = y / block_size;
+      const int block_c = x / block_size;
+      for (int r = std::max(block_r - 1, 0); r <= std::min(block_r + 1, block_rows - 1); ++r) {
+        for (int c = std::max(block_c - 1, 0); c <= std::min(block_c + 1, block_cols - 1); ++c) {
+          m_dirty_blocks[r * block_cols + c] = true;
+        }
+      }
+      any_dirty = true;
+    }
+  }
+  if (!any_dirty) {
+    return;
+  }
+  m_region_queue.clear();
+  for (int y = 0; y < m_rows; ++y) {
+    for (int x = 0; x < m_cols; ++x) {
+      const int tile = y * m_cols + x;
+      m_in_region[tile] = m_dirty_blocks[(y / block_size) * block_cols + x / block_size];
+      if (m_in_region[tile]) {
+        m_region_queue.push_back(tile);
+      }
+    }
+  }
+  // a tile outside the blocks whose cost came through them is stale too, and so is every tile whose cost came through
+  // that one. ties count, so this may take in a few tiles that didn't need it.
+  while (!m_region_queue.empty()) {
+    const int cur = m_region_queue.back();
+    m_region_queue.pop_back();
+    if (m_dist[cur] == infinity()) {
+      continue;
+    }
+    const int x = cur % m_cols;
+    const int y = cur / m_cols;
+    for (int move = 0; move < num_moves - 1; ++move) {
+      const int nx = x + move_dx[move];
+      const int ny = y + move_dy[move];
+      if (nx < 0 || ny < 0 || nx >= m_cols || ny >= m_rows) {
+        continue;
+      }
+      const int next = ny * m_cols + nx;
+      if (m_in_region[next] || !passable[next] || m_dist[next] != m_dist[cur] + cost(next)) {
+        continue;
+      }
+      m_in_region[next] = true;
+      m_region_queue.push_back(next);
+    }
+  }
+  relaxRegion(passable);
+}
+
+void FlowField::relaxRegion(const vector<bool> &passable) {
+  const int goal = m_goal_y * m_cols + m_goal_x;
+  auto heap_order = std::greater<pair<DistType, int>>();
+  m_dist.resize(static_cast<size_t>(m_rows * m_cols), infinity());
+  for (int tile = 0; tile < m_rows * m_cols; ++tile) {
+    if (m_in_region[tile]) {
+      m_dist[tile] = infinity();
+    }
+  }
+
+  // a min-heap, seeded with the goal and with every way in from outside the region
+  m_heap.clear();
+  for (int tile = 0; tile < m_rows * m_cols; ++tile) {
+    if (!m_in_region[tile] || !passable[tile]) {
+      continue;
+    }
+    DistType best = tile == goal ? 0 : infinity();
+    const int x = tile % m_cols;
+    const int y = tile / m_cols;
+    for (int move = 0; move < num_moves - 1; ++move) {
+      const int nx = x + move_dx[move];
+      const int ny = y + move_dy[move];
+      if (nx < 0 || ny < 0 || nx >= m_cols || ny >= m_rows) {
+        continue;
+      }
+      const int neighbor = ny * m_cols + nx;
+      if (m_in_region[neighbor] || m_dist[neighbor] == infinity()) {
+        continue;
+      }
+      best = std::min<DistType>(best, m_dist[neighbor] + cost(tile));
+    }
+    if (best != infinity()) {
+      m_dist[tile] = best;
+      m_heap.emplace_back(best, tile);
+    }
+  }
+  std::make_heap(m_heap.begin(), m_heap.end(), heap_order);
+
+  while (!m_heap.empty()) {
+    std::pop_heap(m_heap.begin(), m_heap.end(), heap_order);
+    const pair<DistType, int> top = m_heap.back();
+    m_heap.pop_back();
+    const int cur = top.second;
+    if (top.first != m_dist[cur]) {
+      // stale entry
+      continue;
+    }
+    const int x = cur % m_cols;
+    const int y = cur / m_cols;
+    for (int move = 0; move < num_moves - 1; ++move) {
+      const int nx = x + move_dx[move];
+      const int ny = y + move_dy[move];
+      if (nx < 0 || ny < 0 || nx >= m_cols || ny >= m_rows) {
+        continue;
+      }
+      const int next = ny * m_cols + nx;
+      // tiles outside the region keep costs that are still reachable, but a route through the region may now beat them
+      if (!passable[next]) {
+        continue;
+      }
+      const auto next_dist = static_cast<DistType>(m_dist[cur] + cost(next));
+      if (next_dist >= m_dist[next]) {
+        continue;
+      }
+      m_dist[next] = next_dist;
+      m_heap.emplace_back(next_dist, next);
+      std::push_heap(m_heap.begin(), m_heap.end(), heap_order);
+    }
+  }
+}
+
+int FlowField::bestMoves(int x, int y, int moves[num_moves - 1]) const {
+  DistType dists[num_moves - 1];
+  int count = 0;
+  for (int move = 0; move < num_moves - 1; ++move) {
+    const int nx = x + move_dx[move];
+    const int ny = y + move_dy[move];
+    if (nx < 0 || ny < 0 || nx >= m_cols || ny >= m_rows) {
+      continue;
+    }
+    const DistType dist = m_dist[ny * m_cols + nx];
+    if (dist == infinity()) {
+      continue;
+    }
+    // insertion sort, there are at most 8
+    int i = count++;
+    while (i > 0 && dists[i - 1] > dist) {
+      dists[i] = dists[i - 1];
+      moves[i] = moves[i - 1];
+      --i;
+    }
+    dists[i] = dist;
+    moves[i] = move;
+  }
+  return count;
+}
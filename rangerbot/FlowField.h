@@ -0,0 +1,76 @@
+#ifndef RANGERBOT_FLOWFIELD_H
+#define RANGERBOT_FLOWFIELD_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/*
+ * Cost to reach one goal from every tile, so any number of units headed there can each find their next step with a
+ * handful of array lookups.
+ *
+ * Stepping onto a tile costs more the more crowded the tiles around it are, so once a passage jams up, the field
+ * starts sending units around by other routes. The crowd moves every turn, but only the blocks near tiles whose
+ * crowding changed get recomputed, along with the tiles whose best route ran through them, and whatever a route made
+ * cheaper reaches. The costs come out the same as a full compute().
+ */
+class FlowField {
+ public:
+  typedef uint16_t DistType;
+
+  // moves are indices into directions_incl_center
+  static const int num_moves = 9;
+  // cost of a step onto a tile with nobody around. every unit in the 3x3 around the tile adds one more.
+  static const DistType step_cost = 2;
+  // incremental updates recompute whole blocks of this many tiles square
+  static const int block_size = 8;
+
+  /*
+   * Number of occupied tiles in the 3x3 around each tile. occupied and density are row-major, like
+   * MapPreprocessor::passable().
+   */
+  static void computeDensity(const std::vector<uint8_t> &occupied, int rows, int cols, std::vector<uint8_t> &density);
+
+  void compute(int goal_x, int goal_y, const std::vector<bool> &passable, const std::vector<uint8_t> &density,
+               int rows, int cols);
+
+  /*
+   * Recompute costs around the tiles whose density changed since the last compute() or updateDensity().
+   */
+  void updateDensity(const std::vector<bool> &passable, const std::vector<uint8_t> &density);
+
+  int goalX() const { return m_goal_x; }
+
+  int goalY() const { return m_goal_y; }
+
+  DistType distAt(int x, int y) const { return m_dist[y * m_cols + x]; }
+
+  DistType infinity() const { return UINT16_MAX; }
+
+  /*
+   * Fills moves with the directions out of (x, y) that lead anywhere, best first. Returns how many there are.
+   */
+  int bestMoves(int x, int y, int moves[num_moves - 1]) const;
+
+ private:
+  DistType cost(int tile) const { return step_cost + m_density[tile]; }
+
+  // Dijkstra over the tiles in m_in_region, starting from the goal and the region's edges, and on to any tile outside
+  // it that it can make cheaper
+  void relaxRegion(const std::vector<bool> &passable);
+
+  int m_rows = 0;
+  int m_cols = 0;
+  int m_goal_x = -1;
+  int m_goal_y = -1;
+  std::vector<DistType> m_dist;
+  // the density the costs were computed with
+  std::vector<uint8_t> m_density;
+  std::vector<bool> m_in_region;
+  std::vector<bool> m_dirty_blocks;
+  std::vector<int> m_region_queue;
+  std::vector<std::pair<DistType, int>> m_heap;
+};
+
+
+#endif //RANGERBOT_FLOWFIELD_H
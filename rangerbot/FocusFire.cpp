@@ -0,0 +1,136 @@
+
+#include "FocusFire.h"
+
+#include <algorithm>
+
+using std::vector;
+using std::make_pair;
+
+void FocusFireSolver::solve(const vector<Shooter> &shooters, const vector<Target> &targets, int rows, int cols,
+                            vector<Shot> &shots) {
+  shots.clear();
+  if (shooters.empty() || targets.empty()) {
+    return;
+  }
+
+  m_index.reset(rows, cols);
+  for (unsigned int t = 0; t < targets.size(); ++t) {
+    m_index.insert(targets[t].x, targets[t].y, t);
+  }
+  m_index.build();
+
+  // collect every (target, shooter) pair that's in range
+  m_pairs.clear();
+  m_num_options.assign(shooters.size(), 0);
+  for (unsigned int s = 0; s < shooters.size(); ++s) {
+    const Shooter &shooter = shooters[s];
+    m_index.forEachWithin(shooter.x, shooter.y, shooter.range_sq, [&](unsigned int t, unsigned int distsq) {
+      if (distsq > shooter.min_range_sq && effectiveDamage(shooter, targets[t]) > 0) {
+        m_pairs.push_back(make_pair(t, s));
+        ++m_num_options[s];
+      }
+    });
+  }
+
+  // counting sort the pairs by target
+  m_target_starts.assign(targets.size() + 1, 0);
+  for (const auto &target_and_shooter : m_pairs) {
+    ++m_target_starts[target_and_shooter.first + 1];
+  }
+  for (size_t t = 1; t < m_target_starts.size(); ++t) {
+    m_target_starts[t] += m_target_starts[t - 1];
+  }
+  m_shooters_by_target.resize(m_pairs.size());
+  m_cursor.assign(m_target_starts.begin(), m_target_starts.end() - 1);
+  for (const auto &target_and_shooter : m_pairs) {
+    m_shooters_by_target[m_cursor[target_and_shooter.first]++] = target_and_shooter.second;
+  }
+
+  // threats first, then whatever takes the fewest (average) hits to kill
+  m_target_order.clear();
+  m_remaining_health.resize(targets.size());
+  for (unsigned int t = 0; t < targets.size(); ++t) {
+    m_remaining_health[t] = targets[t].health;
+    if (m_target_starts[t + 1] > m_target_starts[t]) {
+      m_target_order.push_back(t);
+    }
+  }
+  std::sort(m_target_order.begin(), m_target_order.end(), [&](unsigned int lhs, unsigned int rhs) {
+    if (targets[lhs].is_threat != targets[rhs].is_threat) {
+      return targets[lhs].is_threat;
+    }
+    return targets[lhs].health + targets[lhs].defense < targets[rhs].health + targets[rhs].defense;
+  });
+
+  m_assigned.assign(shooters.size(), false);
+  for (const unsigned int &t : m_target_order) {
+    const Target &target = targets[t];
+    m_candidates.clear();
+    int available_damage = 0;
+    for (unsigned int i = m_target_starts[t]; i < m_target_starts[t + 1]; ++i) {
+      unsigned int s = m_shooters_by_target[i];
+      if (!m_assigned[s]) {
+        m_candidates.push_back(s);
+        available_damage += effectiveDamage(shooters[s], target);
+      }
+    }
+    if (available_damage < target.health) {
+      // can't kill it this turn. leave it for the chip damage pass.
+      continue;
+    }
+    // least flexible shooters first, and the hardest hitters among those
+    std::sort(m_candidates.begin(), m_candidates.end(), [&](unsigned int lhs, unsigned int rhs) {
+      if (m_num_options[lhs] != m_num_options[rhs]) {
+        return m_num_options[lhs] < m_num_options[rhs];
+      }
+      return effectiveDamage(shooters[lhs], target) > effectiveDamage(shooters[rhs], target);
+    });
+    size_t num_used = 0;
+    int dealt = 0;
+    while (dealt < target.health) {
+      dealt += effectiveDamage(shooters[m_candidates[num_used]], target);
+      ++num_used;
+    }
+    // drop anyone whose shot is pure overkill, freeing them up for the next target
+    for (size_t i = 0; i < num_used;) {
+      int damage = effectiveDamage(shooters[m_candidates[i]], target);
+      if (dealt - damage >= target.health) {
+        dealt -= damage;
+        std::swap(m_candidates[i], m_candidates[--num_used]);
+      } else {
+        ++i;
+      }
+    }
+    for (size_t i = 0; i < num_used; ++i) {
+      unsigned int s = m_candidates[i];
+      m_assigned[s] = true;
+      shots.push_back(Shot{shooters[s].id, target.id});
+    }
+    m_remaining_health[t] = 0;
+  }
+
+  // whoever's left chips away at the weakest survivor in range, threats first
+  for (unsigned int s = 0; s < shooters.size(); ++s) {
+    if (m_assigned[s] || m_num_options[s] == 0) {
+      continue;
+    }
+    const Shooter &shooter = shooters[s];
+    int best_target = -1;
+    m_index.forEachWithin(shooter.x, shooter.y, shooter.range_sq, [&](unsigned int t, unsigned int distsq) {
+      if (distsq <= shooter.min_range_sq || m_remaining_health[t] <= 0 || effectiveDamage(shooter, targets[t]) == 0) {
+        return;
+      }
+      if (best_target == -1
+          || (targets[t].is_threat && !targets[best_target].is_threat)
+          || (targets[t].is_threat == targets[best_target].is_threat
+              && m_remaining_health[t] < m_remaining_health[best_target])) {
+        best_target = t;
+      }
+    });
+    if (best_target != -1) {
+      m_remaining_health[best_target] -= effectiveDamage(shooter, targets[best_target]);
+      m_assigned[s] = true;
+      shots.push_back(Shot{shooter.id, targets[best_target].id});
+    }
+  }
+}
@@ -0,0 +1,70 @@
+#ifndef RANGERBOT_FOCUSFIRE_H
+#define RANGERBOT_FOCUSFIRE_H
+
+#include <vector>
+
+#include "SpatialIndex.h"
+
+/*
+ * Decides who shoots whom, for every attacker at once. Individually, each attacker would just shoot the weakest thing
+ * in range, so several rangers overkill the same target while its neighbors walk away healthy. Instead, go through
+ * the targets (threats first, then whatever dies in the fewest shots), and assign just enough shooters to kill each
+ * one, preferring shooters that don't have many other options. Anyone left over chips at the weakest thing in range.
+ */
+class FocusFireSolver {
+ public:
+  struct Shooter {
+    unsigned int id;
+    int x;
+    int y;
+    int damage;
+    unsigned int range_sq;
+    // rangers can't shoot things that are too close
+    unsigned int min_range_sq;
+  };
+
+  struct Target {
+    unsigned int id;
+    int x;
+    int y;
+    int health;
+    // knights shrug off part of every hit
+    int defense;
+    // robots that can damage us get killed first
+    bool is_threat;
+  };
+
+  struct Shot {
+    unsigned int shooter_id;
+    unsigned int target_id;
+  };
+
+  /*
+   * Fills shots with the attacks to make, in the order they should be made. Shooters without anything in range
+   * don't appear.
+   */
+  void solve(const std::vector<Shooter> &shooters, const std::vector<Target> &targets, int rows, int cols,
+             std::vector<Shot> &shots);
+
+ private:
+  static int effectiveDamage(const Shooter &shooter, const Target &target) {
+    int damage = shooter.damage - target.defense;
+    return damage > 0 ? damage : 0;
+  }
+
+  // all of these are scratch space, kept around so solving doesn't allocate once they've grown
+  SpatialIndex m_index;
+  // CSR list of the shooters that can reach each target
+  std::vector<unsigned int> m_target_starts;
+  std::vector<unsigned int> m_shooters_by_target;
+  std::vector<unsigned int> m_cursor;
+  std::vector<std::pair<unsigned int, unsigned int>> m_pairs;
+  std::vector<unsigned int> m_num_options;
+  std::vector<bool> m_assigned;
+  std::vector<int> m_remaining_health;
+  std::vector<unsigned int> m_target_order;
+  std::vector<unsigned int> m_candidates;
+};
+
+
+#endif //RANGERBOT_FOCUSFIRE_H
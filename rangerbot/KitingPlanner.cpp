@@ -0,0 +1,91 @@
+
+#include "KitingPlanner.h"
+
+#include <limits>
+
+#include "MoveOffsets.h"
+
+const int KitingPlanner::num_moves;
+const int KitingPlanner::center;
+
+void KitingPlanner::reset(int rows, int cols) {
+  m_rows = rows;
+  m_cols = cols;
+  m_enemies.clear();
+  m_enemy_index.reset(rows, cols);
+  m_patient_index.reset(rows, cols);
+}
+
+void KitingPlanner::addEnemy(int x, int y, int damage, unsigned int range_sq) {
+  m_enemy_index.insert(x, y, static_cast<unsigned int>(m_enemies.size()));
+  m_enemies.push_back(ThreatMap::Threat{x, y, damage, range_sq});
+}
+
+void KitingPlanner::addPatient(int x, int y) {
+  m_patient_index.insert(x, y, 0);
+}
+
+void KitingPlanner::build() {
+  // we move before they do, so assume they get a step in before shooting
+  m_threat_map.compute(m_enemies, m_rows, m_cols, true);
+  m_enemy_index.build();
+  m_patient_index.build();
+}
+
+int KitingPlanner::chooseMove(const Mover &mover, uint16_t legal, const float goal_dist[num_moves],
+                              const Weights &weights) const {
+  float threat[num_moves];
+  float has_target[num_moves];
+  float goal[num_moves];
+  bool is_legal[num_moves];
+  const SpatialIndex &targets = mover.heals ? m_patient_index : m_enemy_index;
+  for (int i = 0; i < num_moves; ++i) {
+    const int x = mover.x + move_dx[i];
+    const int y = mover.y + move_dy[i];
+    is_legal[i] = (i == center || (legal >> i & 1)) && x >= 0 && y >= 0 && x < m_cols && y < m_rows;
+    threat[i] = 0.0f;
+    has_target[i] = 0.0f;
+    goal[i] = 0.0f;
+    if (!is_legal[i]) {
+      continue;
+    }
+    threat[i] = static_cast<float>(m_threat_map.at(x, y));
+    goal[i] = goal_dist[i];
+    bool found = false;
+    targets.forEachWithin(x, y, mover.range_sq, [&](unsigned int, unsigned int distsq) {
+      found = found || distsq > mover.min_range_sq;
+    });
+    has_target[i] = found ? 1.0f : 0.0f;
+  }
+
+  // branch-free over all 9 at once
+  float score[num_moves];
+  const float lowest = std::numeric_limits<float>::lowest();
+  for (int i = 0; i < num_moves; ++i) {
+    const float dies = threat[i] >= mover.health ? death_penalty : 0.0f;
+    const float value = has_target[i] * weights.target - threat[i] * weights.threat - dies - goal[i] * weights.goal;
+    score[i] = is_legal[i] ? value : lowest;
+  }
+
+  int best = center;
+  for (int i = 0; i < center; ++i) {
+    if (score[i] > score[best]) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+bool KitingPlanner::closestEnemy(int x, int y, int &enemy_x, int &enemy_y) const {
+  int closest = std::numeric_limits<int>::max();
+  for (const ThreatMap::Threat &enemy : m_enemies) {
+    const int dx = enemy.x - x;
+    const int dy = enemy.y - y;
+    if (dx * dx + dy * dy < closest) {
+      closest = dx * dx + dy * dy;
+      enemy_x = enemy.x;
+      enemy_y = enemy.y;
+    }
+  }
+  return closest != std::numeric_limits<int>::max();
+}
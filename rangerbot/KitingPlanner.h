@@ -0,0 +1,78 @@
+#ifndef RANGERBOT_KITINGPLANNER_H
+#define RANGERBOT_KITINGPLANNER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "SpatialIndex.h"
+#include "ThreatMap.h"
+
+/*
+ * Picks a move for a single unit by scoring all 9 tiles it could end up on: how much the enemy could hit it there
+ * after they move, whether it has something to shoot (or heal) from there, and how far it is from its goal. Rangers
+ * step in to shoot and back out while reloading, healers hang back near whoever needs healing, and workers just get
+ * out of the way.
+ *
+ * Usage: reset(), addEnemy()/addPatient() everything, build(), then chooseMove() for each unit.
+ */
+class KitingPlanner {
+ public:
+  // moves are indices into directions_incl_center
+  static const int num_moves = 9;
+  static const int center = 8;
+
+  struct Weights {
+    // per point of damage we could take
+    float threat;
+    // for having something to shoot or heal
+    float target;
+    // per step closer to the goal. negative to move away.
+    float goal;
+  };
+
+  struct Mover {
+    int x;
+    int y;
+    float health;
+    unsigned int range_sq;
+    unsigned int min_range_sq;
+    // healers look for patients instead of enemies
+    bool heals;
+  };
+
+  void reset(int rows, int cols);
+
+  void addEnemy(int x, int y, int damage, unsigned int range_sq);
+
+  // one of our robots that could use a heal
+  void addPatient(int x, int y);
+
+  void build();
+
+  /*
+   * goal_dist is the distance to the goal from each of the 9 tiles, only read for legal moves. Bit i of legal is set
+   * if directions_incl_center[i] is a legal move; staying put always is. Ties go to staying put.
+   */
+  int chooseMove(const Mover &mover, uint16_t legal, const float goal_dist[num_moves], const Weights &weights) const;
+
+  /*
+   * Closest enemy by straight-line distance, or false if there are none.
+   */
+  bool closestEnemy(int x, int y, int &enemy_x, int &enemy_y) const;
+
+  int threatAt(int x, int y) const { return m_threat_map.at(x, y); }
+
+ private:
+  // dying is worse than any amount of damage
+  const float death_penalty = 1000.0f;
+
+  int m_rows = 0;
+  int m_cols = 0;
+  std::vector<ThreatMap::Threat> m_enemies;
+  ThreatMap m_threat_map;
+  SpatialIndex m_enemy_index;
+  SpatialIndex m_patient_index;
+};
+
+
+#endif //RANGERBOT_KITINGPLANNER_H
@@ -0,0 +1,373 @@
+
+#include "Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+enum Tag : uint8_t {
+  SignedTag,
+  UnsignedTag,
+  DoubleTag,
+  CharTag,
+  StringTag,
+  NewlineTag
+};
+
+/*
+ * Single producer, single consumer: the bot pushes, the writer thread pops. Each record is its size followed by its
+ * items, and may wrap around the end.
+ */
+class LogRing {
+ public:
+  static const size_t capacity = 1 << 20;
+
+  bool push(const uint8_t *record, uint16_t size) {
+    const size_t head = m_head.load(std::memory_order_relaxed);
+    const size_t tail = m_tail.load(std::memory_order_acquire);
+    if (capacity - (head - tail) < sizeof(size) + size) {
+      return false;
+    }
+    copyIn(head, &size, sizeof(size));
+    copyIn(head + sizeof(size), record, size);
+    m_head.store(head + sizeof(size) + size, std::memory_order_release);
+    return true;
+  }
+
+  // calls f(record, size) for everything pushed so far
+  template<class F>
+  void drain(F f) {
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    const size_t head = m_head.load(std::memory_order_acquire);
+    uint8_t record[LogRecord::max_record_size];
+    while (tail != head) {
+      uint16_t size;
+      copyOut(tail, &size, sizeof(size));
+      copyOut(tail + sizeof(size), record, size);
+      tail += sizeof(size) + size;
+      f(record, size);
+    }
+    m_tail.store(tail, std::memory_order_release);
+  }
+
+ private:
+  void copyIn(size_t position, const void *data, size_t size) {
+    const size_t start = position % capacity;
+    const size_t first = std::min(size, capacity - start);
+    memcpy(m_data + start, data, first);
+    memcpy(m_data, static_cast<const uint8_t *>(data) + first, size - first);
+  }
+
+  void copyOut(size_t position, void *data, size_t size) const {
+    const size_t start = position % capacity;
+    const size_t first = std::min(size, capacity - start);
+    memcpy(data, m_data + start, first);
+    memcpy(static_cast<uint8_t *>(data) + first, m_data, size - first);
+  }
+
+  uint8_t m_data[capacity];
+  // on separate cache lines, so the two threads don't fight over them
+  alignas(64) std::atomic<size_t> m_head{0};
+  alignas(64) std::atomic<size_t> m_tail{0};
+};
+
+LogRing ring;
+std::atomic<unsigned int> num_dropped{0};
+
+// records with anything the ring can't store get formatted here instead
+std::ostringstream eager_stream;
+const std::ios default_format(nullptr);
+
+// the rate limits count records per turn
+unsigned int log_turn = 0;
+
+struct Writer {
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool woken = false;
+  bool stop = false;
+  bool running = false;
+  FILE *file = stdout;
+};
+
+Writer writer;
+
+// even if nobody wakes it, the writer looks at the ring this often
+const std::chrono::milliseconds writer_period(100);
+
+void formatRecord(const uint8_t *record, size_t size, FILE *file) {
+  size_t position = 0;
+  while (position < size) {
+    const uint8_t tag = record[position++];
+    switch (tag) {
+      case SignedTag: {
+        long long value;
+        memcpy(&value, record + position, sizeof(value));
+        position += sizeof(value);
+        fprintf(file, "%lld", value);
+        break;
+      }
+      case UnsignedTag: {
+        unsigned long long value;
+        memcpy(&value, record + position, sizeof(value));
+        position += sizeof(value);
+        fprintf(file, "%llu", value);
+        break;
+      }
+      case DoubleTag: {
+        double value;
+        memcpy(&value, record + position, sizeof(value));
+        position += sizeof(value);
+        // the same as an ostream's default
+        fprintf(file, "%g", value);
+        break;
+      }
+      case CharTag:
+        fputc(record[position++], file);
+        break;
+      case StringTag: {
+        uint16_t length;
+        memcpy(&length, record + position, sizeof(length));
+        position += sizeof(length);
+        fwrite(record + position, 1, length, file);
+        position += length;
+        break;
+      }
+      case NewlineTag:
+        fputc('\n', file);
+        break;
+      default:
+        return;
+    }
+  }
+}
+
+void drainInto(FILE *file) {
+  ring.drain([file](const uint8_t *record, size_t size) {
+    formatRecord(record, size, file);
+  });
+  const unsigned int dropped = num_dropped.exchange(0);
+  if (dropped > 0) {
+    fprintf(file, "[log] the ring was full, dropped %u records\n", dropped);
+  }
+  fflush(file);
+}
+
+void runWriter() {
+  while (true) {
+    std::unique_lock<std::mutex> lock(writer.mutex);
+    writer.wake.wait_for(lock, writer_period, [] { return writer.woken || writer.stop; });
+    writer.woken = false;
+    const bool stopping = writer.stop;
+    lock.unlock();
+
+    drainInto(writer.file);
+    if (stopping) {
+      return;
+    }
+  }
+}
+
+}
+
+const unsigned int LogSite::log_site_limit;
+const int LogRecord::max_record_size;
+
+bool LogSite::admit() {
+  if (m_turn != log_turn) {
+    m_turn = log_turn;
+    m_count = 0;
+  }
+  if (m_count < log_site_limit) {
+    ++m_count;
+    return true;
+  }
+  if (m_count == log_site_limit) {
+    ++m_count;
+    LogRecord() << "[log] " << m_file << ":" << m_line << " hit its limit, dropping the rest of this turn" << std::endl;
+  }
+  return false;
+}
+
+LogRecord::~LogRecord() {
+  if (m_eager) {
+    const std::string text = eager_stream.str();
+    m_eager = false;
+    *this << text;
+  }
+  if (!writer.running) {
+    formatRecord(m_buffer, m_size, stdout);
+    return;
+  }
+  if (!ring.push(m_buffer, static_cast<uint16_t>(m_size))) {
+    num_dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void LogRecord::putBytes(const void *data, size_t size) {
+  if (m_size + size > max_record_size) {
+    return;
+  }
+  memcpy(m_buffer + m_size, data, size);
+  m_size += size;
+}
+
+LogRecord &LogRecord::putSigned(long long value) {
+  if (m_eager) {
+    eagerStream() << value;
+    return *this;
+  }
+  if (m_size + 1 + sizeof(value) <= max_record_size) {
+    const uint8_t tag = SignedTag;
+    putBytes(&tag, 1);
+    putBytes(&value, sizeof(value));
+  }
+  return *this;
+}
+
+LogRecord &LogRecord::putUnsigned(unsigned long long value) {
+  if (m_eager) {
+    eagerStream() << value;
+    return *this;
+  }
+  if (m_size + 1 + sizeof(value) <= max_record_size) {
+    const uint8_t tag = UnsignedTag;
+    putBytes(&tag, 1);
+    putBytes(&value, sizeof(value));
+  }
+  return *this;
+}
+
+LogRecord &LogRecord::putDouble(double value) {
+  if (m_eager) {
+    eagerStream() << value;
+    return *this;
+  }
+  if (m_size + 1 + sizeof(value) <= max_record_size) {
+    const uint8_t tag = DoubleTag;
+    putBytes(&tag, 1);
+    putBytes(&value, sizeof(value));
+  }
+  return *this;
+}
+
+LogRecord &LogRecord::operator<<(const char *value) {
+  if (m_eager) {
+    eagerStream() << value;
+    return *this;
+  }
+  const size_t header = 1 + sizeof(uint16_t);
+  if (m_size + header >= max_record_size) {
+    return *this;
+  }
+  const uint16_t length = static_cast<uint16_t>(std::min(strlen(value), max_record_size - m_size - header));
+  const uint8_t tag = StringTag;
+  putBytes(&tag, 1);
+  putBytes(&length, sizeof(length));
+  putBytes(value, length);
+  return *this;
+}
+
+LogRecord &LogRecord::operator<<(const std::string &value) {
+  return *this << value.c_str();
+}
+
+LogRecord &LogRecord::operator<<(char value) {
+  if (m_eager) {
+    eagerStream() << value;
+    return *this;
+  }
+  if (m_size + 2 <= max_record_size) {
+    const uint8_t tag = CharTag;
+    putBytes(&tag, 1);
+    putBytes(&value, 1);
+  }
+  return *this;
+}
+
+LogRecord &LogRecord::operator<<(bool value) {
+  return putUnsigned(value ? 1 : 0);
+}
+
+LogRecord &LogRecord::operator<<(std::ostream &(*manipulator)(std::ostream &)) {
+  if (!m_eager && manipulator == static_cast<std::ostream &(*)(std::ostream &)>(std::endl)) {
+    if (m_size + 1 <= max_record_size) {
+      const uint8_t tag = NewlineTag;
+      putBytes(&tag, 1);
+    }
+    return *this;
+  }
+  eagerStream() << manipulator;
+  return *this;
+}
+
+std::ostream &LogRecord::eagerStream() {
+  if (!m_eager) {
+    m_eager = true;
+    eager_stream.str("");
+    eager_stream.clear();
+    eager_stream.copyfmt(default_format);
+  }
+  return eager_stream;
+}
+
+void log_open(const char *path) {
+  log_close();
+  writer.file = stdout;
+  if (path != nullptr) {
+    FILE *file = fopen(path, "w");
+    if (file != nullptr) {
+      writer.file = file;
+    }
+  }
+  writer.stop = false;
+  writer.woken = false;
+  writer.running = true;
+  writer.thread = std::thread(runWriter);
+  // a joinable thread left for the static destructors calls terminate, so however the bot exits, stop it first
+  static bool at_exit_registered = false;
+  if (!at_exit_registered) {
+    std::atexit(log_close);
+    at_exit_registered = true;
+  }
+}
+
+void log_end_turn() {
+  ++log_turn;
+  if (!writer.running) {
+    fflush(stdout);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(writer.mutex);
+    writer.woken = true;
+  }
+  writer.wake.notify_one();
+}
+
+void log_close() {
+  if (!writer.running) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(writer.mutex);
+    writer.stop = true;
+  }
+  writer.wake.notify_one();
+  writer.thread.join();
+  writer.running = false;
+  if (writer.file != stdout) {
+    fclose(writer.file);
+  }
+  writer.file = stdout;
+}
@@ -0,0 +1,117 @@
+#ifndef RANGERBOT_LOGGER_H
+#define RANGERBOT_LOGGER_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/*
+ * The backend for LOG. A record is encoded into a small buffer on the stack as it's streamed, then copied into a
+ * lock-free ring buffer in one go. Numbers and strings are stored in binary and only formatted later by a writer
+ * thread, which drains the ring into the log file whenever log_end_turn() wakes it, so the turn never waits on I/O.
+ * If the ring is full, records are dropped rather than blocking.
+ *
+ * Anything other than plain numbers and strings, like a Unit or setw(), is formatted on the spot with its usual
+ * operator<<, along with the rest of that record.
+ *
+ * Every LOG is also rate limited to log_site_limit records per turn, so a log in a loop over units can't flood it.
+ */
+
+class LogSite {
+ public:
+  static const unsigned int log_site_limit = 4096;
+
+  LogSite(const char *file, int line) : m_file(file), m_line(line) {}
+
+  bool admit();
+
+ private:
+  const char *m_file;
+  const int m_line;
+  unsigned int m_turn = 0;
+  unsigned int m_count = 0;
+};
+
+class LogRecord {
+ public:
+  // records longer than this are cut short
+  static const int max_record_size = 512;
+
+  LogRecord() = default;
+
+  ~LogRecord();
+
+  LogRecord(const LogRecord &) = delete;
+
+  LogRecord &operator=(const LogRecord &) = delete;
+
+  LogRecord &operator<<(const char *value);
+
+  LogRecord &operator<<(const std::string &value);
+
+  LogRecord &operator<<(char value);
+
+  // these are characters to an ostream too
+  LogRecord &operator<<(signed char value) { return *this << static_cast<char>(value); }
+
+  LogRecord &operator<<(unsigned char value) { return *this << static_cast<char>(value); }
+
+  LogRecord &operator<<(bool value);
+
+  LogRecord &operator<<(int value) { return putSigned(value); }
+
+  LogRecord &operator<<(long value) { return putSigned(value); }
+
+  LogRecord &operator<<(long long value) { return putSigned(value); }
+
+  LogRecord &operator<<(short value) { return putSigned(value); }
+
+  LogRecord &operator<<(unsigned int value) { return putUnsigned(value); }
+
+  LogRecord &operator<<(unsigned long value) { return putUnsigned(value); }
+
+  LogRecord &operator<<(unsigned long long value) { return putUnsigned(value); }
+
+  LogRecord &operator<<(unsigned short value) { return putUnsigned(value); }
+
+  LogRecord &operator<<(float value) { return putDouble(value); }
+
+  LogRecord &operator<<(double value) { return putDouble(value); }
+
+  // endl and friends
+  LogRecord &operator<<(std::ostream &(*manipulator)(std::ostream &));
+
+  template<class T>
+  LogRecord &operator<<(const T &value) {
+    eagerStream() << value;
+    return *this;
+  }
+
+ private:
+  LogRecord &putSigned(long long value);
+
+  LogRecord &putUnsigned(unsigned long long value);
+
+  LogRecord &putDouble(double value);
+
+  void putBytes(const void *data, size_t size);
+
+  // switches the rest of this record to formatting right away
+  std::ostream &eagerStream();
+
+  uint8_t m_buffer[max_record_size];
+  size_t m_size = 0;
+  bool m_eager = false;
+};
+
+// nullptr logs to stdout. until this is called, records are written to stdout as soon as they're made.
+// log_close() runs at exit, if nothing called it before.
+void log_open(const char *path);
+
+// wakes the writer, and starts the next turn for the rate limits
+void log_end_turn();
+
+// writes out everything that's left and stops the writer
+void log_close();
+
+#endif //RANGERBOT_LOGGER_H
@@ -3,6 +3,8 @@
 #include "MapPreprocessor.h"
 
 #include <algorithm>
+#include <cassert>
+#include <chrono>
 #include <iostream>
 #include <iomanip>
 
@@ -18,12 +20,65 @@ using std::cout;
 using std::endl;
 using std::unique_ptr;
 
-void MapPreprocessor::process() {
-  // compute passable tiles
-  computePassableAndInitialKarbonite(m_passable, m_karbonite_on_map);
+namespace {
+
+// appends how long the rest of the enclosing scope takes to stage_times
+class StageTimer {
+ public:
+  StageTimer(vector<MapPreprocessor::StageTime> &stage_times, const char *name)
+      : m_stage_times(stage_times), m_name(name), m_start(std::chrono::steady_clock::now()) {}
+
+  ~StageTimer() {
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - m_start;
+    m_stage_times.push_back({m_name, elapsed.count()});
+  }
+
+ private:
+  vector<MapPreprocessor::StageTime> &m_stage_times;
+  const char *m_name;
+  std::chrono::steady_clock::time_point m_start;
+};
 
-  // summarize initial karbonite
-  summarizeInitialKarbonite(m_summarized_karbonite, m_coarse_tiles_with_karbonite_to_fine_tiles);
+}
+
+void MapPreprocessor::process() {
+  m_stage_times.clear();
+  {
+    // compute passable tiles
+    StageTimer timer(m_stage_times, "passable");
+    computePassableAndInitialKarbonite(m_passable, m_karbonite_on_map);
+  }
+  {
+    // summarize initial karbonite
+    StageTimer timer(m_stage_times, "karbonite_summary");
+    summarizeInitialKarbonite(m_summarized_karbonite, m_coarse_tiles_with_karbonite_to_fine_tiles);
+    computeKarboniteRowBits(m_karbonite_row_bits);
+  }
+  {
+    StageTimer timer(m_stage_times, "symmetry");
+    cacheStartingLocations(m_our_starting_locations, m_enemy_starting_locations);
+    m_symmetry = detectSymmetry();
+  }
+  if (!m_our_starting_locations.empty() && !m_enemy_starting_locations.empty()) {
+    StageTimer timer(m_stage_times, "territory");
+    computeTerritory();
+  }
+  {
+    StageTimer timer(m_stage_times, "wall_distance");
+    computeChebyshevDistance(m_passable, m_wall_distance);
+  }
+  {
+    StageTimer timer(m_stage_times, "chokepoints");
+    vector<Chokepoint> chokepoints;
+    computeChokepoints(chokepoints, m_regions);
+  }
+  {
+    StageTimer timer(m_stage_times, "open_space");
+    m_open = m_passable;
+    m_open_distance = m_wall_distance;
+    m_open_space_score = vector<unsigned int>(m_rows * m_cols, 0);
+    computeOpenSpaceScore(0, 0, m_rows - 1, m_cols - 1);
+  }
 
   if (m_planet == Planet::Mars) {
     cacheAsteroidStrikes(m_asteroid_strikes);
@@ -35,8 +90,11 @@ void MapPreprocessor::process() {
   LOG("summarized karbonite map:" << endl);
   print_karbonite_summary_map();*/
 
-  m_path_finder.computeAllPairsShortestPath(m_passable);
-  m_path_finder.computeConnectedComponents();
+  {
+    StageTimer timer(m_stage_times, "all_pairs");
+    m_path_finder.computeAllPairsShortestPath(m_passable);
+    m_path_finder.computeConnectedComponents();
+  }
 }
 
 void MapPreprocessor::cacheAsteroidStrikes(
@@ -57,8 +115,12 @@ void MapPreprocessor::updateMarsKarboniteEachTurn() {
       RowCol rowcol(loc.get_y(), loc.get_x());
       unsigned int &karbs = m_karbonite_on_map[m_path_finder.index(rowcol)];
       karbs += added_karbs;
+      m_karbonite_row_bits[rowcol.first] |= uint64_t(1) << rowcol.second;
 
       m_total_karbonite += added_karbs;
+      if (!m_territory.empty()) {
+        m_territory_karbonite[static_cast<uint8_t>(m_territory[m_path_finder.index(rowcol)])] += added_karbs;
+      }
 
       unsigned int coarse_index = fineLocationToCoarseIndex(rowcol);
       unsigned int &coarse_amount = m_summarized_karbonite[coarse_index];
@@ -135,10 +197,11 @@ void MapPreprocessor::summarizeInitialKarbonite(vector<unsigned int> &coarse_kar
       unsigned int &sum = coarse_karbonite[coarse_row * m_coarse_cols + coarse_col];
       unsigned int max_karbs = 0;
       DistType max_r, max_c;
+      // the last coarse row and column may hang off the edge of the map
       for (DistType r = coarse_row * karbonite_summary_grid_size;
-           r < (coarse_row + 1) * karbonite_summary_grid_size; ++r) {
+           r < min<DistType>((coarse_row + 1) * karbonite_summary_grid_size, m_rows); ++r) {
         for (DistType c = coarse_col * karbonite_summary_grid_size;
-             c < (coarse_col + 1) * karbonite_summary_grid_size; ++c) {
+             c < min<DistType>((coarse_col + 1) * karbonite_summary_grid_size, m_cols); ++c) {
           unsigned int karbs = m_karbonite_on_map[m_path_finder.index(r, c)];
           sum += karbs;
           // TODO: prefer locations near the center
@@ -162,6 +225,18 @@ void MapPreprocessor::summarizeInitialKarbonite(vector<unsigned int> &coarse_kar
   }
 }
 
+void MapPreprocessor::computeKarboniteRowBits(vector<uint64_t> &row_bits) {
+  assert(m_cols <= 64);
+  row_bits = vector<uint64_t>(m_rows, 0);
+  for (DistType r = 0; r < m_rows; ++r) {
+    for (DistType c = 0; c < m_cols; ++c) {
+      if (m_karbonite_on_map[m_path_finder.index(r, c)] > 0) {
+        row_bits[r] |= uint64_t(1) << c;
+      }
+    }
+  }
+}
+
 void MapPreprocessor::updateKarbonite(const MapLocation &loc, unsigned int observed_amount, bool may_be_unchanged) {
   RowCol rowcol(loc.get_y(), loc.get_x());
   unsigned int &karbs = m_karbonite_on_map[m_path_finder.index(rowcol)];
@@ -170,8 +245,14 @@ void MapPreprocessor::updateKarbonite(const MapLocation &loc, unsigned int obser
     return;
   }
   karbs = observed_amount;
+  if (observed_amount == 0) {
+    m_karbonite_row_bits[rowcol.first] &= ~(uint64_t(1) << rowcol.second);
+  }
 
   m_total_karbonite -= reduction;
+  if (!m_territory.empty()) {
+    m_territory_karbonite[static_cast<uint8_t>(m_territory[m_path_finder.index(rowcol)])] -= reduction;
+  }
 
   unsigned int coarse_index = fineLocationToCoarseIndex(rowcol);
   unsigned int &coarse_amount = m_summarized_karbonite[coarse_index];
@@ -183,12 +264,564 @@ void MapPreprocessor::updateKarbonite(const MapLocation &loc, unsigned int obser
 }
 
 unsigned int MapPreprocessor::queryKarboniteIfNonzero(const MapLocation &loc) {
-  RowCol rowcol(loc.get_y(), loc.get_x());
-  if (m_karbonite_on_map[m_path_finder.index(rowcol)] == 0) {
+  if (!mayHaveKarbonite(loc)) {
     return 0;
   } else {
     unsigned int newly_observed_karbs = m_gc.get_karbonite_at(loc);
     updateKarbonite(loc, newly_observed_karbs, true);
     return newly_observed_karbs;
   }
-}
\ No newline at end of file
+}
+uint16_t MapPreprocessor::karboniteNeighborMask(const MapLocation &loc) const {
+  const int r = loc.get_y();
+  const int c = loc.get_x();
+  // 3-bit windows of the rows below, at, and above loc. bit 0 is column c-1, bit 2 is column c+1.
+  auto window = [&](int row) -> uint16_t {
+    if (row < 0 || row >= m_rows) {
+      return 0;
+    }
+    uint64_t bits = m_karbonite_row_bits[row];
+    return static_cast<uint16_t>((c == 0 ? bits << 1 : bits >> (c - 1)) & 7U);
+  };
+  // north is +y
+  const uint16_t up = window(r + 1);
+  const uint16_t mid = window(r);
+  const uint16_t down = window(r - 1);
+
+  // North, Northeast, East, Southeast, South, Southwest, West, Northwest, Center
+  return static_cast<uint16_t>(((up >> 1) & 1U)
+                               | (((up >> 2) & 1U) << 1)
+                               | (((mid >> 2) & 1U) << 2)
+                               | (((down >> 2) & 1U) << 3)
+                               | (((down >> 1) & 1U) << 4)
+                               | ((down & 1U) << 5)
+                               | ((mid & 1U) << 6)
+                               | ((up & 1U) << 7)
+                               | (((mid >> 1) & 1U) << 8));
+}
+
+void MapPreprocessor::cacheStartingLocations(vector<RowCol> &ours, vector<RowCol> &enemy) {
+  Team our_team = m_gc.get_team();
+  for (const Unit &unit : m_map.get_initial_units()) {
+    MapLocation loc = unit.get_map_location();
+    RowCol rowcol(loc.get_y(), loc.get_x());
+    if (unit.get_team() == our_team) {
+      ours.push_back(rowcol);
+    } else {
+      enemy.push_back(rowcol);
+    }
+  }
+}
+
+MapPreprocessor::RowCol MapPreprocessor::mirrorUnder(const RowCol &rowcol, MapSymmetry symmetry) const {
+  switch (symmetry) {
+    case MapSymmetry::Vertical:
+      return RowCol(rowcol.first, m_cols - 1 - rowcol.second);
+    case MapSymmetry::Horizontal:
+      return RowCol(m_rows - 1 - rowcol.first, rowcol.second);
+    case MapSymmetry::Rotational:
+      return RowCol(m_rows - 1 - rowcol.first, m_cols - 1 - rowcol.second);
+    case MapSymmetry::None:
+      break;
+  }
+  return rowcol;
+}
+
+bool MapPreprocessor::isSymmetricUnder(MapSymmetry symmetry) {
+  bool symmetric = true;
+  // each pair gets checked twice, but this is only done once per game
+  for (DistType r = 0; r < m_rows && symmetric; ++r) {
+    for (DistType c = 0; c < m_cols; ++c) {
+      DistType index = m_path_finder.index(r, c);
+      DistType mirrored_index = m_path_finder.index(mirrorUnder(RowCol(r, c), symmetry));
+      if (m_passable[index] != m_passable[mirrored_index]
+          || m_karbonite_on_map[index] != m_karbonite_on_map[mirrored_index]) {
+        symmetric = false;
+        break;
+      }
+    }
+  }
+  return symmetric;
+}
+
+bool MapPreprocessor::startingLocationsSymmetricUnder(MapSymmetry symmetry) {
+  if (m_our_starting_locations.size() != m_enemy_starting_locations.size()) {
+    return false;
+  }
+  bool symmetric = true;
+  for (const RowCol &ours : m_our_starting_locations) {
+    RowCol mirrored = mirrorUnder(ours, symmetry);
+    if (std::find(m_enemy_starting_locations.begin(), m_enemy_starting_locations.end(), mirrored)
+        == m_enemy_starting_locations.end()) {
+      symmetric = false;
+      break;
+    }
+  }
+  return symmetric;
+}
+
+MapSymmetry MapPreprocessor::detectSymmetry() {
+  // Maps like "empty 20x20" satisfy every symmetry, so use the starting units to break ties. Mars has no starting
+  // units, so there we just take the first terrain match.
+  const vector<MapSymmetry> candidates = {MapSymmetry::Vertical, MapSymmetry::Horizontal, MapSymmetry::Rotational};
+  MapSymmetry first_match = MapSymmetry::None;
+  for (const MapSymmetry &candidate : candidates) {
+    if (!isSymmetricUnder(candidate)) {
+      continue;
+    }
+    if (m_our_starting_locations.empty() || startingLocationsSymmetricUnder(candidate)) {
+      return candidate;
+    }
+    if (first_match == MapSymmetry::None) {
+      first_match = candidate;
+    }
+  }
+  return first_match;
+}
+
+void MapPreprocessor::computeTerritory() {
+  const DistType num_tiles = m_rows * m_cols;
+  m_dist_to_us = vector<DistType>(num_tiles, m_path_finder.infinity());
+  m_dist_to_enemy = vector<DistType>(num_tiles, m_path_finder.infinity());
+  m_path_finder.relaxDistancesFrom(m_our_starting_locations, m_passable, m_dist_to_us, nullptr);
+  if (m_symmetry != MapSymmetry::None && startingLocationsSymmetricUnder(m_symmetry)) {
+    // the enemy's side is a mirror image of ours, so are its distances
+    for (DistType r = 0; r < m_rows; ++r) {
+      for (DistType c = 0; c < m_cols; ++c) {
+        m_dist_to_enemy[m_path_finder.index(r, c)] = m_dist_to_us[m_path_finder.index(mirror(RowCol(r, c)))];
+      }
+    }
+  } else {
+    m_path_finder.relaxDistancesFrom(m_enemy_starting_locations, m_passable, m_dist_to_enemy, nullptr);
+  }
+
+  m_territory = vector<Territory>(num_tiles);
+  std::fill(std::begin(m_territory_karbonite), std::end(m_territory_karbonite), 0);
+  for (DistType index = 0; index < num_tiles; ++index) {
+    Territory territory = classifyTerritory(index);
+    m_territory[index] = territory;
+    m_territory_karbonite[static_cast<uint8_t>(territory)] += m_karbonite_on_map[index];
+  }
+
+  LOG("karbonite by territory -- ours: " << territoryKarbonite(Territory::Ours)
+                                         << ", theirs: " << territoryKarbonite(Territory::Enemy)
+                                         << ", contested: " << territoryKarbonite(Territory::Contested) << endl);
+}
+
+Territory MapPreprocessor::classifyTerritory(DistType index) const {
+  const DistType infinity = m_path_finder.infinity();
+  const DistType to_us = m_dist_to_us[index];
+  const DistType to_enemy = m_dist_to_enemy[index];
+  if (to_us == infinity && to_enemy == infinity) {
+    return Territory::Unreachable;
+  }
+  if (to_us + contested_margin < to_enemy) {
+    return Territory::Ours;
+  }
+  if (to_enemy + contested_margin < to_us) {
+    return Territory::Enemy;
+  }
+  return Territory::Contested;
+}
+
+void MapPreprocessor::claimTerritory(const MapLocation &loc) {
+  if (m_territory.empty()) {
+    return;
+  }
+  vector<DistType> changed;
+  m_path_finder.relaxDistancesFrom({RowCol(loc.get_y(), loc.get_x())}, m_passable, m_dist_to_us, &changed);
+  for (const DistType &index : changed) {
+    Territory territory = classifyTerritory(index);
+    Territory &old_territory = m_territory[index];
+    if (territory != old_territory) {
+      unsigned int karbs = m_karbonite_on_map[index];
+      m_territory_karbonite[static_cast<uint8_t>(old_territory)] -= karbs;
+      m_territory_karbonite[static_cast<uint8_t>(territory)] += karbs;
+      old_territory = territory;
+    }
+  }
+}
+
+unsigned int MapPreprocessor::reachableKarbonite() const {
+  if (m_territory.empty()) {
+    return m_total_karbonite / 2;
+  }
+  return territoryKarbonite(Territory::Ours) + territoryKarbonite(Territory::Contested) / 2;
+}
+
+void MapPreprocessor::computeChebyshevDistance(const vector<bool> &open, vector<DistType> &distance) {
+  distance = vector<DistType>(m_rows * m_cols, 0);
+  // off the map counts as closed
+  auto at = [&](int r, int c) -> DistType {
+    if (r < 0 || c < 0 || r >= m_rows || c >= m_cols) {
+      return 0;
+    }
+    return distance[m_path_finder.index(r, c)];
+  };
+
+  // Two-pass chamfer transform. With unit weights on all 8 neighbors, this is exact for Chebyshev distance.
+  for (int r = 0; r < m_rows; ++r) {
+    for (int c = 0; c < m_cols; ++c) {
+      DistType index = m_path_finder.index(r, c);
+      if (!open[index]) {
+        continue;
+      }
+      DistType nearest = min(min(at(r - 1, c - 1), at(r - 1, c)), min(at(r - 1, c + 1), at(r, c - 1)));
+      distance[index] = nearest + static_cast<DistType>(1);
+    }
+  }
+  for (int r = m_rows - 1; r >= 0; --r) {
+    for (int c = m_cols - 1; c >= 0; --c) {
+      DistType index = m_path_finder.index(r, c);
+      if (!open[index]) {
+        continue;
+      }
+      DistType nearest = min(min(at(r + 1, c + 1), at(r + 1, c)), min(at(r + 1, c - 1), at(r, c + 1)));
+      distance[index] = min(distance[index], static_cast<DistType>(nearest + 1));
+    }
+  }
+}
+
+void MapPreprocessor::computeOpenSpaceScore(int min_r, int min_c, int max_r, int max_c) {
+  min_r = std::max(min_r, 0);
+  min_c = std::max(min_c, 0);
+  max_r = std::min(max_r, m_rows - 1);
+  max_c = std::min(max_c, m_cols - 1);
+  for (int r = min_r; r <= max_r; ++r) {
+    for (int c = min_c; c <= max_c; ++c) {
+      DistType index = m_path_finder.index(r, c);
+      unsigned int &score = m_open_space_score[index];
+      score = 0;
+      // blocking a chokepoint is the worst thing we could do
+      if (!m_open[index] || m_regions[index] == no_region()) {
+        continue;
+      }
+      for (int nr = std::max(r - 1, 0); nr <= std::min(r + 1, m_rows - 1); ++nr) {
+        for (int nc = std::max(c - 1, 0); nc <= std::min(c + 1, m_cols - 1); ++nc) {
+          score += m_open_distance[m_path_finder.index(nr, nc)];
+        }
+      }
+    }
+  }
+}
+
+void MapPreprocessor::addStructure(const MapLocation &loc) {
+  const int r = loc.get_y();
+  const int c = loc.get_x();
+  DistType index = m_path_finder.index(r, c);
+  if (!m_open[index]) {
+    return;
+  }
+  m_open[index] = false;
+  m_open_distance[index] = 0;
+
+  // Distances only drop, and only out to the first ring around the structure where nothing changes.
+  int radius = 1;
+  for (bool changed = true; changed; ++radius) {
+    changed = false;
+    for (int nr = r - radius; nr <= r + radius; ++nr) {
+      if (nr < 0 || nr >= m_rows) {
+        continue;
+      }
+      const bool full_row = nr == r - radius || nr == r + radius;
+      for (int nc = c - radius; nc <= c + radius; nc += full_row ? 1 : 2 * radius) {
+        if (nc < 0 || nc >= m_cols) {
+          continue;
+        }
+        DistType &dist = m_open_distance[m_path_finder.index(nr, nc)];
+        if (dist > radius) {
+          dist = static_cast<DistType>(radius);
+          changed = true;
+        }
+      }
+    }
+  }
+  // scores look one tile past the last ring that changed
+  computeOpenSpaceScore(r - radius, c - radius, r + radius, c + radius);
+}
+
+void MapPreprocessor::removeStructure(const MapLocation &loc) {
+  DistType index = m_path_finder.index(loc);
+  if (m_open[index] || !m_passable[index]) {
+    return;
+  }
+  m_open[index] = true;
+  computeChebyshevDistance(m_open, m_open_distance);
+  computeOpenSpaceScore(0, 0, m_rows - 1, m_cols - 1);
+}
+
+// block deltas, in the order used by the chokepoint adjacency bitmasks
+const int block_dr[8] = {-1, -1, -1, 0, 0, 1, 1, 1};
+const int block_dc[8] = {-1, 0, 1, -1, 1, -1, 0, 1};
+
+void MapPreprocessor::computeChokeBlockAdjacency(DistType offset, vector<uint8_t> &adjacency) {
+  adjacency = vector<uint8_t>(chokeBlockRows(offset) * chokeBlockCols(offset), 0);
+  for (int r = 0; r < m_rows; ++r) {
+    for (int c = 0; c < m_cols; ++c) {
+      if (!m_passable[m_path_finder.index(r, c)]) {
+        continue;
+      }
+      const int block_r = (r + offset) / choke_grid_size;
+      const int block_c = (c + offset) / choke_grid_size;
+      for (int k = 0; k < 8; ++k) {
+        // tile neighbors use the same deltas
+        const int nr = r + block_dr[k];
+        const int nc = c + block_dc[k];
+        if (nr < 0 || nc < 0 || nr >= m_rows || nc >= m_cols || !m_passable[m_path_finder.index(nr, nc)]) {
+          continue;
+        }
+        const int dbr = (nr + offset) / choke_grid_size - block_r;
+        const int dbc = (nc + offset) / choke_grid_size - block_c;
+        if (dbr == 0 && dbc == 0) {
+          continue;
+        }
+        const int bit = (dbr + 1) * 3 + (dbc + 1);
+        adjacency[chokeBlockIndex(offset, block_r, block_c)] |= 1U << (bit < 4 ? bit : bit - 1);
+      }
+    }
+  }
+}
+
+void MapPreprocessor::findArticulationBlocks(DistType offset, const vector<uint8_t> &adjacency,
+                                             vector<bool> &is_articulation) {
+  // iterative Tarjan, since recursion could get 600 frames deep
+  const int block_cols = chokeBlockCols(offset);
+  const int num_blocks = chokeBlockRows(offset) * block_cols;
+  is_articulation = vector<bool>(num_blocks, false);
+  vector<int> discovered(num_blocks, -1);
+  vector<int> low(num_blocks, 0);
+  vector<int> parent(num_blocks, -1);
+  vector<uint8_t> next_neighbor(num_blocks, 0);
+  vector<int> stack;
+  int time = 0;
+
+  for (int root = 0; root < num_blocks; ++root) {
+    if (adjacency[root] == 0 || discovered[root] != -1) {
+      continue;
+    }
+    int root_children = 0;
+    discovered[root] = low[root] = time++;
+    stack.push_back(root);
+    while (!stack.empty()) {
+      const int u = stack.back();
+      bool descended = false;
+      while (next_neighbor[u] < 8) {
+        const int k = next_neighbor[u]++;
+        if (!((adjacency[u] >> k) & 1U)) {
+          continue;
+        }
+        const int v = u + block_dr[k] * block_cols + block_dc[k];
+        if (discovered[v] == -1) {
+          parent[v] = u;
+          discovered[v] = low[v] = time++;
+          stack.push_back(v);
+          if (u == root) {
+            ++root_children;
+          }
+          descended = true;
+          break;
+        } else if (v != parent[u]) {
+          low[u] = std::min(low[u], discovered[v]);
+        }
+      }
+      if (descended) {
+        continue;
+      }
+      stack.pop_back();
+      const int p = parent[u];
+      if (p != -1) {
+        low[p] = std::min(low[p], low[u]);
+        if (p != root && low[u] >= discovered[p]) {
+          is_articulation[p] = true;
+        }
+      }
+    }
+    if (root_children > 1) {
+      is_articulation[root] = true;
+    }
+  }
+}
+
+void MapPreprocessor::computeChokepoints(vector<Chokepoint> &chokepoints, vector<DistType> &regions) {
+  const DistType num_tiles = m_rows * m_cols;
+
+  // First, narrow articulation blocks of the coarse graph are hard cuts: there's no way around them. A passage two
+  // tiles wide can straddle the edge between two rows of blocks, so the grid is tried at every offset.
+  vector<bool> is_cut(num_tiles, false);
+  vector<uint8_t> adjacency;
+  vector<bool> is_articulation;
+  for (DistType offset = 0; offset < choke_grid_size; ++offset) {
+    computeChokeBlockAdjacency(offset, adjacency);
+    findArticulationBlocks(offset, adjacency, is_articulation);
+    for (DistType block_r = 0; block_r < chokeBlockRows(offset); ++block_r) {
+      for (DistType block_c = 0; block_c < chokeBlockCols(offset); ++block_c) {
+        if (!is_articulation[chokeBlockIndex(offset, block_r, block_c)]) {
+          continue;
+        }
+        const DistType min_r = std::max<DistType>(block_r * choke_grid_size - offset, 0);
+        const DistType max_r = min<DistType>((block_r + 1) * choke_grid_size - offset, m_rows);
+        const DistType min_c = std::max<DistType>(block_c * choke_grid_size - offset, 0);
+        const DistType max_c = min<DistType>((block_c + 1) * choke_grid_size - offset, m_cols);
+        // the most open tile marks the middle of the passage
+        DistType widest = 0;
+        for (DistType r = min_r; r < max_r; ++r) {
+          for (DistType c = min_c; c < max_c; ++c) {
+            widest = std::max(widest, wallDistance(RowCol(r, c)));
+          }
+        }
+        if (widest == 0 || 2 * widest - 1 > max_choke_width) {
+          continue;
+        }
+        for (DistType r = min_r; r < max_r; ++r) {
+          for (DistType c = min_c; c < max_c; ++c) {
+            DistType index = m_path_finder.index(r, c);
+            is_cut[index] = is_cut[index] || m_passable[index];
+          }
+        }
+      }
+    }
+  }
+
+  // Second, grow regions outward from the open areas, all at the same speed. Corridors that aren't articulation
+  // points (ie the two ways around BigWall) get split down the middle where two regions meet.
+  regions = vector<DistType>(num_tiles, no_region());
+  DistType num_regions = 0;
+  vector<DistType> queue;
+  vector<DistType> seed_queue;
+  for (DistType start = 0; start < num_tiles; ++start) {
+    if (is_cut[start] || regions[start] != no_region() || m_wall_distance[start] < open_area_wall_distance) {
+      continue;
+    }
+    // flood the open area (only through open tiles) to give it one label
+    seed_queue.clear();
+    seed_queue.push_back(start);
+    regions[start] = num_regions;
+    for (size_t head = 0; head < seed_queue.size(); ++head) {
+      const DistType cur = seed_queue[head];
+      queue.push_back(cur);
+      for (int k = 0; k < 8; ++k) {
+        const int nr = cur / m_cols + block_dr[k];
+        const int nc = cur % m_cols + block_dc[k];
+        if (nr < 0 || nc < 0 || nr >= m_rows || nc >= m_cols) {
+          continue;
+        }
+        const DistType next = m_path_finder.index(nr, nc);
+        if (!is_cut[next] && regions[next] == no_region() && m_wall_distance[next] >= open_area_wall_distance) {
+          regions[next] = num_regions;
+          seed_queue.push_back(next);
+        }
+      }
+    }
+    ++num_regions;
+  }
+  // Pockets with no open area (or maps with no open areas at all) get a label of their own. Small ones are dead ends,
+  // which don't count as a side of a chokepoint.
+  vector<bool> is_side(num_regions, true);
+  for (DistType start = 0; start <= num_tiles; ++start) {
+    for (size_t head = 0; head < queue.size(); ++head) {
+      const DistType cur = queue[head];
+      for (int k = 0; k < 8; ++k) {
+        const int nr = cur / m_cols + block_dr[k];
+        const int nc = cur % m_cols + block_dc[k];
+        if (nr < 0 || nc < 0 || nr >= m_rows || nc >= m_cols) {
+          continue;
+        }
+        const DistType next = m_path_finder.index(nr, nc);
+        if (m_passable[next] && !is_cut[next] && regions[next] == no_region()) {
+          regions[next] = regions[cur];
+          queue.push_back(next);
+        }
+      }
+    }
+    if (queue.size() >= min_pocket_tiles) {
+      is_side[regions[queue.front()]] = true;
+    }
+    queue.clear();
+    while (start < num_tiles && (!m_passable[start] || is_cut[start] || regions[start] != no_region())) {
+      ++start;
+    }
+    if (start < num_tiles) {
+      regions[start] = num_regions++;
+      is_side.push_back(false);
+      queue.push_back(start);
+    }
+  }
+
+  // Finally, every cut tile and every tile bordering a different region is on a choke. Group them up, and report
+  // each group once, at its narrowest point.
+  auto is_boundary = [&](DistType index) -> bool {
+    if (!m_passable[index]) {
+      return false;
+    }
+    if (is_cut[index]) {
+      return true;
+    }
+    for (int k = 0; k < 8; ++k) {
+      const int nr = index / m_cols + block_dr[k];
+      const int nc = index % m_cols + block_dc[k];
+      if (nr < 0 || nc < 0 || nr >= m_rows || nc >= m_cols) {
+        continue;
+      }
+      const DistType next = m_path_finder.index(nr, nc);
+      if (m_passable[next] && !is_cut[next] && regions[next] != regions[index]) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  chokepoints.clear();
+  vector<DistType> choke_tiles;
+  vector<bool> visited(num_tiles, false);
+  for (DistType start = 0; start < num_tiles; ++start) {
+    if (visited[start] || !is_boundary(start)) {
+      continue;
+    }
+    Chokepoint choke;
+    choke.location = RowCol(start / m_cols, start % m_cols);
+    choke.width = corridorWidth(choke.location);
+    queue.clear();
+    queue.push_back(start);
+    visited[start] = true;
+    for (size_t head = 0; head < queue.size(); ++head) {
+      const DistType cur = queue[head];
+      const RowCol cur_rowcol(cur / m_cols, cur % m_cols);
+      if (corridorWidth(cur_rowcol) < choke.width) {
+        choke.width = corridorWidth(cur_rowcol);
+        choke.location = cur_rowcol;
+      }
+      if (!is_cut[cur] && is_side[regions[cur]]
+          && std::find(choke.regions.begin(), choke.regions.end(), regions[cur]) == choke.regions.end()) {
+        choke.regions.push_back(regions[cur]);
+      }
+      for (int k = 0; k < 8; ++k) {
+        const int nr = cur_rowcol.first + block_dr[k];
+        const int nc = cur_rowcol.second + block_dc[k];
+        if (nr < 0 || nc < 0 || nr >= m_rows || nc >= m_cols) {
+          continue;
+        }
+        const DistType next = m_path_finder.index(nr, nc);
+        if (!m_passable[next]) {
+          continue;
+        }
+        if (!visited[next] && is_boundary(next)) {
+          visited[next] = true;
+          queue.push_back(next);
+        } else if (!is_cut[next] && is_side[regions[next]]
+            && std::find(choke.regions.begin(), choke.regions.end(), regions[next]) == choke.regions.end()) {
+          choke.regions.push_back(regions[next]);
+        }
+      }
+    }
+    // a cut with a dead end on one side isn't interesting
+    if (choke.regions.size() >= 2 && choke.width <= max_choke_width) {
+      choke_tiles.insert(choke_tiles.end(), queue.begin(), queue.end());
+      chokepoints.push_back(choke);
+    }
+  }
+  for (const DistType &index : choke_tiles) {
+    regions[index] = no_region();
+  }
+
+  LOG("found " << chokepoints.size() << " chokepoints between " << num_regions << " regions" << endl);
+}
@@ -3,14 +3,47 @@
 #ifndef RANGERBOT_MAPPREPROCESSOR_H
 #define RANGERBOT_MAPPREPROCESSOR_H
 
+#include <cstdint>
 #include <map>
 #include <memory>
+#include <vector>
 
 #include "bcpp_api/bc.hpp"
 
 #include "PathFinding.h"
 #include "Util.hpp"
 
+/*
+ * Symmetry of the starting map. Vertical means mirrored across a vertical axis (x -> w-1-x), horizontal means
+ * mirrored across a horizontal axis (y -> h-1-y), and rotational means rotated 180 degrees about the center.
+ */
+enum class MapSymmetry {
+  None,
+  Vertical,
+  Horizontal,
+  Rotational
+};
+
+/*
+ * Which team gets to a tile first, walking from the starting units (and later, our structures).
+ */
+enum class Territory : uint8_t {
+  Ours = 0,
+  Enemy = 1,
+  Contested = 2,
+  Unreachable = 3
+};
+
+/*
+ * A narrow passage. The location is the tile in the middle of the passage, and regions are the ids of the areas on
+ * either side of it: open areas, or pockets too big to be dead ends.
+ */
+struct Chokepoint {
+  PathFinder::RowCol location;
+  PathFinder::DistType width;
+  std::vector<PathFinder::DistType> regions;
+};
+
 class MapPreprocessor {
  public:
   MapPreprocessor(const bc::GameController &gc, PathFinder &path_finder, const bc::PlanetMap &map)
@@ -32,6 +65,17 @@ class MapPreprocessor {
   // TODO: make the different kinds of preprocessing optional. unfortunately some depend on others, so it's tricy.
   void process();
 
+  struct StageTime {
+    const char *name;
+    double ms;
+  };
+
+  /*
+   * How long each stage of the last process() took, in the order they ran. Territory is skipped without starting
+   * units. tools/bench times these on every map.
+   */
+  const std::vector<StageTime> &stageTimes() const { return m_stage_times; }
+
   std::vector<bool> &passable() { return m_passable; }
 
   std::vector<unsigned int> &karboniteLocations() { return m_karbonite_on_map; }
@@ -54,16 +98,160 @@ class MapPreprocessor {
    */
   unsigned int queryKarboniteIfNonzero(const bc::MapLocation &loc);
 
+  /*
+   * Which of the 9 tiles around loc (in directions_incl_center order, bit i for direction i) may still have karbonite.
+   * Tiles off the map are never set. Only these tiles need to be confirmed with queryKarboniteIfNonzero().
+   */
+  uint16_t karboniteNeighborMask(const bc::MapLocation &loc) const;
+
+  bool mayHaveKarbonite(const bc::MapLocation &loc) const {
+    return (m_karbonite_row_bits[loc.get_y()] >> loc.get_x()) & 1U;
+  }
+
   const unsigned int &totalKarbonite() const { return m_total_karbonite; }
 
   void updateMarsKarboniteEachTurn();
 
+  MapSymmetry symmetry() const { return m_symmetry; }
+
+  /*
+   * Where the enemy started. Cached once, so nobody needs to re-read the initial units from the api.
+   */
+  const std::vector<RowCol> &enemyStartingLocations() const { return m_enemy_starting_locations; }
+
+  // tiles within this many steps of being equally close to both teams are contested
+  const DistType contested_margin = 1;
+
+  Territory territoryAt(const RowCol &rowcol) const {
+    return m_territory.empty() ? Territory::Unreachable : m_territory[m_path_finder.index(rowcol)];
+  }
+
+  /*
+   * Karbonite currently left in the given territory. Kept in sync with updateKarbonite(), so this is free to query.
+   */
+  unsigned int territoryKarbonite(Territory territory) const {
+    return m_territory_karbonite[static_cast<uint8_t>(territory)];
+  }
+
+  /*
+   * Karbonite we can expect to mine: all of ours plus half of the contested tiles. Without starting units (ie on
+   * mars), falls back to assuming the enemy takes half the map.
+   */
+  unsigned int reachableKarbonite() const;
+
+  /*
+   * Call when we put down a new structure. Relabels only the tiles that are now closer to us.
+   */
+  void claimTerritory(const bc::MapLocation &loc);
+
+  // side length of the blocks in the graph used to find chokepoints
+  const DistType choke_grid_size = 2;
+  // passages wider than this aren't worth calling a chokepoint
+  const DistType max_choke_width = 5;
+  // tiles at least this far from a wall are open areas, rather than corridors
+  const DistType open_area_wall_distance = 3;
+  // pockets with no open area that are smaller than this are dead ends, and don't count as a side of a chokepoint
+  const DistType min_pocket_tiles = max_choke_width * max_choke_width;
+
+  /*
+   * Chebyshev distance to the nearest impassable tile or the edge of the map. 0 for impassable tiles.
+   */
+  DistType wallDistance(const RowCol &rowcol) const { return m_wall_distance[m_path_finder.index(rowcol)]; }
+
+  /*
+   * Width of the widest open square centered on this tile.
+   */
+  DistType corridorWidth(const RowCol &rowcol) const {
+    DistType dist = wallDistance(rowcol);
+    return dist == 0 ? 0 : static_cast<DistType>(2 * dist - 1);
+  }
+
+  /*
+   * Like wallDistance(), but our own structures count as walls too.
+   */
+  DistType openDistance(const RowCol &rowcol) const { return m_open_distance[m_path_finder.index(rowcol)]; }
+
+  /*
+   * How good a tile is for a new structure: the sum of openDistance() over its 3x3 neighborhood, so structures go in
+   * the middle of open areas rather than in corridors. 0 on chokepoints and tiles that can't hold a structure.
+   */
+  unsigned int openSpaceScore(const RowCol &rowcol) const { return m_open_space_score[m_path_finder.index(rowcol)]; }
+
+  /*
+   * Call when one of our structures goes up or comes down, to keep openDistance() and openSpaceScore() current.
+   * Adding only touches the tiles near the structure; removing redoes the (linear) transform.
+   */
+  void addStructure(const bc::MapLocation &loc);
+
+  void removeStructure(const bc::MapLocation &loc);
+
  private:
   void computePassableAndInitialKarbonite(std::vector<bool> &passable, std::vector<unsigned int> &karbonite);
 
   void summarizeInitialKarbonite(std::vector<unsigned int> &coarse_karbonite,
                                  std::map<DistType, RowCol> &coarse_with_fine_tiles);
 
+  void computeKarboniteRowBits(std::vector<uint64_t> &row_bits);
+
+  void cacheStartingLocations(std::vector<RowCol> &ours, std::vector<RowCol> &enemy);
+
+  MapSymmetry detectSymmetry();
+
+  /*
+   * The tile corresponding to rowcol on the other half of the map. Identity if the map isn't symmetric.
+   */
+  RowCol mirror(const RowCol &rowcol) const { return mirrorUnder(rowcol, m_symmetry); }
+
+  RowCol mirrorUnder(const RowCol &rowcol, MapSymmetry symmetry) const;
+
+  bool isSymmetricUnder(MapSymmetry symmetry);
+
+  bool startingLocationsSymmetricUnder(MapSymmetry symmetry);
+
+  void computeTerritory();
+
+  Territory classifyTerritory(DistType index) const;
+
+  /*
+   * Chebyshev distance transform: for every open tile, the distance to the nearest closed tile or the map edge.
+   */
+  void computeChebyshevDistance(const std::vector<bool> &open, std::vector<DistType> &distance);
+
+  /*
+   * 3x3 box sum of m_open_distance over the given (inclusive) rectangle of tiles, clamped to the map.
+   */
+  void computeOpenSpaceScore(int min_r, int min_c, int max_r, int max_c);
+
+  /*
+   * Finds the chokepoints, and labels every tile with the area it belongs to after cutting the map at all of them.
+   * Walls and the chokepoints themselves get no_region(), which keeps structures out of them.
+   */
+  void computeChokepoints(std::vector<Chokepoint> &chokepoints, std::vector<DistType> &regions);
+
+  DistType no_region() const { return m_path_finder.infinity(); }
+
+  /*
+   * For each block of the coarse chokepoint graph, a bitmask of which of its 8 neighboring blocks it can walk to. The
+   * grid is shifted up and left by offset tiles, so a passage that straddles a block edge at one offset fits in a
+   * single row or column of blocks at another.
+   */
+  void computeChokeBlockAdjacency(DistType offset, std::vector<uint8_t> &adjacency);
+
+  void findArticulationBlocks(DistType offset, const std::vector<uint8_t> &adjacency,
+                              std::vector<bool> &is_articulation);
+
+  DistType chokeBlockRows(DistType offset) const {
+    return pos_int_div_ceil<DistType>(m_rows + offset, choke_grid_size);
+  }
+
+  DistType chokeBlockCols(DistType offset) const {
+    return pos_int_div_ceil<DistType>(m_cols + offset, choke_grid_size);
+  }
+
+  DistType chokeBlockIndex(DistType offset, DistType block_row, DistType block_col) const {
+    return block_row * chokeBlockCols(offset) + block_col;
+  }
+
   void cacheAsteroidStrikes(std::unique_ptr<std::unordered_map<unsigned int, bc::AsteroidStrike>> &asteroid_strikes);
 
   std::unique_ptr<std::unordered_map<unsigned int, bc::AsteroidStrike>> m_asteroid_strikes;
@@ -74,9 +262,25 @@ class MapPreprocessor {
 
   std::vector<bool> m_passable;
   std::vector<unsigned int> m_karbonite_on_map;
+  // one word per row, bit c set iff (row, c) may have karbonite. maps are at most 50 wide, so a row always fits.
+  std::vector<uint64_t> m_karbonite_row_bits;
   std::vector<unsigned int> m_summarized_karbonite;
   std::map<DistType, RowCol> m_coarse_tiles_with_karbonite_to_fine_tiles;
   unsigned int m_total_karbonite;
+  MapSymmetry m_symmetry = MapSymmetry::None;
+  std::vector<RowCol> m_our_starting_locations;
+  std::vector<RowCol> m_enemy_starting_locations;
+  std::vector<DistType> m_dist_to_us;
+  std::vector<DistType> m_dist_to_enemy;
+  std::vector<Territory> m_territory;
+  unsigned int m_territory_karbonite[4] = {0, 0, 0, 0};
+  std::vector<DistType> m_wall_distance;
+  // passable and not covered by one of our structures
+  std::vector<bool> m_open;
+  std::vector<DistType> m_open_distance;
+  std::vector<unsigned int> m_open_space_score;
+  std::vector<DistType> m_regions;
+  std::vector<StageTime> m_stage_times;
 
   DistType coarseIndex(DistType coarse_row, DistType coarse_col) {
     return coarse_row * m_coarse_cols + coarse_col;
@@ -0,0 +1,117 @@
+
+#include "MicroSearch.h"
+
+#include <algorithm>
+
+#include "MoveOffsets.h"
+
+using std::vector;
+
+namespace {
+const int layer_size = MicroSearch::beam_width * MicroSearch::num_moves;
+}
+
+const int MicroSearch::max_units;
+const int MicroSearch::beam_width;
+const int MicroSearch::num_moves;
+const int MicroSearch::center;
+const int8_t MicroSearch::undecided;
+
+MicroSearch::MicroSearch() {
+  m_arena.resize(2 * layer_size);
+  m_moves.resize(2 * layer_size * max_units);
+  m_order.reserve(layer_size);
+}
+
+float MicroSearch::evaluate(const CombatTeam &ours, const CombatTeam &theirs, const int8_t *moves, int num_decided,
+                            int rounds) {
+  // m_moved starts as a copy of ours, so only the decided units need their positions set
+  for (int i = 0; i < num_decided; ++i) {
+    m_moved.x[i] = ours.x[i] + move_dx[moves[i]];
+    m_moved.y[i] = ours.y[i] + move_dy[moves[i]];
+    m_moved.movement_heat[i] = moves[i] == center ? ours.movement_heat[i] : ours.movement_heat[i] +
+                                                                             ours.movement_cooldown[i];
+  }
+  // we already moved this round, so everyone holds from here on
+  return m_simulator.simulate(m_moved, theirs, Stance::Hold, rounds);
+}
+
+bool MicroSearch::search(const CombatTeam &ours, const CombatTeam &theirs, const vector<uint16_t> &legal_moves,
+                         int rounds, std::chrono::microseconds budget, vector<int8_t> &moves) {
+  const auto deadline = std::chrono::steady_clock::now() + budget;
+  const int num_units = static_cast<int>(ours.size());
+  moves.assign(static_cast<size_t>(num_units), undecided);
+  if (num_units == 0 || num_units > max_units || static_cast<int>(theirs.size()) > max_units) {
+    return false;
+  }
+  m_moved = ours;
+
+  // the beam starts with the empty plan
+  int current = 0;
+  int beam_size = 1;
+  m_arena[0] = Node{0.0f, 0};
+  int decided = 0;
+  for (; decided < num_units; ++decided) {
+    const int next = layer_size - current;
+    int num_children = 0;
+    bool out_of_time = false;
+    // staying put is always an option
+    const uint16_t legal = legal_moves[decided] | static_cast<uint16_t>(1 << center);
+    for (int b = 0; b < beam_size && !out_of_time; ++b) {
+      const Node &parent = m_arena[current + b];
+      const int8_t *parent_moves = &m_moves[parent.moves_offset];
+      for (int move = 0; move < num_moves; ++move) {
+        if (!(legal >> move & 1)) {
+          continue;
+        }
+        // don't let two of our units step onto the same tile
+        const float to_x = ours.x[decided] + move_dx[move];
+        const float to_y = ours.y[decided] + move_dy[move];
+        bool collides = false;
+        for (int i = 0; i < decided; ++i) {
+          if (ours.x[i] + move_dx[parent_moves[i]] == to_x && ours.y[i] + move_dy[parent_moves[i]] == to_y) {
+            collides = true;
+            break;
+          }
+        }
+        if (collides) {
+          continue;
+        }
+        const int child_index = next + num_children++;
+        Node &child = m_arena[child_index];
+        child.moves_offset = child_index * max_units;
+        int8_t *child_moves = &m_moves[child.moves_offset];
+        std::copy(parent_moves, parent_moves + decided, child_moves);
+        child_moves[decided] = static_cast<int8_t>(move);
+        child.score = evaluate(ours, theirs, child_moves, decided + 1, rounds);
+      }
+      out_of_time = std::chrono::steady_clock::now() >= deadline;
+    }
+    if (num_children == 0 || out_of_time) {
+      // the last complete layer is still in the current half of the arena
+      break;
+    }
+
+    // keep the best beam_width children
+    m_order.clear();
+    for (int i = 0; i < num_children; ++i) {
+      m_order.push_back(next + i);
+    }
+    const int keep = std::min(beam_width, num_children);
+    std::partial_sort(m_order.begin(), m_order.begin() + keep, m_order.end(),
+                      [this](int a, int b) { return m_arena[a].score > m_arena[b].score; });
+    // move the survivors to the start of the next layer. their moves stay where they are.
+    Node survivors[beam_width];
+    for (int i = 0; i < keep; ++i) {
+      survivors[i] = m_arena[m_order[i]];
+    }
+    std::copy(survivors, survivors + keep, m_arena.begin() + next);
+    current = next;
+    beam_size = keep;
+  }
+
+  // the beam is sorted after every complete layer, so the first node is the best
+  const int8_t *best_moves = &m_moves[m_arena[current].moves_offset];
+  std::copy(best_moves, best_moves + decided, moves.begin());
+  return decided == num_units;
+}
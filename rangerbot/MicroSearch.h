@@ -0,0 +1,57 @@
+#ifndef RANGERBOT_MICROSEARCH_H
+#define RANGERBOT_MICROSEARCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "CombatSimulator.h"
+
+/*
+ * Beam search over joint moves for small fights. Units are decided one at a time: each plan in the beam is extended
+ * with every legal move for the next unit, scored by simulating a few rounds of the fight from the resulting
+ * positions, and only the best few plans survive. Attacks are left to the focus fire afterwards.
+ *
+ * The search is anytime: when the time budget runs out it returns the best plan so far, with the units it didn't get
+ * to left undecided, so the caller can fall back to the usual heuristic for those. All nodes live in an arena that's
+ * allocated once, so searching doesn't allocate.
+ */
+class MicroSearch {
+ public:
+  // past this many units a side, the beam is too narrow to be much better than the heuristic
+  static const int max_units = 20;
+  static const int beam_width = 8;
+  // moves are indices into directions_incl_center
+  static const int num_moves = 9;
+  static const int center = 8;
+  static const int8_t undecided = -1;
+
+  MicroSearch();
+
+  /*
+   * legal_moves has one entry per unit in ours, with bit i set if directions_incl_center[i] is a legal move. Fills
+   * moves with one entry per unit: the move to make, or undecided. Returns whether the whole plan was searched.
+   */
+  bool search(const CombatTeam &ours, const CombatTeam &theirs, const std::vector<uint16_t> &legal_moves,
+              int rounds, std::chrono::microseconds budget, std::vector<int8_t> &moves);
+
+ private:
+  struct Node {
+    float score;
+    // this node's moves, max_units of them, in m_moves
+    int moves_offset;
+  };
+
+  float evaluate(const CombatTeam &ours, const CombatTeam &theirs, const int8_t *moves, int num_decided,
+                 int rounds);
+
+  CombatSimulator m_simulator;
+  CombatTeam m_moved;
+  // two layers of the beam, each beam_width * num_moves nodes, alternating between rounds
+  std::vector<Node> m_arena;
+  std::vector<int8_t> m_moves;
+  std::vector<int> m_order;
+};
+
+
+#endif //RANGERBOT_MICROSEARCH_H
@@ -0,0 +1,11 @@
+#ifndef RANGERBOT_MOVEOFFSETS_H
+#define RANGERBOT_MOVEOFFSETS_H
+
+/*
+ * x and y offsets of each direction, for code that works in plain tile coordinates instead of MapLocations. Indexed
+ * like directions_incl_center: North, Northeast, East, Southeast, South, Southwest, West, Northwest, Center.
+ */
+const int move_dx[9] = {0, 1, 1, 1, 0, -1, -1, -1, 0};
+const int move_dy[9] = {1, 1, 0, -1, -1, -1, 0, 1, 0};
+
+#endif //RANGERBOT_MOVEOFFSETS_H
@@ -0,0 +1,81 @@
+
+#include "MoveResolver.h"
+
+#include <algorithm>
+
+#include "MoveOffsets.h"
+
+using std::vector;
+
+const int MoveResolver::max_choices;
+
+void MoveResolver::reset(int rows, int cols) {
+  m_rows = rows;
+  m_cols = cols;
+  m_movers.clear();
+  m_occupant.assign(static_cast<size_t>(rows * cols), -1);
+}
+
+void MoveResolver::add(unsigned int unit_id, int x, int y, const int *choices, int num_choices) {
+  Mover mover{unit_id, x, y, {}, std::min(num_choices, max_choices), State::Unvisited};
+  std::copy(choices, choices + mover.num_choices, mover.choices);
+  m_occupant[y * m_cols + x] = static_cast<int>(m_movers.size());
+  m_movers.push_back(mover);
+}
+
+void MoveResolver::resolve(vector<Move> &moves) {
+  moves.clear();
+  for (int mover = 0; mover < static_cast<int>(m_movers.size()); ++mover) {
+    if (m_movers[mover].state == State::Unvisited) {
+      resolveFrom(mover, moves);
+    }
+  }
+}
+
+void MoveResolver::resolveFrom(int start, vector<Move> &moves) {
+  // iterative, since a long column of units makes for a deep chain
+  m_stack.clear();
+  m_stack.emplace_back(start, 0);
+  m_movers[start].state = State::Visiting;
+  while (!m_stack.empty()) {
+    const int current = m_stack.back().first;
+    int &next_choice = m_stack.back().second;
+    Mover &mover = m_movers[current];
+    bool waiting = false;
+    while (next_choice < mover.num_choices) {
+      const int direction = mover.choices[next_choice];
+      const int x = mover.x + move_dx[direction];
+      const int y = mover.y + move_dy[direction];
+      if (x < 0 || y < 0 || x >= m_cols || y >= m_rows) {
+        ++next_choice;
+        continue;
+      }
+      const int tile = y * m_cols + x;
+      const int occupant = m_occupant[tile];
+      if (occupant == -1) {
+        // free: take it
+        m_occupant[mover.y * m_cols + mover.x] = -1;
+        m_occupant[tile] = current;
+        mover.x = x;
+        mover.y = y;
+        moves.push_back(Move{mover.unit_id, direction});
+        break;
+      }
+      if (m_movers[occupant].state == State::Unvisited) {
+        // let whoever's there go first, then look at this choice again
+        m_movers[occupant].state = State::Visiting;
+        m_stack.emplace_back(occupant, 0);
+        waiting = true;
+        break;
+      }
+      // the occupant has already settled there, or we've gone around in a cycle
+      ++next_choice;
+    }
+    if (waiting) {
+      continue;
+    }
+    // moved, or out of choices and holding
+    mover.state = State::Done;
+    m_stack.pop_back();
+  }
+}
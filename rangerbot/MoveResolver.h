@@ -0,0 +1,60 @@
+#ifndef RANGERBOT_MOVERESOLVER_H
+#define RANGERBOT_MOVERESOLVER_H
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * Decides the order to move a group of our units in, so a unit stuck behind an ally moves after the ally gets out of
+ * the way instead of failing and giving up. Every unit lists the moves it wants, best first. A unit whose pick is
+ * occupied by another mover waits for that one to be resolved first (a depth-first topological order over "wants the
+ * tile of"). The game can't swap or rotate units, so a cycle just means its members fall back to their next choice,
+ * or hold.
+ *
+ * Usage: reset(), add() every mover, resolve(), then issue the moves in order.
+ */
+class MoveResolver {
+ public:
+  // moves are indices into directions_incl_center
+  static const int max_choices = 8;
+
+  struct Move {
+    unsigned int unit_id;
+    int direction;
+  };
+
+  void reset(int rows, int cols);
+
+  /*
+   * choices are the directions the unit would like to go, best first. Only offer tiles that are free or held by
+   * another mover; anything else will be tried and fail.
+   */
+  void add(unsigned int unit_id, int x, int y, const int *choices, int num_choices);
+
+  void resolve(std::vector<Move> &moves);
+
+ private:
+  enum class State : uint8_t {Unvisited, Visiting, Done};
+
+  void resolveFrom(int mover, std::vector<Move> &moves);
+
+  struct Mover {
+    unsigned int unit_id;
+    int x;
+    int y;
+    int choices[max_choices];
+    int num_choices;
+    State state;
+  };
+
+  int m_rows = 0;
+  int m_cols = 0;
+  std::vector<Mover> m_movers;
+  // which mover is on each tile, or -1
+  std::vector<int> m_occupant;
+  // explicit DFS stack of (mover, next choice to try)
+  std::vector<std::pair<int, int>> m_stack;
+};
+
+
+#endif //RANGERBOT_MOVERESOLVER_H
@@ -2,43 +2,17 @@
 
 #include "PathFinding.h"
 
-#include <list>
 #include <iomanip>
 
 #include "Debug.h"
 
 using namespace bc;
 using std::vector;
-using std::list;
 using std::endl;
 using std::setfill;
 using std::setw;
 
 
-PathFinder::RowCol &operator+=(PathFinder::RowCol &lhs, const PathFinder::RowCol &rhs) {
-  lhs.first += rhs.first;
-  lhs.second += rhs.second;
-  return lhs;
-}
-
-const PathFinder::RowCol operator+(const PathFinder::RowCol &lhs, const PathFinder::RowCol &rhs) {
-  PathFinder::RowCol result = lhs;
-  result += rhs;
-  return result;
-}
-
-// Note that the are unsigned, so -1 gets cast to (2^N-1)
-const vector<PathFinder::RowCol> dirs{
-    {1,  0},
-    {1,  1},
-    {0,  1},
-    {-1, 1},
-    {-1, 0},
-    {-1, -1},
-    {0,  -1},
-    {1,  -1}
-};
-
 PathFinder::DistType PathFinder::index(const RowCol &rc) {
   return index(rc.first, rc.second);
 }
@@ -58,9 +32,11 @@ void PathFinder::computeAllPairsShortestPath(const vector<bool> &passable) {
   m_all_pair_distances = vector<vector<DistType >>(m_rows * m_cols,
                                                    vector<DistType>(m_rows * m_cols, m_infinity));
 
+  vector<RowCol> start(1);
   for (DistType r_start = 0; r_start < m_rows; ++r_start) {
     for (DistType c_start = 0; c_start < m_cols; ++c_start) {
-      bfs(RowCol(r_start, c_start), m_all_pair_distances[index(r_start, c_start)], passable);
+      start[0] = RowCol(r_start, c_start);
+      relaxDistancesFrom(start, passable, m_all_pair_distances[index(r_start, c_start)], nullptr);
     }
   }
 
@@ -88,47 +64,47 @@ void PathFinder::print_dist_slice() {
 #endif
 }
 
-void PathFinder::bfs(const RowCol &start, vector<DistType> &distances, const vector<bool> &passable) {
-  if (!passable[index(start)]) {
-    return;
+void PathFinder::relaxDistancesFrom(const vector<RowCol> &sources, const vector<bool> &passable,
+                                    vector<DistType> &dist, vector<DistType> *changed) {
+  vector<DistType> &queue = m_bfs_queue;
+  queue.clear();
+  for (const RowCol &source : sources) {
+    DistType source_index = index(source);
+    // structures and starting units sit on passable tiles, but be defensive
+    if (!passable[source_index] || dist[source_index] == 0) {
+      continue;
+    }
+    dist[source_index] = 0;
+    queue.push_back(source_index);
+    if (changed) {
+      changed->push_back(source_index);
+    }
   }
-  DistType next_dist_to_assign = 0;
-  distances[index(start)] = next_dist_to_assign++;
-
-  // TODO: might be faster to use stacks here. we could even pre-allocate vectors, since we can compute an upper
-  // bound on the number of frontier vertices relatively easy
-  list<RowCol> frontier, next_frontier;
-  frontier.push_back(start);
 
-  while (!frontier.empty()) {
-    const RowCol &cur = frontier.front();
-
-    for (const RowCol &dir : dirs) {
-      const RowCol next = cur + dir;
-
-      // bounds check
-      // note that an index of -1 underflows to 2^N-1
-      if (next.first >= m_rows || next.second >= m_cols) {
-        continue;
-      }
-      DistType &next_dist = distances[index(next)];
-      if (next_dist != m_infinity) {
-        // already visited
-        continue;
-      }
-      if (passable[index(next)]) {
-        next_dist = next_dist_to_assign;
-        next_frontier.push_back(next);
+  for (size_t head = 0; head < queue.size(); ++head) {
+    const DistType cur = queue[head];
+    const int r = cur / m_cols;
+    const int c = cur % m_cols;
+    const DistType next_dist = dist[cur] + static_cast<DistType>(1);
+    for (int dr = -1; dr <= 1; ++dr) {
+      for (int dc = -1; dc <= 1; ++dc) {
+        const int nr = r + dr;
+        const int nc = c + dc;
+        if (nr < 0 || nc < 0 || nr >= m_rows || nc >= m_cols) {
+          continue;
+        }
+        const DistType next = index(nr, nc);
+        if (!passable[next] || dist[next] <= next_dist) {
+          continue;
+        }
+        dist[next] = next_dist;
+        queue.push_back(next);
+        if (changed) {
+          changed->push_back(next);
+        }
       }
     }
-
-    frontier.pop_front();
-    if (frontier.empty()) {
-      std::swap(frontier, next_frontier);
-      ++next_dist_to_assign;
-    }
   }
-
 }
 
 void PathFinder::computeConnectedComponents() {}
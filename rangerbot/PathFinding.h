@@ -29,6 +29,14 @@ class PathFinder {
 
   void computeAllPairsShortestPath(const std::vector<bool> &passable);
 
+  /*
+   * Multi-source BFS that only ever lowers distances, so it serves for a whole map from scratch (all of dist at
+   * infinity()) as well as for incremental updates. Indices of tiles whose distance dropped are appended to changed,
+   * if non-null. dist is row-major, like passable.
+   */
+  void relaxDistancesFrom(const std::vector<RowCol> &sources, const std::vector<bool> &passable,
+                          std::vector<DistType> &dist, std::vector<DistType> *changed);
+
   void computeConnectedComponents();
 
   /*
@@ -64,9 +72,9 @@ class PathFinder {
 
  private:
 
-  void bfs(const RowCol &start, std::vector<DistType> &distances, const std::vector<bool> &passable);
-
   std::vector<std::vector<DistType >> m_all_pair_distances;
+  // reused by every relaxDistancesFrom(), so the all pairs search doesn't allocate per tile
+  std::vector<DistType> m_bfs_queue;
 
   void print_dist_slice();
 
@@ -0,0 +1,191 @@
+
+#include "Profiler.h"
+
+#ifndef RANGERBOT_NO_PROFILER
+
+#include <csignal>
+#include <cstdlib>
+#include <ctime>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// spans past this many don't make it into the report
+const int max_sites = 128;
+
+ProfilerSite *sites[max_sites];
+int num_sites = 0;
+
+int report_fd = -1;
+
+uint64_t monotonicNs() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec);
+}
+
+// ticks are converted to time by comparing against the clock over the whole game
+const uint64_t start_ticks = profiler_ticks();
+const uint64_t start_ns = monotonicNs();
+
+/*
+ * A line of the report. The report is written from signal handlers too, and snprintf isn't async-signal-safe, so this
+ * formats numbers by hand into a buffer on the stack.
+ */
+class ReportLine {
+ public:
+  void append(const char *text) {
+    while (*text != '\0' && m_length < sizeof(m_text)) {
+      m_text[m_length++] = *text++;
+    }
+  }
+
+  void appendUnsigned(uint64_t value) {
+    char digits[20];
+    int count = 0;
+    do {
+      digits[count++] = static_cast<char>('0' + value % 10);
+      value /= 10;
+    } while (value > 0);
+    while (count > 0 && m_length < sizeof(m_text)) {
+      m_text[m_length++] = digits[--count];
+    }
+  }
+
+  // with three decimals, like %.3f
+  void appendFixed(double value) {
+    const uint64_t thousandths = value > 0.0 ? static_cast<uint64_t>(value * 1000.0 + 0.5) : 0;
+    appendUnsigned(thousandths / 1000);
+    append(".");
+    const uint64_t fraction = thousandths % 1000;
+    append(fraction < 100 ? (fraction < 10 ? "00" : "0") : "");
+    appendUnsigned(fraction);
+  }
+
+  ssize_t writeTo(int fd) const { return write(fd, m_text, m_length); }
+
+ private:
+  char m_text[512];
+  size_t m_length = 0;
+};
+
+void writeReport(int fd) {
+  if (fd < 0) {
+    return;
+  }
+  const uint64_t elapsed_ns = monotonicNs() - start_ns;
+  const uint64_t elapsed_ticks = profiler_ticks() - start_ticks;
+  const double us_per_tick = elapsed_ticks > 0 ? elapsed_ns / 1000.0 / elapsed_ticks : 0.0;
+
+  if (lseek(fd, 0, SEEK_SET) != 0 || ftruncate(fd, 0) != 0) {
+    return;
+  }
+  ReportLine header;
+  header.append("span,parent,calls,total_ms,self_ms,mean_us,p50_us,p99_us,max_us,allocations,allocated_mb\n");
+  ssize_t written = header.writeTo(fd);
+
+  for (int i = 0; i < num_sites && written >= 0; ++i) {
+    const ProfilerSite &site = *sites[i];
+    if (site.m_calls == 0) {
+      continue;
+    }
+    // percentiles are the middle of the bucket they land in, so within about 12%
+    double percentiles_us[2];
+    const double fractions[2] = {0.5, 0.99};
+    for (int p = 0; p < 2; ++p) {
+      const uint64_t rank = static_cast<uint64_t>(fractions[p] * (site.m_calls - 1)) + 1;
+      uint64_t seen = 0;
+      int bucket = 0;
+      for (; bucket < ProfilerSite::num_buckets - 1; ++bucket) {
+        seen += site.m_histogram[bucket];
+        if (seen >= rank) {
+          break;
+        }
+      }
+      const uint64_t low = ProfilerSite::bucketStart(bucket);
+      const uint64_t high = bucket + 1 < ProfilerSite::num_buckets ? ProfilerSite::bucketStart(bucket + 1) : low;
+      percentiles_us[p] = (low + high) / 2.0 * us_per_tick;
+    }
+    ReportLine line;
+    line.append(site.m_name);
+    line.append(",");
+    line.append(site.m_parent != nullptr ? site.m_parent->m_name : "");
+    line.append(",");
+    line.appendUnsigned(site.m_calls);
+    line.append(",");
+    line.appendFixed(site.m_total_ticks * us_per_tick / 1000.0);
+    line.append(",");
+    line.appendFixed(site.m_self_ticks * us_per_tick / 1000.0);
+    line.append(",");
+    line.appendFixed(site.m_total_ticks * us_per_tick / site.m_calls);
+    line.append(",");
+    line.appendFixed(percentiles_us[0]);
+    line.append(",");
+    line.appendFixed(percentiles_us[1]);
+    line.append(",");
+    line.appendFixed(site.m_max_ticks * us_per_tick);
+    line.append(",");
+    line.appendUnsigned(site.m_allocations);
+    line.append(",");
+    line.appendFixed(site.m_allocated_bytes / static_cast<double>(1 << 20));
+    line.append("\n");
+    written = line.writeTo(fd);
+  }
+}
+
+void handleSignal(int signal_number) {
+  writeReport(report_fd);
+  if (signal_number != SIGUSR1) {
+    // let it kill us as it would have
+    std::signal(signal_number, SIG_DFL);
+    std::raise(signal_number);
+  }
+}
+
+// so a game that ends early, or a bot that exits before the last round, still leaves a report
+void writeReportAtExit() {
+  writeReport(report_fd);
+}
+
+}
+
+ProfilerScope *ProfilerScope::s_current = nullptr;
+
+const int ProfilerSite::num_buckets;
+
+ProfilerSite::ProfilerSite(const char *name) : m_name(name) {
+  if (num_sites < max_sites) {
+    sites[num_sites++] = this;
+  }
+}
+
+uint64_t ProfilerSite::bucketStart(int bucket) {
+  if (bucket < 4) {
+    return static_cast<uint64_t>(bucket);
+  }
+  const int log2 = bucket / 4 + 1;
+  return static_cast<uint64_t>(4 + bucket % 4) << (log2 - 2);
+}
+
+void profiler_open_report(const char *path) {
+  if (report_fd >= 0) {
+    close(report_fd);
+  }
+  report_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  std::signal(SIGTERM, handleSignal);
+  std::signal(SIGINT, handleSignal);
+  std::signal(SIGUSR1, handleSignal);
+  static bool at_exit_registered = false;
+  if (!at_exit_registered) {
+    std::atexit(writeReportAtExit);
+    at_exit_registered = true;
+  }
+}
+
+void profiler_write_report() {
+  writeReport(report_fd);
+}
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef RANGERBOT_PROFILER_H
+#define RANGERBOT_PROFILER_H
+
+#include <cstdint>
+
+#include "AllocationTracker.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <x86intrin.h>
+#else
+#  include <chrono>
+#endif
+
+/*
+ * Scoped span profiler, cheap enough to leave on in release builds. PROFILE_SPAN("name") times the rest of the
+ * enclosing scope with the time stamp counter. Every span keeps a call count, total and self time (without the spans
+ * nested in it), its max and a fixed-size log histogram for percentiles, so recording never allocates.
+ *
+ * With RANGERBOT_TRACK_ALLOCATIONS, spans also count the allocations made inside them, nested spans included.
+ *
+ * profiler_open_report() picks the file the report goes to and writes it at exit and on SIGTERM, SIGINT and SIGUSR1.
+ * profiler_write_report() writes it on demand, e.g. at the end of the game. The report is CSV, one line per span.
+ *
+ * Build with -DRANGERBOT_NO_PROFILER to compile all of it out.
+ */
+
+#ifdef RANGERBOT_NO_PROFILER
+
+#  define PROFILE_SPAN(name)
+
+inline void profiler_open_report(const char *) {}
+
+inline void profiler_write_report() {}
+
+#else
+
+#  define PROFILER_CONCAT_INNER(a, b) a##b
+#  define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+#  define PROFILE_SPAN(name) \
+  static ProfilerSite PROFILER_CONCAT(profiler_site_, __LINE__)(name); \
+  ProfilerScope PROFILER_CONCAT(profiler_scope_, __LINE__)(PROFILER_CONCAT(profiler_site_, __LINE__))
+
+inline uint64_t profiler_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+/*
+ * The statistics for one PROFILE_SPAN. These are static, and register themselves for the report the first time
+ * they're reached.
+ */
+class ProfilerSite {
+ public:
+  // four buckets per power of two, up to 2^33 ticks
+  static const int num_buckets = 128;
+
+  explicit ProfilerSite(const char *name);
+
+  void record(uint64_t ticks, uint64_t self_ticks) {
+    ++m_calls;
+    m_total_ticks += ticks;
+    m_self_ticks += self_ticks;
+    if (ticks > m_max_ticks) {
+      m_max_ticks = ticks;
+    }
+    ++m_histogram[bucket(ticks)];
+  }
+
+  static int bucket(uint64_t ticks) {
+    if (ticks < 4) {
+      return static_cast<int>(ticks);
+    }
+    const int log2 = 63 - __builtin_clzll(ticks);
+    const int index = 4 * (log2 - 1) + static_cast<int>((ticks >> (log2 - 2)) & 3);
+    return index < num_buckets ? index : num_buckets - 1;
+  }
+
+  // the smallest tick count that lands in this bucket
+  static uint64_t bucketStart(int bucket);
+
+  const char *m_name;
+  // the span this one was first nested in, if any
+  const ProfilerSite *m_parent = nullptr;
+  uint64_t m_calls = 0;
+  uint64_t m_total_ticks = 0;
+  uint64_t m_self_ticks = 0;
+  uint64_t m_max_ticks = 0;
+  uint32_t m_histogram[num_buckets] = {};
+  uint64_t m_allocations = 0;
+  uint64_t m_allocated_bytes = 0;
+};
+
+class ProfilerScope {
+ public:
+  explicit ProfilerScope(ProfilerSite &site) : m_site(site), m_parent(s_current) {
+    if (m_parent != nullptr && m_site.m_parent == nullptr) {
+      m_site.m_parent = &m_parent->m_site;
+    }
+    s_current = this;
+#ifdef RANGERBOT_TRACK_ALLOCATIONS
+    m_start_allocations = allocation_totals.allocations;
+    m_start_bytes = allocation_totals.bytes;
+#endif
+    m_start = profiler_ticks();
+  }
+
+  ~ProfilerScope() {
+    const uint64_t ticks = profiler_ticks() - m_start;
+    s_current = m_parent;
+    if (m_parent != nullptr) {
+      m_parent->m_child_ticks += ticks;
+    }
+    m_site.record(ticks, ticks - m_child_ticks);
+#ifdef RANGERBOT_TRACK_ALLOCATIONS
+    m_site.m_allocations += allocation_totals.allocations - m_start_allocations;
+    m_site.m_allocated_bytes += allocation_totals.bytes - m_start_bytes;
+#endif
+  }
+
+  ProfilerScope(const ProfilerScope &) = delete;
+
+  ProfilerScope &operator=(const ProfilerScope &) = delete;
+
+ private:
+  // the innermost open span. the bot is single threaded.
+  static ProfilerScope *s_current;
+
+  ProfilerSite &m_site;
+  ProfilerScope *m_parent;
+  uint64_t m_start;
+  uint64_t m_child_ticks = 0;
+#ifdef RANGERBOT_TRACK_ALLOCATIONS
+  uint64_t m_start_allocations;
+  uint64_t m_start_bytes;
+#endif
+};
+
+void profiler_open_report(const char *path);
+
+void profiler_write_report();
+
+#endif
+
+#endif //RANGERBOT_PROFILER_H
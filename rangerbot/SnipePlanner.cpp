@@ -0,0 +1,116 @@
+
+#include "SnipePlanner.h"
+
+#include <algorithm>
+
+using std::vector;
+
+const unsigned int SnipePlanner::structure_memory;
+
+void SnipePlanner::observe(unsigned int id, int x, int y, unsigned int health, unsigned int priority,
+                           bool is_structure, unsigned int round) {
+  Sighting sighting{x, y, health, priority, is_structure, round, round};
+  auto previous = m_forgotten.find(id);
+  if (previous == m_forgotten.end()) {
+    previous = m_sightings.find(id);
+    if (previous == m_sightings.end()) {
+      m_sightings[id] = sighting;
+      return;
+    }
+  }
+  if (previous->second.x == x && previous->second.y == y) {
+    sighting.still_since = previous->second.still_since;
+  }
+  m_sightings[id] = sighting;
+}
+
+unsigned int SnipePlanner::snipesInFlightAt(int x, int y) const {
+  unsigned int count = 0;
+  for (const InFlight &snipe : m_in_flight) {
+    if (snipe.x == x && snipe.y == y) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+void SnipePlanner::plan(const vector<unsigned int> &ranger_ids, unsigned int damage, unsigned int round,
+                        unsigned int lead_time, unsigned int last_round, vector<Snipe> &snipes) {
+  snipes.clear();
+  forgetLanded(round);
+  if (ranger_ids.empty() || damage == 0 || round + lead_time > last_round) {
+    return;
+  }
+  forgetUnseen(round, lead_time);
+
+  m_candidates.clear();
+  for (const auto &id_and_sighting : m_sightings) {
+    const Sighting &sighting = id_and_sighting.second;
+    // a robot that's sat still for as long as the snipe takes will probably sit still a while longer
+    if (sighting.is_structure || round - sighting.still_since >= lead_time) {
+      m_candidates.push_back(&sighting);
+    }
+  }
+  // best value per snipe first
+  std::sort(m_candidates.begin(), m_candidates.end(), [damage](const Sighting *a, const Sighting *b) {
+    unsigned int a_snipes = (a->health + damage - 1) / damage;
+    unsigned int b_snipes = (b->health + damage - 1) / damage;
+    return a->priority * b_snipes > b->priority * a_snipes;
+  });
+
+  size_t next_ranger = 0;
+  for (const Sighting *sighting : m_candidates) {
+    unsigned int needed = (sighting->health + damage - 1) / damage;
+    // stale memories can put two enemies on one tile, so count what this plan already sends there too
+    unsigned int in_flight = snipesInFlightAt(sighting->x, sighting->y);
+    for (const Snipe &snipe : snipes) {
+      if (snipe.x == sighting->x && snipe.y == sighting->y) {
+        ++in_flight;
+      }
+    }
+    for (unsigned int i = in_flight; i < needed && next_ranger < ranger_ids.size(); ++i) {
+      snipes.push_back(Snipe{ranger_ids[next_ranger++], sighting->x, sighting->y});
+    }
+    if (next_ranger == ranger_ids.size()) {
+      break;
+    }
+  }
+}
+
+void SnipePlanner::begun(const Snipe &snipe, unsigned int land_round, unsigned int damage) {
+  m_in_flight.push_back(InFlight{snipe.x, snipe.y, land_round, damage});
+}
+
+void SnipePlanner::forgetLanded(unsigned int round) {
+  for (const InFlight &snipe : m_in_flight) {
+    if (snipe.land_round >= round) {
+      continue;
+    }
+    // snipes land at the end of the round, so anything seen after that already shows the damage
+    for (auto it = m_sightings.begin(); it != m_sightings.end(); ++it) {
+      Sighting &sighting = it->second;
+      if (sighting.x == snipe.x && sighting.y == snipe.y && sighting.last_seen <= snipe.land_round) {
+        if (sighting.health <= snipe.damage) {
+          m_sightings.erase(it);
+        } else {
+          sighting.health -= snipe.damage;
+        }
+        break;
+      }
+    }
+  }
+  m_in_flight.erase(std::remove_if(m_in_flight.begin(), m_in_flight.end(),
+                                   [round](const InFlight &snipe) { return snipe.land_round < round; }),
+                    m_in_flight.end());
+}
+
+void SnipePlanner::forgetUnseen(unsigned int round, unsigned int lead_time) {
+  for (auto it = m_sightings.begin(); it != m_sightings.end();) {
+    const Sighting &sighting = it->second;
+    if (round - sighting.last_seen > (sighting.is_structure ? structure_memory : lead_time)) {
+      m_sightings.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+}
@@ -0,0 +1,96 @@
+#ifndef RANGERBOT_SNIPEPLANNER_H
+#define RANGERBOT_SNIPEPLANNER_H
+
+#include <map>
+#include <vector>
+
+/*
+ * Remembers where enemies have been seen sitting still, and hands those tiles out to idle rangers as snipe targets.
+ * A snipe only lands after a long countdown, so only things that will probably still be there are worth it:
+ * structures, and robots that have already sat in one place for about as long as the countdown. Each tile gets just
+ * enough snipes in flight to kill what's on it.
+ *
+ * Memories of tiles we can't see fade: a snipe that lands there takes its damage off what we remember, and robots
+ * unseen for a whole countdown (structures for structure_memory rounds) are forgotten.
+ */
+class SnipePlanner {
+ public:
+  // rounds an unseen structure is remembered. robots are remembered for one snipe countdown.
+  static const unsigned int structure_memory = 200;
+
+  struct Sighting {
+    int x;
+    int y;
+    unsigned int health;
+    // rough value of killing it, e.g. factories over rockets over robots
+    unsigned int priority;
+    bool is_structure;
+    // when it was first seen on this tile, and when it was last seen at all
+    unsigned int still_since;
+    unsigned int last_seen;
+  };
+
+  struct Snipe {
+    unsigned int ranger_id;
+    int x;
+    int y;
+  };
+
+  /*
+   * Forget every remembered enemy on a tile we can currently see, before observe()ing what's actually there now.
+   * Anything we can't see is assumed to still be wherever it was.
+   */
+  template<typename F>
+  void forgetVisible(F can_see) {
+    m_forgotten.clear();
+    for (auto it = m_sightings.begin(); it != m_sightings.end();) {
+      if (can_see(it->second.x, it->second.y)) {
+        m_forgotten[it->first] = it->second;
+        m_sightings.erase(it++);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  void observe(unsigned int id, int x, int y, unsigned int health, unsigned int priority, bool is_structure,
+               unsigned int round);
+
+  /*
+   * Assign snipes to some of the given rangers, all of which must be ready to snipe. lead_time is the number of
+   * rounds before a snipe begun now lands, and last_round the last round of the game.
+   */
+  void plan(const std::vector<unsigned int> &ranger_ids, unsigned int damage, unsigned int round,
+            unsigned int lead_time, unsigned int last_round, std::vector<Snipe> &snipes);
+
+  /*
+   * Record that a snipe was actually started.
+   */
+  void begun(const Snipe &snipe, unsigned int land_round, unsigned int damage);
+
+ private:
+  struct InFlight {
+    int x;
+    int y;
+    unsigned int land_round;
+    unsigned int damage;
+  };
+
+  unsigned int snipesInFlightAt(int x, int y) const;
+
+  /*
+   * Drop snipes that have landed, taking their damage off whatever we remember on tiles we haven't seen since.
+   */
+  void forgetLanded(unsigned int round);
+
+  void forgetUnseen(unsigned int round, unsigned int lead_time);
+
+  std::map<unsigned int, Sighting> m_sightings;
+  // things forgotten this turn, so a robot that's still on its tile keeps its still_since
+  std::map<unsigned int, Sighting> m_forgotten;
+  std::vector<InFlight> m_in_flight;
+  std::vector<const Sighting *> m_candidates;
+};
+
+
+#endif //RANGERBOT_SNIPEPLANNER_H
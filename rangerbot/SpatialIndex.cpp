@@ -0,0 +1,34 @@
+
+#include "SpatialIndex.h"
+
+#include "Util.hpp"
+
+void SpatialIndex::reset(int rows, int cols) {
+  m_cell_rows = pos_int_div_ceil(rows, cell_size);
+  m_cell_cols = pos_int_div_ceil(cols, cell_size);
+  m_unsorted.clear();
+  m_cell_starts.assign(m_cell_rows * m_cell_cols + 1, 0);
+}
+
+void SpatialIndex::insert(int x, int y, unsigned int item) {
+  m_unsorted.push_back(Entry{x, y, item});
+}
+
+void SpatialIndex::build() {
+  // counting sort by cell
+  for (const Entry &entry : m_unsorted) {
+    ++m_cell_starts[cellOf(entry.x, entry.y) + 1];
+  }
+  for (size_t cell = 1; cell < m_cell_starts.size(); ++cell) {
+    m_cell_starts[cell] += m_cell_starts[cell - 1];
+  }
+  m_sorted.resize(m_unsorted.size());
+  // m_cell_starts[cell] is used as a cursor, so afterwards it points to the end of each cell. Shift it back.
+  for (const Entry &entry : m_unsorted) {
+    m_sorted[m_cell_starts[cellOf(entry.x, entry.y)]++] = entry;
+  }
+  for (size_t cell = m_cell_starts.size() - 1; cell > 0; --cell) {
+    m_cell_starts[cell] = m_cell_starts[cell - 1];
+  }
+  m_cell_starts[0] = 0;
+}
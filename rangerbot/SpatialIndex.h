@@ -0,0 +1,76 @@
+#ifndef RANGERBOT_SPATIALINDEX_H
+#define RANGERBOT_SPATIALINDEX_H
+
+#include <algorithm>
+#include <vector>
+
+/*
+ * Bucket grid for "what's within range of this tile" queries. Items are just indices into some array the caller
+ * owns. All the buffers are kept between turns, so after the first few turns rebuilding doesn't allocate.
+ *
+ * Usage: reset(), insert() everything, build(), then query with forEachWithin().
+ */
+class SpatialIndex {
+ public:
+  // a bit more than the ranger attack radius, so most queries only touch a 3x3 block of cells
+  static const int cell_size = 8;
+
+  void reset(int rows, int cols);
+
+  void insert(int x, int y, unsigned int item);
+
+  /*
+   * Sort the inserted items into their cells. Must be called before querying.
+   */
+  void build();
+
+  /*
+   * Call f(item, distance_squared) for every item within range_sq of (x, y).
+   */
+  template<typename F>
+  void forEachWithin(int x, int y, unsigned int range_sq, F f) const {
+    int reach = 0;
+    while (static_cast<unsigned int>(reach * reach) < range_sq) {
+      ++reach;
+    }
+    const int min_cell_r = std::max(0, (y - reach) / cell_size);
+    const int max_cell_r = std::min(m_cell_rows - 1, (y + reach) / cell_size);
+    const int min_cell_c = std::max(0, (x - reach) / cell_size);
+    const int max_cell_c = std::min(m_cell_cols - 1, (x + reach) / cell_size);
+    for (int cell_r = min_cell_r; cell_r <= max_cell_r; ++cell_r) {
+      for (int cell_c = min_cell_c; cell_c <= max_cell_c; ++cell_c) {
+        const int cell = cell_r * m_cell_cols + cell_c;
+        for (unsigned int i = m_cell_starts[cell]; i < m_cell_starts[cell + 1]; ++i) {
+          const Entry &entry = m_sorted[i];
+          const int dx = entry.x - x;
+          const int dy = entry.y - y;
+          const auto distsq = static_cast<unsigned int>(dx * dx + dy * dy);
+          if (distsq <= range_sq) {
+            f(entry.item, distsq);
+          }
+        }
+      }
+    }
+  }
+
+ private:
+  struct Entry {
+    int x;
+    int y;
+    unsigned int item;
+  };
+
+  int cellOf(int x, int y) const {
+    return (y / cell_size) * m_cell_cols + x / cell_size;
+  }
+
+  int m_cell_rows = 0;
+  int m_cell_cols = 0;
+  std::vector<Entry> m_unsorted;
+  std::vector<Entry> m_sorted;
+  // CSR offsets into m_sorted, one past the end for the last cell
+  std::vector<unsigned int> m_cell_starts;
+};
+
+
+#endif //RANGERBOT_SPATIALINDEX_H
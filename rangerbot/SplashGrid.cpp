@@ -0,0 +1,119 @@
+
+#include "SplashGrid.h"
+
+#include <algorithm>
+
+void SplashGrid::reset(int rows, int cols, float mage_damage) {
+  m_rows = rows;
+  m_cols = cols;
+  m_stride = cols + 2;
+  m_mage_damage = mage_damage;
+  const size_t size = static_cast<size_t>((rows + 2) * m_stride);
+  m_enemy_health.assign(size, 0.0f);
+  m_enemy_defense.assign(size, 0.0f);
+  m_ally_health.assign(size, 0.0f);
+  m_enemy_ids.assign(size, 0);
+  m_has_enemy.assign(size, false);
+  m_damage_dealt.assign(size, 0.0f);
+  m_tile_value.assign(size, 0.0f);
+  m_row_sum.assign(size, 0.0f);
+  m_splash_value.assign(size, 0.0f);
+}
+
+void SplashGrid::addEnemy(int x, int y, unsigned int id, float health, float defense) {
+  int i = index(x, y);
+  m_enemy_health[i] = health;
+  m_enemy_defense[i] = defense;
+  m_enemy_ids[i] = id;
+  m_has_enemy[i] = true;
+}
+
+void SplashGrid::addAlly(int x, int y, float health) {
+  m_ally_health[index(x, y)] = health;
+}
+
+void SplashGrid::compute() {
+  tileValues(0, 0, m_cols - 1, m_rows - 1);
+  boxSum(0, 0, m_cols - 1, m_rows - 1);
+}
+
+void SplashGrid::tileValues(int min_x, int min_y, int max_x, int max_y) {
+  const float damage = m_mage_damage;
+  const float bonus = kill_bonus;
+  const float penalty = friendly_fire_weight;
+  for (int y = min_y; y <= max_y; ++y) {
+    const float *enemy = &m_enemy_health[index(0, y)];
+    const float *defense = &m_enemy_defense[index(0, y)];
+    const float *ally = &m_ally_health[index(0, y)];
+    float *value = &m_tile_value[index(0, y)];
+    // branch-free, so this vectorizes
+    for (int x = min_x; x <= max_x; ++x) {
+      const float hit = std::max(damage - defense[x], 0.0f);
+      const float enemy_damage = std::min(enemy[x], hit);
+      const float kill = (enemy[x] > 0.0f && enemy[x] <= hit) ? bonus : 0.0f;
+      value[x] = enemy_damage + kill - penalty * std::min(ally[x], damage);
+    }
+  }
+}
+
+void SplashGrid::boxSum(int min_x, int min_y, int max_x, int max_y) {
+  // separable: horizontal 3-sums (one extra row each way, for the vertical pass), then vertical 3-sums
+  for (int y = std::max(min_y - 1, 0); y <= std::min(max_y + 1, m_rows - 1); ++y) {
+    const float *value = &m_tile_value[index(0, y)];
+    float *row_sum = &m_row_sum[index(0, y)];
+    for (int x = min_x; x <= max_x; ++x) {
+      row_sum[x] = value[x - 1] + value[x] + value[x + 1];
+    }
+  }
+  for (int y = min_y; y <= max_y; ++y) {
+    const float *above = &m_row_sum[index(0, y - 1)];
+    const float *row = &m_row_sum[index(0, y)];
+    const float *below = &m_row_sum[index(0, y + 1)];
+    float *splash = &m_splash_value[index(0, y)];
+    for (int x = min_x; x <= max_x; ++x) {
+      splash[x] = above[x] + row[x] + below[x];
+    }
+  }
+}
+
+bool SplashGrid::bestTargetInRange(int x, int y, unsigned int range_sq, int &target_x, int &target_y) const {
+  int reach = 0;
+  while (static_cast<unsigned int>(reach * reach) < range_sq) {
+    ++reach;
+  }
+  float best_value = 0.0f;
+  bool found = false;
+  for (int ty = std::max(y - reach, 0); ty <= std::min(y + reach, m_rows - 1); ++ty) {
+    for (int tx = std::max(x - reach, 0); tx <= std::min(x + reach, m_cols - 1); ++tx) {
+      const int i = index(tx, ty);
+      if (!m_has_enemy[i] || m_enemy_health[i] <= 0.0f) {
+        continue;
+      }
+      const auto distsq = static_cast<unsigned int>((tx - x) * (tx - x) + (ty - y) * (ty - y));
+      if (distsq <= range_sq && m_splash_value[i] > best_value) {
+        best_value = m_splash_value[i];
+        target_x = tx;
+        target_y = ty;
+        found = true;
+      }
+    }
+  }
+  return found;
+}
+
+void SplashGrid::applySplash(int x, int y) {
+  for (int ty = std::max(y - 1, 0); ty <= std::min(y + 1, m_rows - 1); ++ty) {
+    for (int tx = std::max(x - 1, 0); tx <= std::min(x + 1, m_cols - 1); ++tx) {
+      const int i = index(tx, ty);
+      const float hit = std::max(m_mage_damage - m_enemy_defense[i], 0.0f);
+      if (m_enemy_health[i] > 0.0f) {
+        m_damage_dealt[i] += hit;
+      }
+      m_enemy_health[i] = std::max(m_enemy_health[i] - hit, 0.0f);
+      m_ally_health[i] = std::max(m_ally_health[i] - m_mage_damage, 0.0f);
+    }
+  }
+  // only sums within 2 tiles of the target could have changed
+  tileValues(std::max(x - 1, 0), std::max(y - 1, 0), std::min(x + 1, m_cols - 1), std::min(y + 1, m_rows - 1));
+  boxSum(std::max(x - 2, 0), std::max(y - 2, 0), std::min(x + 2, m_cols - 1), std::min(y + 2, m_rows - 1));
+}
@@ -0,0 +1,77 @@
+#ifndef RANGERBOT_SPLASHGRID_H
+#define RANGERBOT_SPLASHGRID_H
+
+#include <vector>
+
+/*
+ * How much good a mage does by attacking each tile. A mage's attack hits every unit in the 3x3 square around its
+ * target, allies included, so the value of a tile is a 3x3 box sum of (damage that would land on enemies) minus a
+ * penalty for damage that would land on allies. Built once per turn and shared by every mage.
+ *
+ * Usage: reset(), addEnemy()/addAlly() everything, compute(), then bestTargetInRange() and applySplash() for each
+ * mage in turn.
+ */
+class SplashGrid {
+ public:
+  // friendly fire counts for more than damage to the enemy, since we'd rather not risk it
+  const float friendly_fire_weight = 1.5f;
+  // on top of the damage, killing something is worth this much
+  const float kill_bonus = 30.0f;
+
+  void reset(int rows, int cols, float mage_damage);
+
+  /*
+   * defense is taken off every hit the enemy takes, as for knights.
+   */
+  void addEnemy(int x, int y, unsigned int id, float health, float defense);
+
+  void addAlly(int x, int y, float health);
+
+  void compute();
+
+  /*
+   * Finds the enemy within range_sq of (x, y) whose tile has the highest splash value. Returns false if there's no
+   * enemy in range worth hitting.
+   */
+  bool bestTargetInRange(int x, int y, unsigned int range_sq, int &target_x, int &target_y) const;
+
+  unsigned int enemyAt(int x, int y) const { return m_enemy_ids[index(x, y)]; }
+
+  float valueAt(int x, int y) const { return m_splash_value[index(x, y)]; }
+
+  /*
+   * Record a mage attack on (x, y), so later mages in the same turn see the damaged (or dead) enemies.
+   */
+  void applySplash(int x, int y);
+
+  /*
+   * Total splash damage dealt to the tile this turn.
+   */
+  float damageDealtAt(int x, int y) const { return m_damage_dealt[index(x, y)]; }
+
+ private:
+  // the grid has a 1-tile border, so the 3x3 sums never need bounds checks
+  int index(int x, int y) const { return (y + 1) * m_stride + (x + 1); }
+
+  void tileValues(int min_x, int min_y, int max_x, int max_y);
+
+  void boxSum(int min_x, int min_y, int max_x, int max_y);
+
+  int m_rows = 0;
+  int m_cols = 0;
+  int m_stride = 0;
+  float m_mage_damage = 0.0f;
+  std::vector<float> m_enemy_health;
+  std::vector<float> m_enemy_defense;
+  std::vector<float> m_ally_health;
+  std::vector<unsigned int> m_enemy_ids;
+  std::vector<bool> m_has_enemy;
+  std::vector<float> m_damage_dealt;
+  // value of hitting each single tile, then its horizontal 3-sums, then the full 3x3 sums
+  std::vector<float> m_tile_value;
+  std::vector<float> m_row_sum;
+  std::vector<float> m_splash_value;
+};
+
+
+#endif //RANGERBOT_SPLASHGRID_H
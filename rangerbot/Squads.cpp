@@ -0,0 +1,98 @@
+
+#include "Squads.h"
+
+#include <algorithm>
+#include <set>
+
+using std::map;
+using std::vector;
+
+void SquadClusterer::reset(int rows, int cols) {
+  m_index.reset(rows, cols);
+  m_members.clear();
+}
+
+void SquadClusterer::add(unsigned int unit_id, int x, int y) {
+  m_index.insert(x, y, static_cast<unsigned int>(m_members.size()));
+  m_members.push_back(Member{unit_id, x, y});
+}
+
+unsigned int SquadClusterer::find(unsigned int item) {
+  while (m_parent[item] != item) {
+    // path halving
+    m_parent[item] = m_parent[m_parent[item]];
+    item = m_parent[item];
+  }
+  return item;
+}
+
+void SquadClusterer::cluster() {
+  m_index.build();
+  const auto num_members = static_cast<unsigned int>(m_members.size());
+  m_parent.resize(num_members);
+  for (unsigned int i = 0; i < num_members; ++i) {
+    m_parent[i] = i;
+  }
+  for (unsigned int i = 0; i < num_members; ++i) {
+    m_index.forEachWithin(m_members[i].x, m_members[i].y, squad_link_range_sq, [&](unsigned int j, unsigned int) {
+      unsigned int a = find(i);
+      unsigned int b = find(j);
+      if (a != b) {
+        m_parent[std::max(a, b)] = std::min(a, b);
+      }
+    });
+  }
+
+  // gather each component, in order of its first member
+  m_squads.clear();
+  map<unsigned int, size_t> root_to_squad;
+  for (unsigned int i = 0; i < num_members; ++i) {
+    unsigned int root = find(i);
+    auto it = root_to_squad.find(root);
+    if (it == root_to_squad.end()) {
+      it = root_to_squad.emplace(root, m_squads.size()).first;
+      m_squads.push_back(Squad{0, {}});
+    }
+    m_squads[it->second].members.push_back(i);
+  }
+
+  // each squad takes whichever old id most of its members had, if nobody bigger took it first
+  vector<size_t> by_size(m_squads.size());
+  for (size_t s = 0; s < m_squads.size(); ++s) {
+    by_size[s] = s;
+  }
+  std::stable_sort(by_size.begin(), by_size.end(), [this](size_t a, size_t b) {
+    return m_squads[a].members.size() > m_squads[b].members.size();
+  });
+  std::set<unsigned int> taken;
+  for (size_t s : by_size) {
+    Squad &squad = m_squads[s];
+    map<unsigned int, unsigned int> votes;
+    for (unsigned int member : squad.members) {
+      auto last = m_last_squad.find(m_members[member].unit_id);
+      if (last != m_last_squad.end() && !taken.count(last->second)) {
+        ++votes[last->second];
+      }
+    }
+    unsigned int best_votes = 0;
+    unsigned int best_id = m_next_squad_id;
+    for (const auto &id_and_votes : votes) {
+      if (id_and_votes.second > best_votes) {
+        best_votes = id_and_votes.second;
+        best_id = id_and_votes.first;
+      }
+    }
+    if (best_id == m_next_squad_id) {
+      ++m_next_squad_id;
+    }
+    squad.id = best_id;
+    taken.insert(best_id);
+  }
+
+  m_last_squad.clear();
+  for (const Squad &squad : m_squads) {
+    for (unsigned int member : squad.members) {
+      m_last_squad[m_members[member].unit_id] = squad.id;
+    }
+  }
+}
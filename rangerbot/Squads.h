@@ -0,0 +1,55 @@
+#ifndef RANGERBOT_SQUADS_H
+#define RANGERBOT_SQUADS_H
+
+#include <map>
+#include <vector>
+
+#include "SpatialIndex.h"
+
+/*
+ * Groups nearby units into squads each turn: any two units within squad_link_range_sq of each other end up in the
+ * same squad (grid DBSCAN with a minimum of one point, i.e. connected components). Squads keep their ids from turn
+ * to turn as long as most of their members stick around, so callers can hang per-squad state off them.
+ *
+ * Usage: reset(), add() every unit, cluster(), then read squads().
+ */
+class SquadClusterer {
+ public:
+  // about two king's moves between neighbors
+  const unsigned int squad_link_range_sq = 8;
+
+  struct Squad {
+    unsigned int id;
+    // indices in the order the units were add()ed
+    std::vector<unsigned int> members;
+  };
+
+  void reset(int rows, int cols);
+
+  void add(unsigned int unit_id, int x, int y);
+
+  void cluster();
+
+  const std::vector<Squad> &squads() const { return m_squads; }
+
+ private:
+  unsigned int find(unsigned int item);
+
+  struct Member {
+    unsigned int unit_id;
+    int x;
+    int y;
+  };
+
+  SpatialIndex m_index;
+  std::vector<Member> m_members;
+  // union-find
+  std::vector<unsigned int> m_parent;
+  std::vector<Squad> m_squads;
+  // unit id to squad id, as of the last cluster()
+  std::map<unsigned int, unsigned int> m_last_squad;
+  unsigned int m_next_squad_id = 0;
+};
+
+
+#endif //RANGERBOT_SQUADS_H
@@ -0,0 +1,74 @@
+
+#include "ThreatMap.h"
+
+#include <algorithm>
+
+using std::vector;
+
+void ThreatMap::rowReach(unsigned int range_sq, bool enemies_can_step) {
+  int reach = 0;
+  while (static_cast<unsigned int>((reach + 1) * (reach + 1)) <= range_sq) {
+    ++reach;
+  }
+  // m_row_reach[dy] is the largest dx with dx^2 + dy^2 <= range_sq. one extra row of -1 for the step below.
+  m_row_reach.assign(static_cast<size_t>(reach + 3), -1);
+  for (int dy = 0; dy <= reach; ++dy) {
+    int dx = reach;
+    while (static_cast<unsigned int>(dx * dx + dy * dy) > range_sq) {
+      --dx;
+    }
+    m_row_reach[dy] = dx;
+  }
+  if (enemies_can_step) {
+    // anything within range of one of the 9 tiles around the enemy: take the widest of the neighbouring rows, plus one
+    vector<int> stepped(m_row_reach.size(), -1);
+    for (int dy = 0; dy < static_cast<int>(m_row_reach.size()); ++dy) {
+      int widest = m_row_reach[dy];
+      if (dy > 0) {
+        widest = std::max(widest, m_row_reach[dy - 1]);
+      } else if (m_row_reach.size() > 1) {
+        widest = std::max(widest, m_row_reach[1]);
+      }
+      if (dy + 1 < static_cast<int>(m_row_reach.size())) {
+        widest = std::max(widest, m_row_reach[dy + 1]);
+      }
+      stepped[dy] = widest >= 0 ? widest + 1 : -1;
+    }
+    m_row_reach.swap(stepped);
+  }
+}
+
+void ThreatMap::compute(const vector<Threat> &threats, int rows, int cols, bool enemies_can_step) {
+  m_rows = rows;
+  m_cols = cols;
+  m_threat.assign(static_cast<size_t>(rows * cols), 0);
+  unsigned int last_range_sq = 0;
+  bool have_reach = false;
+  for (const Threat &threat : threats) {
+    if (threat.damage <= 0) {
+      continue;
+    }
+    // units of one type share a range, so this rarely gets recomputed
+    if (!have_reach || threat.range_sq != last_range_sq) {
+      rowReach(threat.range_sq, enemies_can_step);
+      last_range_sq = threat.range_sq;
+      have_reach = true;
+    }
+    const int num_rows = static_cast<int>(m_row_reach.size());
+    for (int dy = -(num_rows - 1); dy < num_rows; ++dy) {
+      const int y = threat.y + dy;
+      const int reach = m_row_reach[dy < 0 ? -dy : dy];
+      if (y < 0 || y >= rows || reach < 0) {
+        continue;
+      }
+      const int min_x = std::max(threat.x - reach, 0);
+      const int max_x = std::min(threat.x + reach, cols - 1);
+      int *row = &m_threat[y * cols];
+      const int damage = threat.damage;
+      // contiguous span, so this vectorizes
+      for (int x = min_x; x <= max_x; ++x) {
+        row[x] += damage;
+      }
+    }
+  }
+}
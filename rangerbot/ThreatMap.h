@@ -0,0 +1,34 @@
+#ifndef RANGERBOT_THREATMAP_H
+#define RANGERBOT_THREATMAP_H
+
+#include <vector>
+
+/*
+ * Per-tile sum of the damage enemies could do there. With enemies_can_step, each enemy's range is grown by one king's
+ * move, to cover where it could shoot after its next move.
+ */
+class ThreatMap {
+ public:
+  struct Threat {
+    int x;
+    int y;
+    int damage;
+    unsigned int range_sq;
+  };
+
+  void compute(const std::vector<Threat> &threats, int rows, int cols, bool enemies_can_step);
+
+  int at(int x, int y) const { return m_threat[y * m_cols + x]; }
+
+ private:
+  // how far a range_sq disc reaches along each row, from dy = 0 outward
+  void rowReach(unsigned int range_sq, bool enemies_can_step);
+
+  int m_rows = 0;
+  int m_cols = 0;
+  std::vector<int> m_threat;
+  std::vector<int> m_row_reach;
+};
+
+
+#endif //RANGERBOT_THREATMAP_H
@@ -0,0 +1,85 @@
+
+#include "TimeBank.h"
+
+#include <algorithm>
+
+using std::vector;
+
+const unsigned int TimeBank::per_round_ms;
+
+TimeBank::TimeBank(unsigned int safety_margin_ms, unsigned int last_round)
+    : m_safety_margin_ms(safety_margin_ms), m_last_round(last_round) {}
+
+void TimeBank::beginTurn(unsigned int round, unsigned int time_left_ms) {
+  // the first turn also pays for the precompute before the game loop, so it says nothing about later turns
+  if (m_round > 1) {
+    const double earned_ms = static_cast<double>((round - m_round) * per_round_ms);
+    const double took_ms = std::max(0.0, m_time_left_ms + earned_ms - time_left_ms);
+    double &estimate_ms = m_spike ? m_spike_ms : m_quiet_ms;
+    estimate_ms = estimate_ms == 0.0 ? took_ms : estimate_ms + estimate_weight * (took_ms - estimate_ms);
+  }
+  m_turn_start = std::chrono::steady_clock::now();
+  m_round = round;
+  m_time_left_ms = time_left_ms;
+  m_spike = false;
+
+  // the spike for this round is happening now, so the time held back for it can be spent
+  m_expected_spikes.erase(std::remove_if(m_expected_spikes.begin(), m_expected_spikes.end(), [round](unsigned int r) {
+    return r <= round;
+  }), m_expected_spikes.end());
+
+  // the quiet turns before each spike pay for part of it. hold back whatever they can't, for the worst of the spikes
+  // counted together with the ones before it.
+  const double income_ms = std::max(0.0, per_round_ms - m_quiet_ms);
+  const double extra_ms = std::max(0.0, spikeTurnMs() - per_round_ms);
+  double needed_ms = 0.0;
+  double reserved_ms = 0.0;
+  for (unsigned int spike_round : m_expected_spikes) {
+    if (spike_round > round + spike_horizon || spike_round > m_last_round) {
+      break;
+    }
+    needed_ms += extra_ms;
+    reserved_ms = std::max(reserved_ms, needed_ms - (spike_round - round) * income_ms);
+  }
+  m_reserved_ms = static_cast<unsigned int>(reserved_ms);
+}
+
+void TimeBank::markSpike() {
+  m_spike = true;
+}
+
+void TimeBank::expectSpike(unsigned int round) {
+  if (round <= m_round) {
+    markSpike();
+    return;
+  }
+  auto iter = std::lower_bound(m_expected_spikes.begin(), m_expected_spikes.end(), round);
+  if (iter == m_expected_spikes.end() || *iter != round) {
+    m_expected_spikes.insert(iter, round);
+  }
+}
+
+double TimeBank::elapsedMs() const {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_turn_start).count();
+}
+
+unsigned int TimeBank::timeLeftMs() const {
+  const double elapsed_ms = elapsedMs();
+  return elapsed_ms < m_time_left_ms ? static_cast<unsigned int>(m_time_left_ms - elapsed_ms) : 0;
+}
+
+unsigned int TimeBank::reserveMs() const {
+  return m_safety_margin_ms + m_reserved_ms;
+}
+
+unsigned int TimeBank::surplusMs() const {
+  const double rest_of_turn_ms = std::max(0.0, (m_spike ? spikeTurnMs() : m_quiet_ms) - elapsedMs());
+  const double surplus_ms = static_cast<double>(timeLeftMs()) - reserveMs() - rest_of_turn_ms;
+  return surplus_ms > 0.0 ? static_cast<unsigned int>(surplus_ms) : 0;
+}
+
+unsigned int TimeBank::grant(unsigned int wanted_ms) const {
+  // near the end of the game there's nothing left to save for
+  const unsigned int rounds_left = m_round < m_last_round ? m_last_round - m_round : 1;
+  return std::min(wanted_ms, surplusMs() / std::min(surplus_fraction, rounds_left));
+}
@@ -0,0 +1,70 @@
+#ifndef RANGERBOT_TIMEBANK_H
+#define RANGERBOT_TIMEBANK_H
+
+#include <chrono>
+#include <vector>
+
+/*
+ * Decides how much of the time bank the bot can afford to spend. It measures how long turns take, keeping quiet
+ * turns and fights separate, and holds back time for fights it's been told are coming, on top of a safety margin the
+ * bank never goes below. Whatever is left is surplus, which anytime algorithms like the micro search can ask for with
+ * grant(). They only get a slice of it per turn, so quiet turns bank time instead of spending it all at once.
+ *
+ * Usage: beginTurn() at the top of every turn, then query it from the subsystems.
+ */
+class TimeBank {
+ public:
+  // the game adds this much to the bank every round
+  static const unsigned int per_round_ms = 50;
+
+  TimeBank(unsigned int safety_margin_ms, unsigned int last_round);
+
+  void beginTurn(unsigned int round, unsigned int time_left_ms);
+
+  // this turn is a fight, so it shouldn't count towards how long a quiet turn takes
+  void markSpike();
+
+  // a fight is expected around this round. time for it gets held back until then.
+  void expectSpike(unsigned int round);
+
+  // the bank can't go below this without risking the rest of this turn or the spikes we're expecting
+  unsigned int reserveMs() const;
+
+  // how much is left in the bank over the reserve, after what the rest of a normal turn takes
+  unsigned int surplusMs() const;
+
+  // how much an anytime algorithm may spend right now, at most wanted_ms. 0 means don't bother.
+  unsigned int grant(unsigned int wanted_ms) const;
+
+  double quietTurnMs() const { return m_quiet_ms; }
+
+  double spikeTurnMs() const { return m_spike_ms == 0.0 ? initial_spike_ms : m_spike_ms; }
+
+ private:
+  // weight of the latest measurement in the running turn cost estimates
+  const double estimate_weight = 0.1;
+  // what we assume a fight turn costs until we've measured one
+  const double initial_spike_ms = 200.0;
+  // spikes further out than this get no time held back yet
+  const unsigned int spike_horizon = 50;
+  // anytime algorithms get at most this fraction of the surplus per turn
+  const unsigned int surplus_fraction = 8;
+
+  double elapsedMs() const;
+
+  unsigned int timeLeftMs() const;
+
+  const unsigned int m_safety_margin_ms;
+  const unsigned int m_last_round;
+  unsigned int m_round = 0;
+  unsigned int m_time_left_ms = 0;
+  bool m_spike = false;
+  double m_quiet_ms = 0.0;
+  double m_spike_ms = 0.0;
+  unsigned int m_reserved_ms = 0;
+  std::vector<unsigned int> m_expected_spikes;
+  std::chrono::steady_clock::time_point m_turn_start;
+};
+
+
+#endif //RANGERBOT_TIMEBANK_H
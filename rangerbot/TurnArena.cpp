@@ -0,0 +1,61 @@
+
+#include "TurnArena.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include "Debug.h"
+
+using std::endl;
+
+const size_t TurnArena::capacity;
+
+TurnArena TurnArena::s_instance;
+
+TurnArena::TurnArena() : m_block(static_cast<uint8_t *>(malloc(capacity))) {
+  // the pages only get touched as they're used, so reserving all of it up front is cheap
+}
+
+void *TurnArena::allocate(size_t size, size_t alignment) {
+  const size_t start = (m_top + alignment - 1) & ~(alignment - 1);
+  if (m_block == nullptr || start + size > capacity) {
+    ++m_fallbacks;
+    ++m_total_fallbacks;
+    void *pointer = malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr) {
+      abort();
+    }
+    return pointer;
+  }
+  m_top = start + size;
+  if (m_top > m_high_water) {
+    m_high_water = m_top;
+  }
+  return m_block + start;
+}
+
+void TurnArena::deallocate(void *pointer, size_t size) {
+  uint8_t *bytes = static_cast<uint8_t *>(pointer);
+  if (m_block == nullptr || bytes < m_block || bytes >= m_block + capacity) {
+    free(pointer);
+    return;
+  }
+  if (bytes + size == m_block + m_top) {
+    m_top = bytes - m_block;
+  }
+}
+
+void TurnArena::reset() {
+  if (m_fallbacks > 0) {
+    LOG("Turn arena ran out of its " << capacity << " bytes, " << m_fallbacks << " allocations fell back to malloc"
+        << endl);
+  }
+#ifndef NDEBUG
+  // anything still pointing in here is a bug, so make it obvious
+  if (m_block != nullptr) {
+    memset(m_block, 0xCD, m_high_water);
+  }
+#endif
+  m_top = 0;
+  m_fallbacks = 0;
+}
@@ -0,0 +1,94 @@
+#ifndef RANGERBOT_TURNARENA_H
+#define RANGERBOT_TURNARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <vector>
+
+/*
+ * Bump allocator for data that only lives for one turn. reset() at the top of every turn frees everything in it at
+ * once, so allocating is a pointer bump and freeing does nothing, except that freeing the last allocation hands its
+ * space back, which lets a vector that grows in place reuse it. Nothing allocated from it may outlive the turn.
+ *
+ * The block has a fixed size. Once it's full, allocations fall back to malloc and are freed normally, and the turn
+ * gets logged so the capacity can be raised.
+ *
+ * ArenaAllocator plugs it into the standard containers, and ArenaList, ArenaVector and ArenaMap are shorthands.
+ */
+class TurnArena {
+ public:
+  static const size_t capacity = 8 << 20;
+
+  static TurnArena &get() { return s_instance; }
+
+  void *allocate(size_t size, size_t alignment);
+
+  void deallocate(void *pointer, size_t size);
+
+  void reset();
+
+  size_t usedBytes() const { return m_top; }
+
+  // the most that was ever in use at once
+  size_t highWaterBytes() const { return m_high_water; }
+
+  // how many allocations didn't fit, this turn and over the whole game
+  unsigned int fallbacks() const { return m_fallbacks; }
+
+  unsigned int totalFallbacks() const { return m_total_fallbacks; }
+
+ private:
+  TurnArena();
+
+  static TurnArena s_instance;
+
+  uint8_t *m_block;
+  size_t m_top = 0;
+  size_t m_high_water = 0;
+  unsigned int m_fallbacks = 0;
+  unsigned int m_total_fallbacks = 0;
+};
+
+template<class T>
+class ArenaAllocator {
+ public:
+  typedef T value_type;
+
+  ArenaAllocator() = default;
+
+  template<class U>
+  ArenaAllocator(const ArenaAllocator<U> &) {}
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(TurnArena::get().allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T *pointer, size_t n) {
+    TurnArena::get().deallocate(pointer, n * sizeof(T));
+  }
+};
+
+// there's only the one arena, so any two allocators can free each other's memory
+template<class T, class U>
+bool operator==(const ArenaAllocator<T> &, const ArenaAllocator<U> &) {
+  return true;
+}
+
+template<class T, class U>
+bool operator!=(const ArenaAllocator<T> &, const ArenaAllocator<U> &) {
+  return false;
+}
+
+template<class T>
+using ArenaList = std::list<T, ArenaAllocator<T>>;
+
+template<class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+template<class Key, class Value>
+using ArenaMap = std::map<Key, Value, std::less<Key>, ArenaAllocator<std::pair<const Key, Value>>>;
+
+#endif //RANGERBOT_TURNARENA_H
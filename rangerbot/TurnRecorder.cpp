@@ -0,0 +1,222 @@
+
+#include "TurnRecorder.h"
+
+#ifdef RANGERBOT_RECORD
+
+#include <algorithm>
+#include <set>
+
+#include "Debug.h"
+#include "TurnTrace.h"
+
+using namespace bc;
+using std::endl;
+using std::vector;
+
+namespace {
+
+TraceWriter writer;
+bool is_open = false;
+
+// type * 16 + research level, for every combination whose stats are in the trace already
+std::set<unsigned int> written_stats;
+
+// what's been recorded for each tile of our planet, to only write the changes
+vector<uint32_t> last_karbonite;
+
+const UnitType research_branches[TraceTurn::num_branches] = {
+    UnitType::Worker, UnitType::Knight, UnitType::Ranger, UnitType::Mage, UnitType::Healer, UnitType::Rocket};
+
+/*
+ * The api errors out on getters that don't apply to a unit's type, so each one is only read for the types that
+ * have it.
+ */
+TraceUnitStats readStats(const Unit &unit) {
+  TraceUnitStats stats;
+  const UnitType type = unit.get_unit_type();
+  stats.type = static_cast<uint8_t>(type);
+  stats.level = static_cast<uint8_t>(unit.get_research_level());
+  stats.max_health = unit.get_max_health();
+  stats.vision_range = unit.get_vision_range();
+  if (unit.is_robot()) {
+    stats.damage = unit.get_damage();
+    stats.attack_range = unit.get_attack_range();
+    stats.movement_cooldown = unit.get_movement_cooldown();
+    stats.attack_cooldown = unit.get_attack_cooldown();
+    stats.is_ability_unlocked = unit.is_ability_unlocked();
+    stats.ability_cooldown = unit.get_ability_cooldown();
+    stats.ability_range = unit.get_ability_range();
+  }
+  if (type == UnitType::Worker) {
+    stats.worker_build_health = unit.get_worker_build_health();
+    stats.worker_repair_health = unit.get_worker_repair_health();
+    stats.worker_harvest_amount = unit.get_worker_harvest_amount();
+  } else if (type == UnitType::Knight) {
+    stats.knight_defense = unit.get_knight_defense();
+  } else if (type == UnitType::Ranger) {
+    stats.ranger_cannot_attack_range = unit.get_ranger_cannot_attack_range();
+    stats.ranger_max_countdown = unit.get_ranger_max_countdown();
+  } else if (unit.is_structure()) {
+    stats.structure_max_capacity = unit.get_structure_max_capacity();
+  }
+  return stats;
+}
+
+TraceUnit readUnit(const Unit &unit, vector<TraceUnitStats> &new_stats) {
+  TraceUnit traced;
+  const UnitType type = unit.get_unit_type();
+  traced.id = unit.get_id();
+  traced.team = static_cast<uint8_t>(unit.get_team());
+  traced.type = static_cast<uint8_t>(type);
+  traced.level = static_cast<uint8_t>(unit.get_research_level());
+  if (written_stats.insert(traced.type * 16u + traced.level).second) {
+    new_stats.push_back(readStats(unit));
+  }
+
+  const Location location = unit.get_location();
+  if (location.is_on_map()) {
+    const MapLocation map_location = location.get_map_location();
+    traced.location = TraceUnit::OnMap;
+    traced.planet = static_cast<uint8_t>(map_location.get_planet());
+    traced.x = static_cast<uint8_t>(map_location.get_x());
+    traced.y = static_cast<uint8_t>(map_location.get_y());
+  } else if (location.is_in_garrison()) {
+    traced.location = TraceUnit::InGarrison;
+    traced.structure_id = location.get_structure();
+  } else {
+    traced.location = TraceUnit::InSpace;
+  }
+
+  traced.health = unit.get_health();
+  if (unit.is_robot()) {
+    traced.movement_heat = unit.get_movement_heat();
+    traced.attack_heat = unit.get_attack_heat();
+    traced.ability_heat = unit.get_ability_heat();
+  }
+  if (type == UnitType::Worker) {
+    traced.worker_has_acted = unit.worker_has_acted();
+  } else if (type == UnitType::Ranger) {
+    traced.ranger_is_sniping = unit.ranger_is_sniping();
+    if (traced.ranger_is_sniping) {
+      const MapLocation target = unit.get_ranger_target_location();
+      traced.ranger_countdown = unit.get_ranger_countdown();
+      traced.ranger_target_x = static_cast<uint8_t>(target.get_x());
+      traced.ranger_target_y = static_cast<uint8_t>(target.get_y());
+    }
+  } else if (unit.is_structure()) {
+    traced.structure_is_built = unit.structure_is_built();
+    for (unsigned int id : unit.get_structure_garrison()) {
+      traced.garrison.push_back(id);
+    }
+    if (type == UnitType::Factory) {
+      traced.factory_is_producing = unit.is_factory_producing();
+    }
+  }
+  return traced;
+}
+
+TraceMap readMap(const PlanetMap &map, vector<TraceUnitStats> &new_stats) {
+  TraceMap traced;
+  traced.planet = static_cast<uint8_t>(map.get_planet());
+  traced.width = map.get_width();
+  traced.height = map.get_height();
+  for (unsigned int y = 0; y < traced.height; ++y) {
+    for (unsigned int x = 0; x < traced.width; ++x) {
+      const MapLocation location(map.get_planet(), x, y);
+      traced.passable.push_back(map.is_passable_terrain_at(location));
+      traced.karbonite.push_back(map.get_initial_karbonite_at(location));
+    }
+  }
+  for (const Unit &unit : map.get_initial_units()) {
+    traced.initial_units.push_back(readUnit(unit, new_stats));
+  }
+  return traced;
+}
+
+}
+
+void trace_open(GameController &gc, const char *path) {
+  is_open = writer.open(path);
+  if (!is_open) {
+    LOG("Couldn't open " << path << " to record the game" << endl);
+    return;
+  }
+
+  TraceHeader header;
+  header.team = static_cast<uint8_t>(gc.get_team());
+  header.planet = static_cast<uint8_t>(gc.get_planet());
+  header.maps[Planet::Earth] = readMap(gc.get_starting_planet(Planet::Earth), header.stats);
+  header.maps[Planet::Mars] = readMap(gc.get_starting_planet(Planet::Mars), header.stats);
+  for (const auto &strike : gc.get_asteroid_pattern().get_all_strikes()) {
+    TraceAsteroid asteroid;
+    asteroid.round = strike.first;
+    asteroid.x = static_cast<uint8_t>(strike.second.get_map_location().get_x());
+    asteroid.y = static_cast<uint8_t>(strike.second.get_map_location().get_y());
+    asteroid.karbonite = strike.second.get_karbonite();
+    header.asteroids.push_back(asteroid);
+  }
+  // the pattern comes out of a hash map
+  std::sort(header.asteroids.begin(), header.asteroids.end(), [](const TraceAsteroid &a, const TraceAsteroid &b) {
+    return a.round < b.round;
+  });
+  last_karbonite = header.maps[gc.get_planet()].karbonite;
+  writer.writeHeader(header);
+}
+
+void trace_record_turn(GameController &gc) {
+  if (!is_open) {
+    return;
+  }
+  TraceTurn turn;
+  turn.round = gc.get_round();
+  turn.time_left_ms = gc.get_time_left_ms();
+  turn.karbonite = gc.get_karbonite();
+  const ResearchInfo research = gc.get_research_info();
+  for (int i = 0; i < TraceTurn::num_branches; ++i) {
+    turn.research_levels[i] = static_cast<uint8_t>(research.get_level(research_branches[i]));
+  }
+  for (Planet planet : {Planet::Earth, Planet::Mars}) {
+    for (int value : gc.get_team_array(planet)) {
+      turn.team_arrays[planet].push_back(value);
+    }
+  }
+
+  // units in our garrisons aren't always in get_units, so pick them up from their structures
+  std::set<unsigned int> recorded;
+  vector<unsigned int> garrisoned;
+  for (const Unit &unit : gc.get_units()) {
+    if (recorded.insert(unit.get_id()).second) {
+      turn.units.push_back(readUnit(unit, turn.stats));
+      if (unit.get_team() == gc.get_team()) {
+        garrisoned.insert(garrisoned.end(), turn.units.back().garrison.begin(), turn.units.back().garrison.end());
+      }
+    }
+  }
+  for (unsigned int id : garrisoned) {
+    if (recorded.insert(id).second) {
+      turn.units.push_back(readUnit(gc.get_unit(id), turn.stats));
+    }
+  }
+  for (const Unit &unit : gc.get_units_in_space()) {
+    if (recorded.insert(unit.get_id()).second) {
+      turn.units.push_back(readUnit(unit, turn.stats));
+    }
+  }
+
+  const PlanetMap &map = gc.get_starting_planet(gc.get_planet());
+  const unsigned int width = map.get_width();
+  for (uint32_t index = 0; index < last_karbonite.size(); ++index) {
+    const MapLocation location(gc.get_planet(), index % width, index / width);
+    if (!gc.can_sense_location(location)) {
+      continue;
+    }
+    const uint32_t karbonite = gc.get_karbonite_at(location);
+    if (karbonite != last_karbonite[index]) {
+      turn.karbonite_changes.push_back(TraceKarbonite{index, karbonite});
+      last_karbonite[index] = karbonite;
+    }
+  }
+  writer.writeTurn(turn);
+}
+
+#endif
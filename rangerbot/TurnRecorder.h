@@ -0,0 +1,31 @@
+#ifndef RANGERBOT_TURNRECORDER_H
+#define RANGERBOT_TURNRECORDER_H
+
+#include "bcpp_api/bc.hpp"
+
+/*
+ * Opt-in recording of the bot's inputs, so a game can be replayed offline with tools/replay. Build with
+ * -DRANGERBOT_RECORD (record=1 in run.sh) and trace_open() writes the starting maps to a TurnTrace, then
+ * trace_record_turn() adds everything the bot can see at the start of each turn. Without it, the functions below do
+ * nothing.
+ *
+ * Recording reads every visible unit and tile through the api, which costs a few ms a turn, and that time is recorded
+ * too, as part of the time left. Leave it off in real games.
+ */
+
+#ifdef RANGERBOT_RECORD
+
+void trace_open(bc::GameController &gc, const char *path);
+
+// call at the start of the turn, before the bot reads anything
+void trace_record_turn(bc::GameController &gc);
+
+#else
+
+inline void trace_open(bc::GameController &, const char *) {}
+
+inline void trace_record_turn(bc::GameController &) {}
+
+#endif
+
+#endif //RANGERBOT_TURNRECORDER_H
@@ -0,0 +1,90 @@
+
+#include "TurnScheduler.h"
+
+#include <algorithm>
+
+void TurnScheduler::beginTurn(unsigned int time_left_ms) {
+  m_turn_start = std::chrono::steady_clock::now();
+  m_budget_ms = time_left_ms > m_reserve_ms ? static_cast<double>(time_left_ms - m_reserve_ms) : 0.0;
+  m_entries.clear();
+}
+
+void TurnScheduler::add(unsigned int id, int priority, bool can_degrade, Task task) {
+  if (id >= m_estimates.size()) {
+    m_estimates.resize(id + 1);
+  }
+  m_entries.push_back(Entry{id, priority, can_degrade, std::move(task), Mode::Full, false});
+}
+
+double TurnScheduler::estimate(const Entry &entry, Mode mode) const {
+  switch (mode) {
+    case Mode::Full:
+      return m_estimates[entry.id].full_ms;
+    case Mode::Degraded:
+      return m_estimates[entry.id].degraded_ms;
+    case Mode::Skipped:
+      return 0.0;
+  }
+  return 0.0;
+}
+
+double TurnScheduler::elapsedMs() const {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_turn_start).count();
+}
+
+void TurnScheduler::run() {
+  // plan: the most important tasks get first dibs on the budget
+  m_by_priority.resize(m_entries.size());
+  for (size_t i = 0; i < m_entries.size(); ++i) {
+    m_by_priority[i] = i;
+  }
+  std::stable_sort(m_by_priority.begin(), m_by_priority.end(), [this](size_t a, size_t b) {
+    return m_entries[a].priority < m_entries[b].priority;
+  });
+  double projected_ms = elapsedMs();
+  for (size_t i : m_by_priority) {
+    Entry &entry = m_entries[i];
+    entry.essential = entry.priority == m_entries[m_by_priority.front()].priority;
+    if (projected_ms + estimate(entry, Mode::Full) <= m_budget_ms) {
+      entry.mode = Mode::Full;
+    } else if (entry.can_degrade && projected_ms + estimate(entry, Mode::Degraded) <= m_budget_ms) {
+      entry.mode = Mode::Degraded;
+    } else {
+      entry.mode = entry.essential ? cheapestMode(entry) : Mode::Skipped;
+    }
+    projected_ms += estimate(entry, entry.mode);
+  }
+
+  // run, in phase order
+  double still_planned_ms = projected_ms - elapsedMs();
+  for (Entry &entry : m_entries) {
+    still_planned_ms -= estimate(entry, entry.mode);
+    // if earlier tasks ran long, this one has to fit in whatever is left after the other planned tasks
+    const double start_ms = elapsedMs();
+    const double room_ms = m_budget_ms - start_ms - std::max(still_planned_ms, 0.0);
+    if (entry.mode == Mode::Full && estimate(entry, Mode::Full) > room_ms) {
+      entry.mode = entry.can_degrade ? Mode::Degraded : Mode::Skipped;
+    }
+    if (entry.mode == Mode::Degraded && estimate(entry, Mode::Degraded) > room_ms) {
+      entry.mode = Mode::Skipped;
+    }
+    if (entry.mode == Mode::Skipped && entry.essential) {
+      entry.mode = cheapestMode(entry);
+    }
+    if (entry.mode == Mode::Skipped) {
+      ++m_num_skipped;
+      continue;
+    }
+    if (entry.mode == Mode::Degraded) {
+      ++m_num_degraded;
+    }
+
+    entry.task(entry.mode);
+
+    const double took_ms = elapsedMs() - start_ms;
+    Estimate &costs = m_estimates[entry.id];
+    double &estimate_ms = entry.mode == Mode::Full ? costs.full_ms : costs.degraded_ms;
+    // the first measurement is all we know. after that, a running average.
+    estimate_ms = estimate_ms == 0.0 ? took_ms : estimate_ms + estimate_weight * (took_ms - estimate_ms);
+  }
+}
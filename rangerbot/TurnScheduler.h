@@ -0,0 +1,81 @@
+#ifndef RANGERBOT_TURNSCHEDULER_H
+#define RANGERBOT_TURNSCHEDULER_H
+
+#include <chrono>
+#include <functional>
+#include <vector>
+
+/*
+ * Runs the phases of a turn within what's left of the time bank. Each phase is a task with a priority and a cheaper
+ * degraded mode. Before running anything, the scheduler walks the tasks from most to least important and gives each
+ * one its full mode, its degraded mode or nothing, depending on how long those took on previous turns and how much
+ * time is left above the reserve. The tasks then run in the order they were added, since later phases depend on
+ * earlier ones, and get downgraded further if the turn runs long anyway. The most important tasks are never skipped:
+ * with the bank below the reserve they still run, degraded if they can be, so a short turn isn't an idle one.
+ *
+ * Usage, every turn: beginTurn(), add() each phase, run().
+ */
+class TurnScheduler {
+ public:
+  enum class Mode {Full, Degraded, Skipped};
+
+  // the task is told which mode to run in. it's never called with Skipped.
+  typedef std::function<void(Mode)> Task;
+
+  explicit TurnScheduler(unsigned int reserve_ms) : m_reserve_ms(reserve_ms) {}
+
+  void setReserve(unsigned int reserve_ms) { m_reserve_ms = reserve_ms; }
+
+  void beginTurn(unsigned int time_left_ms);
+
+  /*
+   * id identifies the task from turn to turn, for its cost estimates, and should be small. Lower priorities are more
+   * important.
+   */
+  void add(unsigned int id, int priority, bool can_degrade, Task task);
+
+  void run();
+
+  // how many tasks ran degraded or got skipped over the whole game
+  unsigned int numDegraded() const { return m_num_degraded; }
+
+  unsigned int numSkipped() const { return m_num_skipped; }
+
+ private:
+  // weight of the latest measurement in the running cost estimates
+  const double estimate_weight = 0.2;
+
+  struct Estimate {
+    double full_ms = 0.0;
+    double degraded_ms = 0.0;
+  };
+
+  struct Entry {
+    unsigned int id;
+    int priority;
+    bool can_degrade;
+    Task task;
+    Mode mode;
+    // of the most important priority, so it runs in its cheapest mode rather than not at all
+    bool essential;
+  };
+
+  // the mode an essential task drops to when it doesn't fit
+  static Mode cheapestMode(const Entry &entry) { return entry.can_degrade ? Mode::Degraded : Mode::Full; }
+
+  double estimate(const Entry &entry, Mode mode) const;
+
+  double elapsedMs() const;
+
+  unsigned int m_reserve_ms;
+  double m_budget_ms = 0.0;
+  std::chrono::steady_clock::time_point m_turn_start;
+  std::vector<Entry> m_entries;
+  std::vector<size_t> m_by_priority;
+  std::vector<Estimate> m_estimates;
+  unsigned int m_num_degraded = 0;
+  unsigned int m_num_skipped = 0;
+};
+
+
+#endif //RANGERBOT_TURNSCHEDULER_H
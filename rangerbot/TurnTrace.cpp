@@ -0,0 +1,404 @@
+
+#include "TurnTrace.h"
+
+#include <cstring>
+
+namespace {
+
+const char magic[] = "RBTRACE1";
+const size_t magic_length = sizeof(magic) - 1;
+
+// a turn record bigger than this means the file is corrupt
+const uint32_t max_record_bytes = 1 << 26;
+
+void put(std::string &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+void putSigned(std::string &out, int64_t value) {
+  put(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void putStats(std::string &out, const std::vector<TraceUnitStats> &stats) {
+  put(out, stats.size());
+  for (const TraceUnitStats &s : stats) {
+    put(out, s.type);
+    put(out, s.level);
+    put(out, s.max_health);
+    put(out, s.vision_range);
+    putSigned(out, s.damage);
+    put(out, s.attack_range);
+    put(out, s.movement_cooldown);
+    put(out, s.attack_cooldown);
+    put(out, s.is_ability_unlocked);
+    put(out, s.ability_cooldown);
+    put(out, s.ability_range);
+    put(out, s.worker_build_health);
+    put(out, s.worker_repair_health);
+    put(out, s.worker_harvest_amount);
+    put(out, s.knight_defense);
+    put(out, s.ranger_cannot_attack_range);
+    put(out, s.ranger_max_countdown);
+    put(out, s.structure_max_capacity);
+  }
+}
+
+void putUnits(std::string &out, const std::vector<TraceUnit> &units) {
+  put(out, units.size());
+  for (const TraceUnit &u : units) {
+    put(out, u.id);
+    put(out, u.team);
+    put(out, u.type);
+    put(out, u.level);
+    put(out, u.location);
+    put(out, u.planet);
+    if (u.location == TraceUnit::OnMap) {
+      put(out, u.x);
+      put(out, u.y);
+    } else if (u.location == TraceUnit::InGarrison) {
+      put(out, u.structure_id);
+    }
+    put(out, u.health);
+    put(out, u.movement_heat);
+    put(out, u.attack_heat);
+    put(out, u.ability_heat);
+    put(out, u.worker_has_acted | u.ranger_is_sniping << 1 | u.structure_is_built << 2 | u.factory_is_producing << 3);
+    if (u.ranger_is_sniping) {
+      put(out, u.ranger_countdown);
+      put(out, u.ranger_target_x);
+      put(out, u.ranger_target_y);
+    }
+    put(out, u.garrison.size());
+    for (uint32_t id : u.garrison) {
+      put(out, id);
+    }
+  }
+}
+
+void putMap(std::string &out, const TraceMap &map) {
+  put(out, map.planet);
+  put(out, map.width);
+  put(out, map.height);
+  for (uint8_t passable : map.passable) {
+    put(out, passable);
+  }
+  for (uint32_t karbonite : map.karbonite) {
+    put(out, karbonite);
+  }
+  putUnits(out, map.initial_units);
+}
+
+/*
+ * Decodes from a record. Running off the end sets m_failed rather than reading past it, and the caller checks that
+ * once at the end.
+ */
+class Decoder {
+ public:
+  Decoder(const std::vector<uint8_t> &buffer, size_t position) : m_buffer(buffer), m_position(position) {}
+
+  uint64_t get() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (m_position >= m_buffer.size()) {
+        m_failed = true;
+        return 0;
+      }
+      const uint8_t byte = m_buffer[m_position++];
+      value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) {
+        return value;
+      }
+    }
+    m_failed = true;
+    return 0;
+  }
+
+  int64_t getSigned() {
+    const uint64_t value = get();
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+  }
+
+  // a count of things still to come, each of which takes at least a byte
+  size_t getCount() {
+    const uint64_t count = get();
+    if (count > m_buffer.size() - m_position) {
+      m_failed = true;
+      return 0;
+    }
+    return static_cast<size_t>(count);
+  }
+
+  void getStats(std::vector<TraceUnitStats> &stats) {
+    const size_t count = getCount();
+    for (size_t i = 0; i < count && !m_failed; ++i) {
+      TraceUnitStats s;
+      s.type = static_cast<uint8_t>(get());
+      s.level = static_cast<uint8_t>(get());
+      s.max_health = static_cast<uint32_t>(get());
+      s.vision_range = static_cast<uint32_t>(get());
+      s.damage = static_cast<int32_t>(getSigned());
+      s.attack_range = static_cast<uint32_t>(get());
+      s.movement_cooldown = static_cast<uint32_t>(get());
+      s.attack_cooldown = static_cast<uint32_t>(get());
+      s.is_ability_unlocked = get() != 0;
+      s.ability_cooldown = static_cast<uint32_t>(get());
+      s.ability_range = static_cast<uint32_t>(get());
+      s.worker_build_health = static_cast<uint32_t>(get());
+      s.worker_repair_health = static_cast<uint32_t>(get());
+      s.worker_harvest_amount = static_cast<uint32_t>(get());
+      s.knight_defense = static_cast<uint32_t>(get());
+      s.ranger_cannot_attack_range = static_cast<uint32_t>(get());
+      s.ranger_max_countdown = static_cast<uint32_t>(get());
+      s.structure_max_capacity = static_cast<uint32_t>(get());
+      stats.push_back(s);
+    }
+  }
+
+  void getUnits(std::vector<TraceUnit> &units) {
+    const size_t count = getCount();
+    units.resize(count);
+    for (size_t i = 0; i < count && !m_failed; ++i) {
+      TraceUnit &u = units[i];
+      u.id = static_cast<uint32_t>(get());
+      u.team = static_cast<uint8_t>(get());
+      u.type = static_cast<uint8_t>(get());
+      u.level = static_cast<uint8_t>(get());
+      const uint64_t location = get();
+      if (location > TraceUnit::InSpace) {
+        m_failed = true;
+        return;
+      }
+      u.location = static_cast<TraceUnit::LocationKind>(location);
+      u.planet = static_cast<uint8_t>(get());
+      if (u.location == TraceUnit::OnMap) {
+        u.x = static_cast<uint8_t>(get());
+        u.y = static_cast<uint8_t>(get());
+      } else if (u.location == TraceUnit::InGarrison) {
+        u.structure_id = static_cast<uint32_t>(get());
+      }
+      u.health = static_cast<uint32_t>(get());
+      u.movement_heat = static_cast<uint32_t>(get());
+      u.attack_heat = static_cast<uint32_t>(get());
+      u.ability_heat = static_cast<uint32_t>(get());
+      const uint64_t flags = get();
+      u.worker_has_acted = (flags & 1) != 0;
+      u.ranger_is_sniping = (flags & 2) != 0;
+      u.structure_is_built = (flags & 4) != 0;
+      u.factory_is_producing = (flags & 8) != 0;
+      if (u.ranger_is_sniping) {
+        u.ranger_countdown = static_cast<uint32_t>(get());
+        u.ranger_target_x = static_cast<uint8_t>(get());
+        u.ranger_target_y = static_cast<uint8_t>(get());
+      }
+      u.garrison.resize(getCount());
+      for (uint32_t &id : u.garrison) {
+        id = static_cast<uint32_t>(get());
+      }
+    }
+  }
+
+  void getMap(TraceMap &map) {
+    map.planet = static_cast<uint8_t>(get());
+    map.width = static_cast<uint32_t>(get());
+    map.height = static_cast<uint32_t>(get());
+    const uint64_t tiles = static_cast<uint64_t>(map.width) * map.height;
+    if (tiles > m_buffer.size() - m_position) {
+      m_failed = true;
+      return;
+    }
+    map.passable.resize(tiles);
+    for (uint8_t &passable : map.passable) {
+      passable = static_cast<uint8_t>(get());
+    }
+    map.karbonite.resize(tiles);
+    for (uint32_t &karbonite : map.karbonite) {
+      karbonite = static_cast<uint32_t>(get());
+    }
+    getUnits(map.initial_units);
+  }
+
+  bool failed() const { return m_failed; }
+
+ private:
+  const std::vector<uint8_t> &m_buffer;
+  size_t m_position;
+  bool m_failed = false;
+};
+
+}
+
+TraceWriter::~TraceWriter() {
+  if (m_file != nullptr) {
+    fclose(m_file);
+  }
+}
+
+bool TraceWriter::open(const char *path) {
+  if (m_file != nullptr) {
+    fclose(m_file);
+  }
+  m_file = fopen(path, "wb");
+  if (m_file == nullptr) {
+    return false;
+  }
+  fwrite(magic, 1, magic_length, m_file);
+  return true;
+}
+
+void TraceWriter::writeHeader(const TraceHeader &header) {
+  m_buffer.clear();
+  put(m_buffer, header.team);
+  put(m_buffer, header.planet);
+  putMap(m_buffer, header.maps[0]);
+  putMap(m_buffer, header.maps[1]);
+  put(m_buffer, header.asteroids.size());
+  for (const TraceAsteroid &asteroid : header.asteroids) {
+    put(m_buffer, asteroid.round);
+    put(m_buffer, asteroid.x);
+    put(m_buffer, asteroid.y);
+    put(m_buffer, asteroid.karbonite);
+  }
+  putStats(m_buffer, header.stats);
+  flush();
+}
+
+void TraceWriter::writeTurn(const TraceTurn &turn) {
+  m_buffer.clear();
+  put(m_buffer, turn.round);
+  put(m_buffer, turn.time_left_ms);
+  put(m_buffer, turn.karbonite);
+  for (uint8_t level : turn.research_levels) {
+    put(m_buffer, level);
+  }
+  for (const std::vector<int32_t> &array : turn.team_arrays) {
+    put(m_buffer, array.size());
+    for (int32_t value : array) {
+      putSigned(m_buffer, value);
+    }
+  }
+  putStats(m_buffer, turn.stats);
+  putUnits(m_buffer, turn.units);
+  put(m_buffer, turn.karbonite_changes.size());
+  // indices go up, so store the gaps
+  uint32_t last_index = 0;
+  for (const TraceKarbonite &change : turn.karbonite_changes) {
+    put(m_buffer, change.index - last_index);
+    put(m_buffer, change.karbonite);
+    last_index = change.index;
+  }
+  flush();
+}
+
+void TraceWriter::flush() {
+  if (m_file == nullptr) {
+    return;
+  }
+  std::string size;
+  put(size, m_buffer.size());
+  fwrite(size.data(), 1, size.size(), m_file);
+  fwrite(m_buffer.data(), 1, m_buffer.size(), m_file);
+  // a bot that gets killed mid game should still leave every finished turn behind
+  fflush(m_file);
+}
+
+TraceReader::~TraceReader() {
+  if (m_file != nullptr) {
+    fclose(m_file);
+  }
+}
+
+bool TraceReader::open(const char *path) {
+  if (m_file != nullptr) {
+    fclose(m_file);
+  }
+  m_file = fopen(path, "rb");
+  if (m_file == nullptr) {
+    return false;
+  }
+  char start[magic_length];
+  if (fread(start, 1, magic_length, m_file) != magic_length || memcmp(start, magic, magic_length) != 0) {
+    fclose(m_file);
+    m_file = nullptr;
+    return false;
+  }
+  return true;
+}
+
+bool TraceReader::readRecord() {
+  if (m_file == nullptr) {
+    return false;
+  }
+  uint32_t size = 0;
+  for (int shift = 0;; shift += 7) {
+    const int byte = fgetc(m_file);
+    if (byte == EOF || shift > 28) {
+      return false;
+    }
+    size |= static_cast<uint32_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      break;
+    }
+  }
+  if (size > max_record_bytes) {
+    return false;
+  }
+  m_buffer.resize(size);
+  m_position = 0;
+  // a partial record at the end is a turn the bot didn't get to finish writing
+  return fread(m_buffer.data(), 1, size, m_file) == size;
+}
+
+bool TraceReader::readHeader(TraceHeader &header) {
+  if (!readRecord()) {
+    return false;
+  }
+  Decoder in(m_buffer, m_position);
+  header.team = static_cast<uint8_t>(in.get());
+  header.planet = static_cast<uint8_t>(in.get());
+  in.getMap(header.maps[0]);
+  in.getMap(header.maps[1]);
+  header.asteroids.resize(in.getCount());
+  for (TraceAsteroid &asteroid : header.asteroids) {
+    asteroid.round = static_cast<uint32_t>(in.get());
+    asteroid.x = static_cast<uint8_t>(in.get());
+    asteroid.y = static_cast<uint8_t>(in.get());
+    asteroid.karbonite = static_cast<uint32_t>(in.get());
+  }
+  header.stats.clear();
+  in.getStats(header.stats);
+  return !in.failed();
+}
+
+bool TraceReader::readTurn(TraceTurn &turn) {
+  if (!readRecord()) {
+    return false;
+  }
+  Decoder in(m_buffer, m_position);
+  turn.round = static_cast<uint32_t>(in.get());
+  turn.time_left_ms = static_cast<uint32_t>(in.get());
+  turn.karbonite = static_cast<uint32_t>(in.get());
+  for (uint8_t &level : turn.research_levels) {
+    level = static_cast<uint8_t>(in.get());
+  }
+  for (std::vector<int32_t> &array : turn.team_arrays) {
+    array.resize(in.getCount());
+    for (int32_t &value : array) {
+      value = static_cast<int32_t>(in.getSigned());
+    }
+  }
+  turn.stats.clear();
+  in.getStats(turn.stats);
+  in.getUnits(turn.units);
+  turn.karbonite_changes.resize(in.getCount());
+  uint32_t index = 0;
+  for (TraceKarbonite &change : turn.karbonite_changes) {
+    index += static_cast<uint32_t>(in.get());
+    change.index = index;
+    change.karbonite = static_cast<uint32_t>(in.get());
+  }
+  return !in.failed();
+}
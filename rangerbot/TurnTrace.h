@@ -0,0 +1,165 @@
+#ifndef RANGERBOT_TURNTRACE_H
+#define RANGERBOT_TURNTRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+ * A compact binary trace of what the bot reads from the GameController, so a game can be replayed offline (see
+ * tools/replay). There's a header with the starting maps, then one record per turn with everything visible at the
+ * start of that turn: units, karbonite, the team arrays, research and the time left.
+ *
+ * Numbers are varints, so most fields take a byte. Stats that only depend on a unit's type and research level are
+ * written once, the first time that combination shows up, and karbonite only where it changed. Each record is prefixed
+ * with its size, so a truncated trace still reads up to its last complete turn.
+ *
+ * Enums are stored as their values in the bc API, so this doesn't depend on it.
+ */
+
+struct TraceUnitStats {
+  uint8_t type = 0;
+  uint8_t level = 0;
+  uint32_t max_health = 0;
+  uint32_t vision_range = 0;
+  int32_t damage = 0;
+  uint32_t attack_range = 0;
+  uint32_t movement_cooldown = 0;
+  uint32_t attack_cooldown = 0;
+  bool is_ability_unlocked = false;
+  uint32_t ability_cooldown = 0;
+  uint32_t ability_range = 0;
+  uint32_t worker_build_health = 0;
+  uint32_t worker_repair_health = 0;
+  uint32_t worker_harvest_amount = 0;
+  uint32_t knight_defense = 0;
+  uint32_t ranger_cannot_attack_range = 0;
+  uint32_t ranger_max_countdown = 0;
+  uint32_t structure_max_capacity = 0;
+};
+
+struct TraceUnit {
+  enum LocationKind : uint8_t {OnMap, InGarrison, InSpace};
+
+  uint32_t id = 0;
+  uint8_t team = 0;
+  uint8_t type = 0;
+  uint8_t level = 0;
+  LocationKind location = OnMap;
+  uint8_t planet = 0;
+  uint8_t x = 0;
+  uint8_t y = 0;
+  uint32_t structure_id = 0;
+  uint32_t health = 0;
+  uint32_t movement_heat = 0;
+  uint32_t attack_heat = 0;
+  uint32_t ability_heat = 0;
+  bool worker_has_acted = false;
+  bool ranger_is_sniping = false;
+  uint32_t ranger_countdown = 0;
+  uint8_t ranger_target_x = 0;
+  uint8_t ranger_target_y = 0;
+  bool structure_is_built = false;
+  bool factory_is_producing = false;
+  std::vector<uint32_t> garrison;
+};
+
+struct TraceMap {
+  uint8_t planet = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  // row major, y * width + x
+  std::vector<uint8_t> passable;
+  std::vector<uint32_t> karbonite;
+  std::vector<TraceUnit> initial_units;
+};
+
+struct TraceAsteroid {
+  uint32_t round = 0;
+  uint8_t x = 0;
+  uint8_t y = 0;
+  uint32_t karbonite = 0;
+};
+
+struct TraceHeader {
+  uint8_t team = 0;
+  uint8_t planet = 0;
+  // indexed by planet
+  TraceMap maps[2];
+  std::vector<TraceAsteroid> asteroids;
+  std::vector<TraceUnitStats> stats;
+};
+
+struct TraceKarbonite {
+  uint32_t index = 0;
+  uint32_t karbonite = 0;
+};
+
+struct TraceTurn {
+  // research branches, in unit type order: worker, knight, ranger, mage, healer, rocket
+  static const int num_branches = 6;
+
+  uint32_t round = 0;
+  uint32_t time_left_ms = 0;
+  uint32_t karbonite = 0;
+  uint8_t research_levels[num_branches] = {};
+  // indexed by planet
+  std::vector<int32_t> team_arrays[2];
+  // stats that showed up for the first time this turn
+  std::vector<TraceUnitStats> stats;
+  // everything visible, plus our units in space
+  std::vector<TraceUnit> units;
+  // tiles on this turn's planet whose karbonite changed since the last turn
+  std::vector<TraceKarbonite> karbonite_changes;
+};
+
+class TraceWriter {
+ public:
+  TraceWriter() = default;
+
+  ~TraceWriter();
+
+  TraceWriter(const TraceWriter &) = delete;
+
+  TraceWriter &operator=(const TraceWriter &) = delete;
+
+  bool open(const char *path);
+
+  void writeHeader(const TraceHeader &header);
+
+  void writeTurn(const TraceTurn &turn);
+
+ private:
+  void flush();
+
+  FILE *m_file = nullptr;
+  std::string m_buffer;
+};
+
+class TraceReader {
+ public:
+  TraceReader() = default;
+
+  ~TraceReader();
+
+  TraceReader(const TraceReader &) = delete;
+
+  TraceReader &operator=(const TraceReader &) = delete;
+
+  bool open(const char *path);
+
+  bool readHeader(TraceHeader &header);
+
+  // false at the end of the trace. turns only make sense read in order, since they build on the ones before.
+  bool readTurn(TraceTurn &turn);
+
+ private:
+  bool readRecord();
+
+  FILE *m_file = nullptr;
+  std::vector<uint8_t> m_buffer;
+  size_t m_position = 0;
+};
+
+#endif //RANGERBOT_TURNTRACE_H
@@ -3,22 +3,21 @@
 #ifndef BC18_SCAFFOLD_UNITTALLY_H
 #define BC18_SCAFFOLD_UNITTALLY_H
 
-#include <map>
-#include <list>
-
 #include "bcpp_api/bc.hpp"
 #include "Debug.h"
+#include "TurnArena.h"
 
 /*
  * Some utility functions for prettifying unit counting. This is essentially just a map.
  * At the start of every turn, users should update the map contents to account for dead units.
+ * It lives in the turn arena, so it can't be kept past the turn.
  */
 class UnitTally {
  public:
   // TODO: Wrap bc::Unit with a struct. That way if we want to make an incremental update to a Unit, we only have to
   // update the variables that changed (and we could mark them as mutable), rather than re-copying the entire Unit.
-  std::map<bc::UnitType, std::list<unsigned int>> units_by_type;
-  std::map<unsigned int, bc::Unit> ids_to_units;
+  ArenaMap<bc::UnitType, ArenaList<unsigned int>> units_by_type;
+  ArenaMap<unsigned int, bc::Unit> ids_to_units;
 
   /*
    * Loads the current allied unit list. This should be called once after construction.
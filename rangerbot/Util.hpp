@@ -5,6 +5,9 @@
 #include <vector>
 #include "bcpp_api/bc.hpp"
 
+// units can move, attack or use their ability only while the matching heat is below this
+const unsigned int max_ready_heat = 10;
+
 extern const std::vector<bc::Direction> directions_incl_center;
 
 extern const std::vector<bc::Direction> directions_cwise;
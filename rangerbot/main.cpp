@@ -6,13 +6,31 @@
 #include <memory>
 #include <set>
 #include <cmath>
+#include <cstring>
 
 #include "bcpp_api/bc.hpp"
 
+#include "AbilityPlanner.h"
+#include "AllocationTracker.h"
+#include "CombatSimulator.h"
 #include "Debug.h"
 #include "DecisionMaker.h"
+#include "FlowField.h"
+#include "FocusFire.h"
+#include "KitingPlanner.h"
+#include "Logger.h"
 #include "MapPreprocessor.h"
+#include "MicroSearch.h"
+#include "MoveResolver.h"
 #include "PathFinding.h"
+#include "Profiler.h"
+#include "SnipePlanner.h"
+#include "SplashGrid.h"
+#include "Squads.h"
+#include "TimeBank.h"
+#include "TurnArena.h"
+#include "TurnRecorder.h"
+#include "TurnScheduler.h"
 #include "Util.hpp"
 #include "Messenger.h"
 
@@ -39,12 +57,15 @@ class Bot {
       m_map(m_gc.get_starting_planet(m_planet)),
       m_path_finder(gc, m_map),
       m_map_preprocessor(gc, m_path_finder, m_map),
-      m_messenger(gc) {
+      m_messenger(gc),
+      m_scheduler(time_reserve_ms),
+      m_time_bank(time_reserve_ms, last_round) {
     // nothing for now
 
   }
 
   void beforeLoop() {
+    PROFILE_SPAN("precompute");
     m_map_preprocessor.process();
 
     if (m_planet == Planet::Earth) {
@@ -61,6 +82,9 @@ class Bot {
       m_gc.queue_research(UnitType::Worker);
       m_gc.queue_research(UnitType::Worker);
       m_gc.queue_research(UnitType::Worker);
+      // snipe
+      m_gc.queue_research(UnitType::Ranger);
+      m_gc.queue_research(UnitType::Ranger);
     } else {
       // TODO
       // for now, just choose some random tiles that are multiple of 3 (to avoid collisions)
@@ -85,6 +109,11 @@ class Bot {
   }
 
   void turn() {
+    PROFILE_SPAN("turn");
+    // everything from last turn is gone by now
+    TurnArena::get().reset();
+    m_time_bank.beginTurn(m_gc.get_round(), m_gc.get_time_left_ms());
+
     // TODO handle mars
     if (m_planet == Planet::Earth) {
       earthTurn();
@@ -95,6 +124,21 @@ class Bot {
 
   list<MapLocation> m_landing_locations;
 
+  // never plan to dip below this much time in the bank
+  const unsigned int time_reserve_ms = 500;
+  // once enemies are in sight, expect a fight about this many rounds later
+  const unsigned int fight_warning_rounds = 5;
+
+  // ids for the turn scheduler, so it can remember how long each phase takes
+  enum TurnTask {
+    UnloadTask,
+    ConstructionTask,
+    ProductionTask,
+    RocketTask,
+    ArmyTask,
+    HarvestTask
+  };
+
   void earthTurn() {
 
     if (m_gc.get_round() == 55) {
@@ -105,52 +149,73 @@ class Bot {
     UnitTally unit_tally;
     unit_tally.update(m_gc);
 
-    const Goal goal(decision_maker.computeGoal(unit_tally, m_map_preprocessor));
+    forgetMissingStructures(unit_tally);
 
-    tryUnloadingAll<Factory>(unit_tally);
+    const Goal goal(decision_maker.computeGoal(unit_tally, m_map_preprocessor));
 
-    // first address construction
-    // try adding more factories
-    if (goal.build_factories) {
-      tryBlueprinting<UnitType::Factory>(unit_tally);
-    }
-    if (goal.build_rockets) {
-      tryBlueprinting<UnitType::Rocket>(unit_tally);
-    }
-    // then try building stuff, since this is basically free.
-    tryBuilding(unit_tally);
+    m_scheduler.setReserve(m_time_bank.reserveMs());
+    m_scheduler.beginTurn(m_gc.get_time_left_ms());
 
+    m_scheduler.add(UnloadTask, 2, false, [&](TurnScheduler::Mode) {
+      PROFILE_SPAN("unload");
+      tryUnloadingAll<Factory>(unit_tally);
+    });
 
-    if (goal.build_workers) {
-      tryReplicatingOrProducingWorkers(unit_tally);
-    }
-    if (goal.build_knights) {
-      tryProducing(UnitType::Knight, unit_tally);
-    }
-    if (goal.build_rangers) {
-      tryProducing(UnitType::Ranger, unit_tally);
-    }
-    if (goal.build_mages) {
-      tryProducing(UnitType::Mage, unit_tally);
-    }
-    if (goal.build_healers) {
-      tryProducing(UnitType::Healer, unit_tally);
-    }
+    // first address construction
+    m_scheduler.add(ConstructionTask, 2, true, [&](TurnScheduler::Mode mode) {
+      PROFILE_SPAN("construction");
+      // new blueprints can wait a turn, but finishing the ones we have can't
+      if (mode == TurnScheduler::Mode::Full) {
+        // try adding more factories
+        if (goal.build_factories) {
+          tryBlueprinting<UnitType::Factory>(unit_tally);
+        }
+        if (goal.build_rockets) {
+          tryBlueprinting<UnitType::Rocket>(unit_tally);
+        }
+      }
+      // then try building stuff, since this is basically free.
+      tryBuilding(unit_tally);
+    });
+
+    m_scheduler.add(ProductionTask, 1, false, [&](TurnScheduler::Mode) {
+      PROFILE_SPAN("production");
+      if (goal.build_workers) {
+        tryReplicatingOrProducingWorkers(unit_tally);
+      }
+      if (goal.build_knights) {
+        tryProducing(UnitType::Knight, unit_tally);
+      }
+      if (goal.build_rangers) {
+        tryProducing(UnitType::Ranger, unit_tally);
+      }
+      if (goal.build_mages) {
+        tryProducing(UnitType::Mage, unit_tally);
+      }
+      if (goal.build_healers) {
+        tryProducing(UnitType::Healer, unit_tally);
+      }
+    });
 
     if (goal.go_to_mars) {
-      loadAndLaunchRockets(unit_tally);
+      m_scheduler.add(RocketTask, 1, false, [&](TurnScheduler::Mode) {
+        PROFILE_SPAN("rockets");
+        loadAndLaunchRockets(unit_tally);
+      });
     }
 
     // These seem mutually exclusive. Maybe make an enum.
-    if (goal.attack) {
-      moveAllUnitsTowardEnemies(unit_tally);
-    } else if (goal.contain) {
-      moveAllUnitsTowardEnemies(unit_tally);
-    } else if (goal.defend) {
-      moveAllUnitsTowardEnemies(unit_tally);
+    if (goal.attack || goal.contain || goal.defend) {
+      m_scheduler.add(ArmyTask, 0, true, [&](TurnScheduler::Mode mode) {
+        moveAllUnitsTowardEnemies(unit_tally, mode == TurnScheduler::Mode::Degraded);
+      });
     }
 
-    collectKarbonite(unit_tally);
+    m_scheduler.add(HarvestTask, 3, true, [&](TurnScheduler::Mode mode) {
+      collectKarbonite(unit_tally, mode == TurnScheduler::Mode::Degraded);
+    });
+
+    m_scheduler.run();
   }
 
   void marsTurn() {
@@ -161,11 +226,23 @@ class Bot {
 
     // do we have any goals on mars (maybe in the future the attack/defence goals)? Just attack everything, right?
 
-    tryUnloadingAll<Rocket>(unit_tally);
+    m_scheduler.setReserve(m_time_bank.reserveMs());
+    m_scheduler.beginTurn(m_gc.get_time_left_ms());
 
-    moveAllUnitsTowardEnemies(unit_tally);
+    m_scheduler.add(UnloadTask, 2, false, [&](TurnScheduler::Mode) {
+      PROFILE_SPAN("unload");
+      tryUnloadingAll<Rocket>(unit_tally);
+    });
 
-    collectKarbonite(unit_tally);
+    m_scheduler.add(ArmyTask, 0, true, [&](TurnScheduler::Mode mode) {
+      moveAllUnitsTowardEnemies(unit_tally, mode == TurnScheduler::Mode::Degraded);
+    });
+
+    m_scheduler.add(HarvestTask, 3, true, [&](TurnScheduler::Mode mode) {
+      collectKarbonite(unit_tally, mode == TurnScheduler::Mode::Degraded);
+    });
+
+    m_scheduler.run();
   }
 
   template<UnitType StructType>
@@ -190,27 +267,66 @@ class Bot {
     if (m_gc.get_karbonite() < unit_type_get_blueprint_cost(StructType)) {
       return;
     }
+    ArenaVector<std::pair<unsigned int, Direction>> sites;
     for (const unsigned int &worker_id : tally.units_by_type[UnitType::Worker]) {
       if (m_workers_tasked_to_build.find(worker_id) != m_workers_tasked_to_build.end()) {
         // already building something. adding new stuff won't finish any faster.
         continue;
       }
       const Unit &worker = tally.ids_to_units.at(worker_id);
+      if (!worker.is_on_map()) {
+        continue;
+      }
+      MapLocation worker_loc = worker.get_map_location();
+
+      // try the sites that leave the most open space first, so we don't wall ourselves in
+      sites.clear();
       for (const auto &d : directions_shuffled) {
+        MapLocation target_loc = worker_loc.add(d);
+        if (m_path_finder.is_in_map_bounds(target_loc)) {
+          PathFinder::RowCol rowcol(target_loc.get_y(), target_loc.get_x());
+          sites.push_back(make_pair(m_map_preprocessor.openSpaceScore(rowcol), d));
+        }
+      }
+      std::stable_sort(sites.begin(), sites.end(),
+                       [](const std::pair<unsigned int, Direction> &lhs,
+                          const std::pair<unsigned int, Direction> &rhs) {
+                         return lhs.first > rhs.first;
+                       });
+
+      for (const auto &site : sites) {
+        const Direction &d = site.second;
         if (m_gc.can_blueprint(worker_id, StructType, d)) {
           m_gc.blueprint(worker_id, StructType, d);
-          MapLocation target_loc = worker.get_map_location().add(d);
+          MapLocation target_loc = worker_loc.add(d);
           Unit &blueprint = tally.add(m_gc.sense_unit_at_location(target_loc));
+          m_map_preprocessor.claimTerritory(target_loc);
+          m_map_preprocessor.addStructure(target_loc);
+          m_structure_locations[blueprint.get_id()] = target_loc;
           m_construction_sites_to_workers[blueprint.get_id()].push_back(worker_id);
           m_workers_tasked_to_build.insert(worker_id);
+          break;
         }
       }
     }
   }
 
+  void forgetMissingStructures(const UnitTally &tally) {
+    // destroyed or launched structures free up their tile
+    for (auto iter = m_structure_locations.begin(); iter != m_structure_locations.end();) {
+      if (tally.ids_to_units.find(iter->first) == tally.ids_to_units.end()) {
+        m_map_preprocessor.removeStructure(iter->second);
+        // delete while iterating
+        m_structure_locations.erase(iter++);
+      } else {
+        ++iter;
+      }
+    }
+  }
+
   void tryBuilding(UnitTally &tally) {
     // check if any buildings are under construction
-    list<unsigned int> finished;
+    ArenaList<unsigned int> finished;
     if (!m_construction_sites_to_workers.empty()) {
       for (auto site_iter = m_construction_sites_to_workers.begin();
            site_iter != m_construction_sites_to_workers.end();) {
@@ -341,7 +457,7 @@ class Bot {
     unsigned int karbonite = m_gc.get_karbonite();
     unsigned int replicate_cost = unit_type_get_replicate_cost();
     if (karbonite >= replicate_cost) {
-      list<unsigned int> replicated_worker_ids;
+      ArenaList<unsigned int> replicated_worker_ids;
       // iterate through workers and try to clone
       for (const unsigned int &worker_id : unit_tally.units_by_type[UnitType::Worker]) {
         const Unit &worker = unit_tally.ids_to_units.at(worker_id);
@@ -349,8 +465,7 @@ class Bot {
           // in a garrison (or in space? is that possible to sense?
           continue;
         }
-        // TODO: is there a constant for this?
-        if (worker.get_ability_heat() < 10) {
+        if (worker.get_ability_heat() < max_ready_heat) {
           MapLocation worker_loc = worker.get_map_location();
           for (const Direction &d : directions_shuffled) {
             MapLocation target = worker_loc.add(d);
@@ -360,7 +475,7 @@ class Bot {
                 || target.get_y() >= m_map.get_height()) {
               continue;
             }
-            if (m_gc.is_occupiable(target)) {
+            if (m_gc.can_replicate(worker.get_id(), d)) {
               m_gc.replicate(worker.get_id(), d);
               karbonite -= replicate_cost;
               replicated_worker_ids.push_back(m_gc.sense_unit_at_location(target).get_id());
@@ -389,7 +504,7 @@ class Bot {
     if (factory_entry == unit_tally.units_by_type.end()) {
       return;
     }
-    list<unsigned int> &factory_ids = factory_entry->second;
+    ArenaList<unsigned int> &factory_ids = factory_entry->second;
 
     unsigned int karbonite = m_gc.get_karbonite();
     unsigned int cost = unit_type_get_factory_cost(type);
@@ -478,11 +593,15 @@ class Bot {
     }
   }
 
-  void moveAllUnitsTowardEnemies(const UnitTally &tally) {
+  /*
+   * With fights_only, skip everything but units that are already near the enemy, to save time.
+   */
+  void moveAllUnitsTowardEnemies(const UnitTally &tally, bool fights_only) {
+    PROFILE_SPAN("army");
     // TODO: store enemy unit locations in a more abstract way, ie with an EnemyUnitTracker, sort of like the allied UnitTally
     // TODO: make a separate class for this, because a lot of variable state needs to be transferred between enemy-detection code, micro code, and long-distance pathing code
 
-    list<Unit> enemy_units;
+    ArenaList<Unit> enemy_units;
     const auto all_units = m_gc.get_units();
     for (const Unit &unit : all_units) {
       if (unit.get_team() == m_team) {
@@ -490,21 +609,29 @@ class Bot {
       }
       enemy_units.push_back(unit);
     }
+    rememberEnemies(enemy_units);
 
     // maps can be at most 50x50
     // this means there could be 2500 units on a map at once
     // we can do about 5,000,000 operations in 50ms. 2500^2 is 6,250,000, which means we can only do it if we have time saved up from earlier.
 
-    list<const Unit *> safe, needs_micro;
+    ArenaList<const Unit *> safe, needs_micro;
     checkDangerZone(enemy_units, tally, safe, needs_micro);
+    if (!needs_micro.empty()) {
+      m_time_bank.markSpike();
+    } else if (!enemy_units.empty()) {
+      m_time_bank.expectSpike(m_gc.get_round() + fight_warning_rounds);
+    }
     // TODO: create a quad-tree or bucketing data structure (if we only care about queries of a few known radii), so we can efficiently look up which units are near another unit.
-    tryMicroing(enemy_units, needs_micro);
+    tryMicroing(enemy_units, needs_micro, !fights_only);
 
-    tryMoveTowardEnemies(enemy_units, safe);
+    if (!fights_only) {
+      tryMoveTowardEnemies(enemy_units, safe);
+    }
   }
 
-  void checkDangerZone(const list<Unit> enemy_units, const UnitTally &unit_tally, list<const Unit *> &safe,
-                       list<const Unit *> &unsafe) {
+  void checkDangerZone(const ArenaList<Unit> enemy_units, const UnitTally &unit_tally, ArenaList<const Unit *> &safe,
+                       ArenaList<const Unit *> &unsafe) {
     // the slow way
     for (const auto &type_with_list : unit_tally.units_by_type) {
       if (type_with_list.first == UnitType::Factory || type_with_list.first == UnitType::Rocket) {
@@ -550,83 +677,463 @@ class Bot {
     }
   }
 
-  void tryMicroing(list<Unit> &enemy_units, const list<const Unit *> units) {
-    // just move toward the enemy and attack when in range
+  void tryMicroing(ArenaList<Unit> &enemy_units, const ArenaList<const Unit *> units, bool allow_search) {
+    // pick a stance for the whole group, then move toward the enemy and attack when in range
     // again, these lookups are super slow
+    const Stance stance = chooseStance(enemy_units, units);
+    // small fights get searched properly. anyone the search doesn't get to falls back to the stance.
+    m_searched_moves.clear();
+    if (allow_search) {
+      searchMicroMoves();
+    }
+    prepareKiting(enemy_units, units);
 
+    m_shooters.clear();
+    m_mages.clear();
     for (const Unit *our_unit : units) {
       if (our_unit->get_unit_type() == UnitType::Worker) {
-        tryMicroingWorker(*our_unit, enemy_units);
+        tryKiting(*our_unit, stance);
       } else {
         // TODO: should split this logic up for different attackers
-        tryMicroing(*our_unit, enemy_units);
+        bool moved;
+        auto searched = m_searched_moves.find(our_unit->get_id());
+        if (searched != m_searched_moves.end()) {
+          moved = searched->second != Direction::Center && m_gc.can_move(our_unit->get_id(), searched->second);
+          if (moved) {
+            m_gc.move_robot(our_unit->get_id(), searched->second);
+          }
+        } else if (our_unit->get_unit_type() == UnitType::Ranger || our_unit->get_unit_type() == UnitType::Healer) {
+          moved = tryKiting(*our_unit, stance);
+        } else {
+          moved = tryMicroing(*our_unit, enemy_units, stance);
+        }
+        if (our_unit->get_damage() > 0 && our_unit->get_attack_heat() < max_ready_heat) {
+          const Unit shooter = moved ? m_gc.get_unit(our_unit->get_id()) : *our_unit;
+          if (shooter.get_unit_type() == UnitType::Mage) {
+            // mages splash, so they pick targets differently. see splashWithMages().
+            if (shooter.is_on_map()) {
+              m_mages.push_back(shooter);
+            }
+          } else if (shooter.is_on_map()) {
+            MapLocation loc = shooter.get_map_location();
+            unsigned int min_range_sq =
+                shooter.get_unit_type() == UnitType::Ranger ? shooter.get_ranger_cannot_attack_range() : 0;
+            m_shooters.push_back(FocusFireSolver::Shooter{shooter.get_id(), loc.get_x(), loc.get_y(),
+                                                          shooter.get_damage(), shooter.get_attack_range(),
+                                                          min_range_sq});
+          }
+        }
       }
     }
 
+    // mages go first, so the focus fire knows what's already been hit
+    splashWithMages(enemy_units, m_mages);
+    focusFire(enemy_units, m_shooters);
+    // then abilities, so overcharge can go to units that just fired
+    useAbilities(enemy_units);
   }
 
-  // TODO: move to micro file
-  const unsigned int effective_ranger_range = 72;
-  const unsigned int effective_mage_range = 45;
-  const unsigned int effective_knight_range = 5;
+  // how far ahead to simulate when choosing a stance. rangers attack every other round, so this is a few volleys.
+  const int stance_simulation_rounds = 6;
 
-  unsigned int getEffectiveRange(const UnitType &type) {
-    // range + 1 movement
-    switch (type) {
-      case UnitType::Ranger:
-        return effective_ranger_range;
-      case UnitType::Mage:
-        return effective_mage_range;
-      case UnitType::Knight:
-        return effective_knight_range;
+  /*
+   * Simulate the next few rounds of the fight a few different ways, and pick whatever comes out ahead.
+   */
+  Stance chooseStance(const ArenaList<Unit> &enemy_units, const ArenaList<const Unit *> &units) {
+    m_our_combat_team.clear();
+    m_their_combat_team.clear();
+    m_our_combat_units.clear();
+    for (const Unit *our_unit : units) {
+      if (our_unit->get_unit_type() != UnitType::Worker && our_unit->is_on_map()) {
+        addToCombatTeam(*our_unit, m_our_combat_team);
+        m_our_combat_units.push_back(our_unit);
+      }
+    }
+    for (const Unit &enemy_unit : enemy_units) {
+      if (enemy_unit.is_robot() && enemy_unit.is_on_map()) {
+        addToCombatTeam(enemy_unit, m_their_combat_team);
+      }
     }
-    return 0;
+    if (m_our_combat_team.size() == 0 || m_their_combat_team.size() == 0) {
+      return Stance::Advance;
+    }
+    return m_combat_simulator.bestStance(m_our_combat_team, m_their_combat_team, stance_simulation_rounds);
   }
 
-  void tryMicroingWorker(const Unit &worker, list<Unit> &enemy_units) {
-    MapLocation our_loc = getMapLocationOrGarrisonMapLocation(worker, m_gc);
-    const Unit *closest_enemy = nullptr;
-    MapLocation closest_maploc;
-    unsigned int closest_distsq = 2 * 51 * 51;
-    for (auto enemy_iter = enemy_units.cbegin(); enemy_iter != enemy_units.cend();) {
-      const Unit &enemy_unit = *enemy_iter;
-      // it might already be dead
-      if (!m_gc.has_unit(enemy_unit.get_id())) {
-        // remove from list while iterating
-        enemy_units.erase(enemy_iter++);
+  // the search never gets more than this, and only as much as the time bank can spare
+  const unsigned int max_micro_search_ms = 30;
+  const int micro_search_rounds = 4;
+
+  /*
+   * Fills m_searched_moves for the units in the combat teams built by chooseStance(), if the fight is small enough
+   * and there's time.
+   */
+  void searchMicroMoves() {
+    PROFILE_SPAN("micro_search");
+    m_searched_moves.clear();
+    if (m_our_combat_team.size() == 0 || m_their_combat_team.size() == 0 ||
+        m_our_combat_team.size() > MicroSearch::max_units || m_their_combat_team.size() > MicroSearch::max_units) {
+      return;
+    }
+    const unsigned int budget_ms = m_time_bank.grant(max_micro_search_ms);
+    if (budget_ms == 0) {
+      return;
+    }
+
+    m_legal_moves.clear();
+    for (const Unit *our_unit : m_our_combat_units) {
+      uint16_t legal = 0;
+      if (our_unit->get_movement_heat() < max_ready_heat) {
+        for (int i = 0; i < MicroSearch::center; ++i) {
+          if (m_gc.can_move(our_unit->get_id(), directions_incl_center[i])) {
+            legal |= 1 << i;
+          }
+        }
+      }
+      m_legal_moves.push_back(legal);
+    }
+
+    m_micro_search.search(m_our_combat_team, m_their_combat_team, m_legal_moves, micro_search_rounds,
+                          std::chrono::milliseconds(budget_ms), m_micro_moves);
+    for (size_t i = 0; i < m_micro_moves.size(); ++i) {
+      if (m_micro_moves[i] != MicroSearch::undecided) {
+        m_searched_moves[m_our_combat_units[i]->get_id()] = directions_incl_center[m_micro_moves[i]];
+      }
+    }
+  }
+
+  void addToCombatTeam(const Unit &unit, CombatTeam &team) {
+    MapLocation loc = unit.get_map_location();
+    UnitType type = unit.get_unit_type();
+    float min_range_sq = type == UnitType::Ranger ? unit.get_ranger_cannot_attack_range() : 0.0f;
+    float defense = type == UnitType::Knight ? unit.get_knight_defense() : 0.0f;
+    team.add(loc.get_x(), loc.get_y(), unit.get_health(), unit.get_damage(), unit.get_attack_range(), min_range_sq,
+             defense, unit.get_attack_cooldown(), unit.get_attack_heat(), unit.get_movement_cooldown(),
+             unit.get_movement_heat());
+  }
+
+  /*
+   * Each mage hits whichever tile in its range does the most damage to the enemy and the least to us, one after the
+   * other, so later mages see what earlier ones already hit.
+   */
+  void splashWithMages(const ArenaList<Unit> &enemy_units, const vector<Unit> &mages) {
+    PROFILE_SPAN("splash");
+    if (mages.empty()) {
+      m_splash_grid.reset(m_map.get_height(), m_map.get_width(), 0.0f);
+      return;
+    }
+    m_splash_grid.reset(m_map.get_height(), m_map.get_width(), mages.front().get_damage());
+    for (const Unit &enemy_unit : enemy_units) {
+      if (enemy_unit.is_on_map()) {
+        MapLocation loc = enemy_unit.get_map_location();
+        float defense = enemy_unit.get_unit_type() == UnitType::Knight ? enemy_unit.get_knight_defense() : 0.0f;
+        m_splash_grid.addEnemy(loc.get_x(), loc.get_y(), enemy_unit.get_id(), enemy_unit.get_health(), defense);
+      }
+    }
+    for (const Unit &our_unit : m_gc.get_my_units()) {
+      if (our_unit.is_on_map()) {
+        MapLocation loc = our_unit.get_map_location();
+        m_splash_grid.addAlly(loc.get_x(), loc.get_y(), our_unit.get_health());
+      }
+    }
+    m_splash_grid.compute();
+
+    for (const Unit &mage : mages) {
+      MapLocation loc = mage.get_map_location();
+      int target_x, target_y;
+      if (!m_splash_grid.bestTargetInRange(loc.get_x(), loc.get_y(), mage.get_attack_range(), target_x, target_y)) {
         continue;
       }
-      MapLocation enemy_loc = getMapLocationOrGarrisonMapLocation(enemy_unit, m_gc);
-      unsigned int distsq = our_loc.distance_squared_to(enemy_loc);
-      if (distsq < closest_distsq && distsq <= getEffectiveRange(enemy_unit.get_unit_type())) {
-        closest_enemy = &enemy_unit;
-        closest_maploc = enemy_loc;
-        closest_distsq = distsq;
+      unsigned int target_id = m_splash_grid.enemyAt(target_x, target_y);
+      if (m_gc.can_attack(mage.get_id(), target_id)) {
+        m_gc.attack(mage.get_id(), target_id);
+        m_splash_grid.applySplash(target_x, target_y);
       }
-      ++enemy_iter;
     }
+  }
 
-    if (closest_enemy == nullptr) {
-      // false alarm
-      // TODO: add back to safe list
+  /*
+   * Attack with everyone at once, so shots get spread over the enemies instead of piling onto the same one.
+   */
+  void focusFire(const ArenaList<Unit> &enemy_units, const vector<FocusFireSolver::Shooter> &shooters) {
+    PROFILE_SPAN("focus_fire");
+    if (shooters.empty()) {
+      return;
+    }
+    m_fire_targets.clear();
+    for (const Unit &enemy_unit : enemy_units) {
+      if (!enemy_unit.is_on_map()) {
+        // can't shoot into a garrison
+        continue;
+      }
+      MapLocation enemy_loc = enemy_unit.get_map_location();
+      // the mages may have already hit it this turn
+      int health = static_cast<int>(enemy_unit.get_health()) -
+                   static_cast<int>(m_splash_grid.damageDealtAt(enemy_loc.get_x(), enemy_loc.get_y()));
+      if (health <= 0) {
+        continue;
+      }
+      int defense = enemy_unit.get_unit_type() == UnitType::Knight ? enemy_unit.get_knight_defense() : 0;
+      bool is_threat = enemy_unit.is_robot() && enemy_unit.get_damage() > 0;
+      m_fire_targets.push_back(FocusFireSolver::Target{enemy_unit.get_id(), enemy_loc.get_x(),
+                                                       enemy_loc.get_y(), health, defense, is_threat});
+    }
+
+    m_focus_fire.solve(shooters, m_fire_targets, m_map.get_height(), m_map.get_width(), m_shots);
+    for (const FocusFireSolver::Shot &shot : m_shots) {
+      // the solver works from our local copy of the game state, so double check
+      if (m_gc.can_attack(shot.shooter_id, shot.target_id)) {
+        m_gc.attack(shot.shooter_id, shot.target_id);
+      }
+    }
+  }
+
+  /*
+   * Plan every ability, heal and repair for the turn at once, then issue them in priority order.
+   */
+  void useAbilities(const ArenaList<Unit> &enemy_units) {
+    PROFILE_SPAN("abilities");
+    m_ability_allies.clear();
+    for (const Unit &our_unit : m_gc.get_my_units()) {
+      if (!our_unit.is_on_map()) {
+        continue;
+      }
+      MapLocation loc = our_unit.get_map_location();
+      AbilityPlanner::Ally ally{our_unit.get_id(), AbilityPlanner::Role::Structure, loc.get_x(), loc.get_y(),
+                                static_cast<int>(our_unit.get_health()), static_cast<int>(our_unit.get_max_health()),
+                                0, 0, 0, 0, false, false, false};
+      switch (our_unit.get_unit_type()) {
+        case UnitType::Factory:
+        case UnitType::Rocket:
+          ally.can_act = our_unit.structure_is_built();
+          break;
+        case UnitType::Worker:
+          ally.role = AbilityPlanner::Role::Worker;
+          ally.restore = our_unit.get_worker_repair_health();
+          ally.can_act = !our_unit.worker_has_acted();
+          break;
+        case UnitType::Healer:
+          ally.role = AbilityPlanner::Role::Healer;
+          // healers do negative damage
+          ally.restore = -our_unit.get_damage();
+          break;
+        case UnitType::Knight:
+          ally.role = AbilityPlanner::Role::Knight;
+          break;
+        case UnitType::Ranger:
+          ally.role = AbilityPlanner::Role::Ranger;
+          break;
+        case UnitType::Mage:
+          ally.role = AbilityPlanner::Role::Mage;
+          break;
+      }
+      if (our_unit.is_robot() && ally.role != AbilityPlanner::Role::Worker) {
+        if (ally.role != AbilityPlanner::Role::Healer) {
+          ally.damage = our_unit.get_damage();
+        }
+        ally.attack_range_sq = our_unit.get_attack_range();
+        ally.ability_range_sq = our_unit.get_ability_range();
+        ally.attack_ready = our_unit.get_attack_heat() < max_ready_heat;
+        ally.ability_ready = our_unit.is_ability_unlocked() && our_unit.get_ability_heat() < max_ready_heat;
+      }
+      m_ability_allies.push_back(ally);
+    }
+
+    m_ability_enemies.clear();
+    for (const Unit &enemy_unit : enemy_units) {
+      if (!enemy_unit.is_on_map() || !m_gc.has_unit(enemy_unit.get_id())) {
+        continue;
+      }
+      // it might have been shot this turn
+      const Unit current = m_gc.get_unit(enemy_unit.get_id());
+      MapLocation loc = current.get_map_location();
+      int defense = current.get_unit_type() == UnitType::Knight ? current.get_knight_defense() : 0;
+      int damage = current.is_robot() ? current.get_damage() : 0;
+      unsigned int range_sq = current.is_robot() ? current.get_attack_range() : 0;
+      m_ability_enemies.push_back(AbilityPlanner::Enemy{current.get_id(), loc.get_x(), loc.get_y(),
+                                                        static_cast<int>(current.get_health()), damage, range_sq,
+                                                        defense});
+    }
+
+    m_ability_planner.plan(m_ability_allies, m_ability_enemies, m_map.get_height(), m_map.get_width(),
+                           m_map_preprocessor.passable(), m_splash_grid, m_ability_actions);
+
+    // the planner works from our local copy of the game state, so double check everything
+    for (const AbilityPlanner::Action &action : m_ability_actions) {
+      const unsigned int id = action.unit_id;
+      const unsigned int target = action.target_id;
+      switch (action.ability) {
+        case AbilityPlanner::Ability::Overcharge:
+          if (m_gc.is_overcharge_ready(id) && m_gc.can_overcharge(id, target)) {
+            m_gc.overcharge(id, target);
+            attackAgain(target, enemy_units);
+          }
+          break;
+        case AbilityPlanner::Ability::Javelin:
+          if (m_gc.is_javelin_ready(id) && m_gc.can_javelin(id, target)) {
+            m_gc.javelin(id, target);
+          }
+          break;
+        case AbilityPlanner::Ability::Blink: {
+          MapLocation destination(m_planet, action.x, action.y);
+          if (m_gc.is_blink_ready(id) && m_gc.can_blink(id, destination)) {
+            m_gc.blink(id, destination);
+            if (m_gc.can_attack(id, target) && m_gc.is_attack_ready(id)) {
+              m_gc.attack(id, target);
+            }
+          }
+          break;
+        }
+        case AbilityPlanner::Ability::Heal:
+          if (m_gc.is_heal_ready(id) && m_gc.can_heal(id, target)) {
+            m_gc.heal(id, target);
+          }
+          break;
+        case AbilityPlanner::Ability::Repair:
+          if (m_gc.can_repair(id, target)) {
+            m_gc.repair(id, target);
+          }
+          break;
+      }
+    }
+  }
+
+  /*
+   * After an overcharge: shoot the weakest thing in range, or for mages the best splash.
+   */
+  void attackAgain(unsigned int id, const ArenaList<Unit> &enemy_units) {
+    if (!m_gc.is_attack_ready(id)) {
+      return;
+    }
+    const Unit unit = m_gc.get_unit(id);
+    MapLocation loc = unit.get_map_location();
+    if (unit.get_unit_type() == UnitType::Mage) {
+      int target_x, target_y;
+      if (m_splash_grid.bestTargetInRange(loc.get_x(), loc.get_y(), unit.get_attack_range(), target_x, target_y)) {
+        unsigned int target_id = m_splash_grid.enemyAt(target_x, target_y);
+        if (m_gc.can_attack(id, target_id)) {
+          m_gc.attack(id, target_id);
+          m_splash_grid.applySplash(target_x, target_y);
+        }
+      }
       return;
     }
+    unsigned int best_id = 0;
+    unsigned int best_health = 0;
+    bool found = false;
+    for (const Unit &enemy_unit : enemy_units) {
+      const unsigned int enemy_id = enemy_unit.get_id();
+      if (!m_gc.has_unit(enemy_id) || !m_gc.can_attack(id, enemy_id)) {
+        continue;
+      }
+      unsigned int health = m_gc.get_unit(enemy_id).get_health();
+      if (!found || health < best_health) {
+        best_id = enemy_id;
+        best_health = health;
+        found = true;
+      }
+    }
+    if (found) {
+      m_gc.attack(id, best_id);
+    }
+  }
+
+  void prepareKiting(const ArenaList<Unit> &enemy_units, const ArenaList<const Unit *> &units) {
+    PROFILE_SPAN("kiting");
+    m_kiting_planner.reset(m_map.get_height(), m_map.get_width());
+    for (const Unit &enemy_unit : enemy_units) {
+      if (!enemy_unit.is_on_map()) {
+        continue;
+      }
+      MapLocation loc = enemy_unit.get_map_location();
+      if (enemy_unit.is_robot()) {
+        m_kiting_planner.addEnemy(loc.get_x(), loc.get_y(), enemy_unit.get_damage(), enemy_unit.get_attack_range());
+      } else {
+        m_kiting_planner.addEnemy(loc.get_x(), loc.get_y(), 0, 0);
+      }
+    }
+    for (const Unit *our_unit : units) {
+      if (our_unit->is_on_map() && our_unit->get_health() < our_unit->get_max_health()) {
+        MapLocation loc = our_unit->get_map_location();
+        m_kiting_planner.addPatient(loc.get_x(), loc.get_y());
+      }
+    }
+    m_kiting_planner.build();
+  }
 
-    Direction away = closest_maploc.direction_to(our_loc);
-    pathInDirection(worker, away);
+  /*
+   * How much each unit type cares about getting shot, having something to shoot, and getting closer to the enemy.
+   * The stance decides whether closer is better or worse.
+   */
+  KitingPlanner::Weights kitingWeights(const Unit &unit, Stance stance) {
+    float toward = stance == Stance::Advance ? 1.0f : stance == Stance::Retreat ? -1.0f : 0.0f;
+    bool ready = unit.get_attack_heat() < max_ready_heat;
+    switch (unit.get_unit_type()) {
+      case UnitType::Ranger:
+        // worth taking a shot to give one
+        return KitingPlanner::Weights{1.0f, ready ? 2.0f * unit.get_damage() : 0.0f, 5.0f * toward};
+      case UnitType::Healer:
+        // healers do negative damage
+        return KitingPlanner::Weights{2.0f, ready ? -2.0f * unit.get_damage() : 0.0f, 2.0f * toward};
+      default:
+        // workers just get out of the way
+        return KitingPlanner::Weights{1.0f, 0.0f, 0.0f};
+    }
   }
 
-  void tryMicroing(const Unit &unit, list<Unit> &enemy_units) {
+  /*
+   * Score all 9 moves for the unit and make the best one. Returns whether the unit moved.
+   */
+  bool tryKiting(const Unit &unit, Stance stance) {
+    if (!unit.is_on_map() || unit.get_movement_heat() >= max_ready_heat) {
+      return false;
+    }
+    MapLocation loc = unit.get_map_location();
+    const unsigned int id = unit.get_id();
+    int goal_x, goal_y;
+    if (!m_kiting_planner.closestEnemy(loc.get_x(), loc.get_y(), goal_x, goal_y)) {
+      return false;
+    }
+    MapLocation goal(m_planet, goal_x, goal_y);
+
+    uint16_t legal = 0;
+    float goal_dist[KitingPlanner::num_moves];
+    // unreachable tiles count as no closer or further than where we are
+    const PathFinder::DistType here = m_path_finder.getDist(loc, goal);
+    for (int i = 0; i < KitingPlanner::num_moves; ++i) {
+      goal_dist[i] = here;
+      if (i == KitingPlanner::center || !m_gc.can_move(id, directions_incl_center[i])) {
+        continue;
+      }
+      legal |= 1 << i;
+      PathFinder::DistType dist = m_path_finder.getDist(loc.add(directions_incl_center[i]), goal);
+      if (dist < m_path_finder.infinity() && here < m_path_finder.infinity()) {
+        goal_dist[i] = dist;
+      }
+    }
+
+    KitingPlanner::Mover mover{loc.get_x(), loc.get_y(), static_cast<float>(unit.get_health()),
+                               unit.get_attack_range(),
+                               unit.get_unit_type() == UnitType::Ranger ? unit.get_ranger_cannot_attack_range() : 0,
+                               unit.get_unit_type() == UnitType::Healer};
+    int move = m_kiting_planner.chooseMove(mover, legal, goal_dist, kitingWeights(unit, stance));
+    if (move == KitingPlanner::center) {
+      return false;
+    }
+    m_gc.move_robot(id, directions_incl_center[move]);
+    return true;
+  }
+
+  /*
+   * Moves according to the group's stance: toward the closest enemy if nothing is in range, away from it, or not at
+   * all. Returns whether the unit moved. Attacking is done afterwards, for everyone at once, in focusFire().
+   */
+  bool tryMicroing(const Unit &unit, ArenaList<Unit> &enemy_units, Stance stance) {
     MapLocation our_loc = getMapLocationOrGarrisonMapLocation(unit, m_gc);
     const Unit *closest_enemy = nullptr;
     MapLocation closest_maploc;
     unsigned int closest_distsq = 2 * 51 * 51;
 
-    const Unit *weakest_attacker_in_range = nullptr;
-    unsigned int weakest_attacker_health = 10000;
-    const Unit *weakest_nonattacker_in_range = nullptr;
-    unsigned int weakest_nonattacker_health = 10000;
-
     unsigned int my_range_sq = unit.get_attack_range();
 
     for (auto enemy_iter = enemy_units.cbegin(); enemy_iter != enemy_units.cend();) {
@@ -639,21 +1146,6 @@ class Bot {
       }
       MapLocation enemy_loc = getMapLocationOrGarrisonMapLocation(enemy_unit, m_gc);
       unsigned int distsq = our_loc.distance_squared_to(enemy_loc);
-      if (distsq <= my_range_sq) {
-        unsigned int enemy_health = enemy_unit.get_health();
-        if (enemy_unit.is_robot() && enemy_unit.get_damage() > 0) {
-          if (enemy_health < weakest_attacker_health) {
-            weakest_attacker_health = enemy_health;
-            weakest_attacker_in_range = &enemy_unit;
-          }
-        } else {
-          if (enemy_health < weakest_nonattacker_health) {
-            weakest_nonattacker_health = enemy_health;
-            weakest_nonattacker_in_range = &enemy_unit;
-          }
-        }
-      }
-
       if (distsq < closest_distsq) {
         closest_enemy = &enemy_unit;
         closest_maploc = enemy_loc;
@@ -667,50 +1159,29 @@ class Bot {
     if (closest_enemy == nullptr) {
       // false alarm
       // TODO: add back to safe list
-      return;
+      return false;
     }
 
-    const Unit *best_target = nullptr;
-    // are we out of range?
-    bool in_range;
-    if (weakest_attacker_in_range != nullptr) {
-      in_range = true;
-      best_target = weakest_attacker_in_range;
-    } else if (weakest_nonattacker_in_range != nullptr) {
-      in_range = true;
-      best_target = weakest_nonattacker_in_range;
-    } else {
-      best_target = closest_enemy;
-      if (closest_distsq <= my_range_sq) {
-        in_range = true;
-      } else {
-        pathNaivelyTo(unit, closest_maploc);
-        Location loc = m_gc.get_unit(unit.get_id()).get_location();
-        if (loc.is_on_map()) {
-          MapLocation our_new_loc = loc.get_map_location();
-          in_range = our_new_loc.distance_squared_to(closest_maploc) <= my_range_sq;
-        } else {
-          in_range = false;
+    switch (stance) {
+      case Stance::Advance:
+        if (closest_distsq > my_range_sq) {
+          return pathNaivelyTo(unit, closest_maploc);
         }
-      }
-    }
-    // TODO: if we haven't moved yet, we might still want to move somewhere
-    // in large combat situations, we should probably just move away from the closest enemy
-    // in 1:1 situations, we should kite slower units with shorter range, but charge units with the same range so we
-    // get the first shot.
-
-    if (in_range) {
-      // TODO: replace this constant
-      if (unit.get_attack_heat() < 10) {
-        // TODO: this check shouldn't be necessary. why is in_range innaccurate?
-        if (m_gc.can_attack(unit.get_id(), best_target->get_id())) {
-          m_gc.attack(unit.get_id(), best_target->get_id());
+        break;
+      case Stance::Retreat:
+        if (unit.is_on_map()) {
+          return pathInDirection(unit, closest_maploc.direction_to(our_loc));
         }
-      }
+        break;
+      case Stance::Hold:
+        break;
     }
+    return false;
   }
 
-  void tryMoveTowardEnemies(const list<Unit> &enemy_units, const list<const Unit *> units) {
+  void tryMoveTowardEnemies(const ArenaList<Unit> &enemy_units, ArenaList<const Unit *> units) {
+    // rangers with nothing better to do can snipe whatever is sitting still
+    trySniping(units);
     if (m_planet == Planet::Earth) {
       // TODO: detect split map. On split map, spreading out (or at least moving in a circle) gives more mobility.
       tryMoveToStartingLocations(units);
@@ -719,10 +1190,106 @@ class Bot {
     }
   }
 
+  const unsigned int last_round = 1000;
+  const unsigned int ranger_snipe_research_level = 3;
+  // keep most of the idle rangers ready to fight
+  const unsigned int max_sniping_fraction = 2;
+
+  void rememberEnemies(const ArenaList<Unit> &enemy_units) {
+    m_snipe_planner.forgetVisible([this](int x, int y) {
+      return m_gc.can_sense_location(MapLocation(m_planet, x, y));
+    });
+    unsigned int round = m_gc.get_round();
+    for (const Unit &enemy_unit : enemy_units) {
+      if (!enemy_unit.is_on_map()) {
+        continue;
+      }
+      MapLocation loc = enemy_unit.get_map_location();
+      unsigned int priority;
+      switch (enemy_unit.get_unit_type()) {
+        case UnitType::Factory:
+          priority = 4;
+          break;
+        case UnitType::Worker:
+          // a worker that sits still is mining or building
+          priority = 2;
+          break;
+        case UnitType::Rocket:
+          // might take off before the snipe lands
+          priority = 1;
+          break;
+        default:
+          priority = 1;
+          break;
+      }
+      m_snipe_planner.observe(enemy_unit.get_id(), loc.get_x(), loc.get_y(), enemy_unit.get_health(), priority,
+                              enemy_unit.is_structure(), round);
+    }
+  }
+
+  /*
+   * Starts snipes with some of the idle rangers. Removes rangers that are (now) sniping from units, since they
+   * can't move anyway.
+   */
+  void trySniping(ArenaList<const Unit *> &units) {
+    PROFILE_SPAN("snipe");
+    if (m_gc.get_research_info().get_level(UnitType::Ranger) < ranger_snipe_research_level) {
+      return;
+    }
+    m_snipe_ready.clear();
+    unsigned int num_rangers = 0;
+    unsigned int num_sniping = 0;
+    unsigned int damage = 0;
+    unsigned int lead_time = 0;
+    for (auto it = units.begin(); it != units.end();) {
+      const Unit &unit = **it;
+      if (unit.get_unit_type() != UnitType::Ranger) {
+        ++it;
+        continue;
+      }
+      ++num_rangers;
+      if (unit.ranger_is_sniping()) {
+        ++num_sniping;
+        units.erase(it++);
+        continue;
+      }
+      if (unit.is_on_map() && m_gc.is_begin_snipe_ready(unit.get_id())) {
+        m_snipe_ready.push_back(unit.get_id());
+        damage = unit.get_damage();
+        lead_time = unit.get_ranger_max_countdown();
+      }
+      ++it;
+    }
+    unsigned int allowed = num_rangers / max_sniping_fraction;
+    if (allowed <= num_sniping) {
+      return;
+    }
+    if (m_snipe_ready.size() > allowed - num_sniping) {
+      m_snipe_ready.resize(allowed - num_sniping);
+    }
+
+    unsigned int round = m_gc.get_round();
+    m_snipe_planner.plan(m_snipe_ready, damage, round, lead_time, last_round, m_snipes);
+    ArenaVector<unsigned int> started;
+    for (const SnipePlanner::Snipe &snipe : m_snipes) {
+      MapLocation target(m_planet, snipe.x, snipe.y);
+      if (m_gc.can_begin_snipe(snipe.ranger_id, target)) {
+        m_gc.begin_snipe(snipe.ranger_id, target);
+        m_snipe_planner.begun(snipe, round + lead_time, damage);
+        started.push_back(snipe.ranger_id);
+      }
+    }
+    if (!started.empty()) {
+      units.remove_if([&started](const Unit *unit) {
+        return std::find(started.begin(), started.end(), unit->get_id()) != started.end();
+      });
+    }
+  }
+
   unique_ptr<list<MapLocation>> m_circle_path;
   list<MapLocation>::iterator m_circle_iter;
 
-  void tryMovingInACircle(const list<const Unit *> units) {
+  void tryMovingInACircle(const ArenaList<const Unit *> units) {
     // draw a rectangle 1/3 away from each border
     // if we're lucky, every edge point will be on the map
     if (!m_circle_path) {
@@ -769,31 +1336,165 @@ class Bot {
 
     MapLocation target = *m_circle_iter;
 
-    for (const Unit *our_unit : units) {
-      pathTo(*our_unit, target);
-    }
+    moveInSquads(units, target);
 
     if (m_gc.get_round() % 4 == 0) {
       ++m_circle_iter;
     }
   }
 
-  void tryMoveToStartingLocations(const list<const Unit *> units) {
+  void tryMoveToStartingLocations(const ArenaList<const Unit *> units) {
     // just pick one of the starting locations and go toward it
     // change it every few turns to mix things up
-    const vector<Unit> &initial_units = m_gc.get_starting_planet(m_planet).get_initial_units();
-    vector<const Unit *> initial_enemy_units;
-    for (const auto &unit : initial_units) {
-      if (unit.get_team() != m_team) {
-        initial_enemy_units.push_back(&unit);
-      }
+    const vector<PathFinder::RowCol> &enemy_starts = m_map_preprocessor.enemyStartingLocations();
+    if (enemy_starts.empty()) {
+      return;
     }
 
-    unsigned int target_idx = (m_gc.get_round() / 100U) % static_cast<unsigned int>(initial_enemy_units.size());
-    MapLocation target = initial_enemy_units[target_idx]->get_map_location();
+    unsigned int target_idx = (m_gc.get_round() / 100U) % static_cast<unsigned int>(enemy_starts.size());
+    MapLocation target(m_planet, enemy_starts[target_idx].second, enemy_starts[target_idx].first);
+
+    moveInSquads(units, target);
+  }
 
+  // squads smaller than this go join the closest bigger one instead of trickling toward the target alone
+  const size_t min_squad_size = 3;
+  // the front of a squad waits for the rest to catch up if it's more than about this many steps ahead
+  const FlowField::DistType max_squad_spread = 4 * FlowField::step_cost;
+
+  /*
+   * Group the units into squads, then move each squad along its own flow field, front first, so the ones behind can
+   * step into the tiles the front just left.
+   */
+  void moveInSquads(const ArenaList<const Unit *> &units, const MapLocation &target) {
+    PROFILE_SPAN("squads");
+    const int rows = m_map.get_height();
+    const int cols = m_map.get_width();
+    m_squad_units.clear();
+    m_squad_clusterer.reset(rows, cols);
     for (const Unit *our_unit : units) {
-      pathTo(*our_unit, target);
+      if (our_unit->is_on_map()) {
+        MapLocation loc = our_unit->get_map_location();
+        m_squad_clusterer.add(our_unit->get_id(), loc.get_x(), loc.get_y());
+        m_squad_units.push_back(our_unit);
+      }
+    }
+    m_squad_clusterer.cluster();
+    const vector<SquadClusterer::Squad> &squads = m_squad_clusterer.squads();
+
+    // everyone's flow field steers around the same crowds
+    m_occupied.assign(static_cast<size_t>(rows * cols), 0);
+    for (const Unit *our_unit : m_squad_units) {
+      MapLocation loc = our_unit->get_map_location();
+      m_occupied[loc.get_y() * cols + loc.get_x()] = 1;
+    }
+    for (const auto &id_and_loc : m_structure_locations) {
+      if (id_and_loc.second.get_planet() == m_planet) {
+        m_occupied[id_and_loc.second.get_y() * cols + id_and_loc.second.get_x()] = 1;
+      }
+    }
+    FlowField::computeDensity(m_occupied, rows, cols, m_density);
+    m_is_mover.assign(static_cast<size_t>(rows * cols), false);
+    m_squad_movers.clear();
+
+    map<unsigned int, FlowField> flow_fields;
+    for (const SquadClusterer::Squad &squad : squads) {
+      int goal_x = target.get_x();
+      int goal_y = target.get_y();
+      if (squad.members.size() < min_squad_size) {
+        regroupGoal(squad, squads, goal_x, goal_y);
+      }
+
+      // flow fields are only recomputed from scratch when a squad's goal changes. otherwise, just around the crowds.
+      auto old_field = m_flow_fields.find(squad.id);
+      FlowField &field = flow_fields[squad.id];
+      if (old_field != m_flow_fields.end()) {
+        field = std::move(old_field->second);
+      }
+      if (field.goalX() != goal_x || field.goalY() != goal_y) {
+        field.compute(goal_x, goal_y, m_map_preprocessor.passable(), m_density, rows, cols);
+      } else {
+        field.updateDensity(m_map_preprocessor.passable(), m_density);
+      }
+
+      m_squad_order.clear();
+      for (unsigned int member : squad.members) {
+        MapLocation loc = m_squad_units[member]->get_map_location();
+        m_squad_order.emplace_back(field.distAt(loc.get_x(), loc.get_y()), member);
+      }
+      std::sort(m_squad_order.begin(), m_squad_order.end());
+      // the rear is the 3/4 mark, so a single unit stuck behind a wall doesn't hold everyone up
+      const FlowField::DistType rear = m_squad_order[m_squad_order.size() * 3 / 4].first;
+
+      for (const auto &dist_and_member : m_squad_order) {
+        if (rear != field.infinity() && dist_and_member.first + max_squad_spread < rear) {
+          continue;
+        }
+        const Unit &unit = *m_squad_units[dist_and_member.second];
+        if (unit.get_movement_heat() >= max_ready_heat) {
+          continue;
+        }
+        MapLocation loc = unit.get_map_location();
+        m_is_mover[loc.get_y() * cols + loc.get_x()] = true;
+        m_squad_movers.emplace_back(&unit, &field);
+      }
+    }
+
+    // everyone says where they'd like to go, then the resolver orders the moves so nobody trips over a leader
+    m_move_resolver.reset(rows, cols);
+    for (const auto &unit_and_field : m_squad_movers) {
+      const Unit &unit = *unit_and_field.first;
+      const FlowField &field = *unit_and_field.second;
+      MapLocation loc = unit.get_map_location();
+      const FlowField::DistType here = field.distAt(loc.get_x(), loc.get_y());
+      int moves[FlowField::num_moves - 1];
+      int num_moves = field.bestMoves(loc.get_x(), loc.get_y(), moves);
+      int choices[MoveResolver::max_choices];
+      int num_choices = 0;
+      for (int i = 0; i < num_moves; ++i) {
+        MapLocation next = loc.add(directions_incl_center[moves[i]]);
+        // only downhill, or the back of a jam shuffles around instead of waiting its turn
+        if (field.distAt(next.get_x(), next.get_y()) > here) {
+          break;
+        }
+        if (m_is_mover[next.get_y() * cols + next.get_x()] || m_gc.is_occupiable(next)) {
+          choices[num_choices++] = moves[i];
+        }
+      }
+      m_move_resolver.add(unit.get_id(), loc.get_x(), loc.get_y(), choices, num_choices);
+    }
+    m_move_resolver.resolve(m_resolved_moves);
+    for (const MoveResolver::Move &move : m_resolved_moves) {
+      const Direction &dir = directions_incl_center[move.direction];
+      if (m_gc.can_move(move.unit_id, dir)) {
+        m_gc.move_robot(move.unit_id, dir);
+      }
+    }
+
+    // squads that are gone take their flow fields with them
+    m_flow_fields.swap(flow_fields);
+  }
+
+  /*
+   * Sets the goal to the member of the closest big-enough squad that's nearest to this squad.
+   */
+  void regroupGoal(const SquadClusterer::Squad &squad, const vector<SquadClusterer::Squad> &squads, int &goal_x,
+                   int &goal_y) {
+    MapLocation from = m_squad_units[squad.members.front()]->get_map_location();
+    unsigned int closest_distsq = UINT32_MAX;
+    for (const SquadClusterer::Squad &other : squads) {
+      if (other.members.size() < min_squad_size) {
+        continue;
+      }
+      for (unsigned int member : other.members) {
+        MapLocation loc = m_squad_units[member]->get_map_location();
+        unsigned int distsq = from.distance_squared_to(loc);
+        if (distsq < closest_distsq) {
+          closest_distsq = distsq;
+          goal_x = loc.get_x();
+          goal_y = loc.get_y();
+        }
+      }
     }
   }
 
@@ -805,7 +1506,7 @@ class Bot {
    * For long-distance pathing, take advantage of the pre-computed shortest path
    */
   void pathTo(const Unit &unit, const MapLocation &target) {
-    if (unit.get_movement_heat() >= 10) {
+    if (unit.get_movement_heat() >= max_ready_heat) {
       return;
     }
     if (!unit.is_on_map()) {
@@ -849,8 +1550,7 @@ class Bot {
   }
 
   bool pathInDirection(const Unit &unit, const Direction &target_dir) {
-    // TODO: is there a constant for this?
-    if (unit.get_movement_heat() >= 10) {
+    if (unit.get_movement_heat() >= max_ready_heat) {
       return false;
     }
     unsigned int id = unit.get_id();
@@ -861,9 +1561,14 @@ class Bot {
         return true;
       }
     }
+    return false;
   }
 
-  void collectKarbonite(UnitTally &unit_tally) {
+  /*
+   * With harvest_only, workers that have nothing to harvest where they are stay put instead of going looking.
+   */
+  void collectKarbonite(UnitTally &unit_tally, bool harvest_only) {
+    PROFILE_SPAN("harvest");
     if (m_map_preprocessor.coarseKarboniteLocationsToAnyFineLocations().empty()) {
       // map exhausted
       return;
@@ -882,12 +1587,12 @@ class Bot {
       }
 
       MapLocation worker_loc = worker.get_map_location();
-      if (tryHarvestingKarbs(worker.get_worker_harvest_amount(), worker_loc, worker_id)) {
+      if (tryHarvestingKarbs(worker.get_worker_harvest_amount(), worker_loc, worker_id) || harvest_only) {
         continue;
       }
 
       // no karbonite nearby? explore!
-      if (worker.get_movement_heat() >= 10) {
+      if (worker.get_movement_heat() >= max_ready_heat) {
         continue;
       }
       bool moved = false;
@@ -948,20 +1653,25 @@ class Bot {
                           const unsigned int &worker_id) {
     unsigned int most_karbs = 0;
     const Direction *best_dir;
-    for (const Direction &dir : directions_incl_center) {
-      MapLocation loc = worker_loc.add(dir);
-      if (!m_path_finder.is_in_map_bounds(loc)) {
+    MapLocation best_loc;
+    // only tiles flagged in the presence mask need a round trip to the engine
+    uint16_t candidates = m_map_preprocessor.karboniteNeighborMask(worker_loc);
+    for (unsigned int dir_index = 0; candidates != 0; ++dir_index, candidates >>= 1) {
+      if (!(candidates & 1U)) {
         continue;
       }
+      const Direction &dir = directions_incl_center[dir_index];
+      MapLocation loc = worker_loc.add(dir);
       unsigned int karbs = m_map_preprocessor.queryKarboniteIfNonzero(loc);
       if (karbs > most_karbs) {
         most_karbs = karbs;
         best_dir = &dir;
+        best_loc = loc;
       }
     }
     if (most_karbs > 0) {
       m_gc.harvest(worker_id, *best_dir);
-      m_map_preprocessor.updateKarbonite(worker_loc, most_karbs - std::min(most_karbs, worker_harvest_amount), false);
+      m_map_preprocessor.updateKarbonite(best_loc, most_karbs - std::min(most_karbs, worker_harvest_amount), false);
       return true;
     }
     return false;
@@ -976,18 +1686,67 @@ class Bot {
   PathFinder m_path_finder;
   MapPreprocessor m_map_preprocessor;
   Messenger m_messenger;
+  TurnScheduler m_scheduler;
+  TimeBank m_time_bank;
 
   map<unsigned int, list<unsigned int>> m_construction_sites_to_workers;
   set<unsigned int> m_workers_tasked_to_build;
+  map<unsigned int, MapLocation> m_structure_locations;
+
+  SquadClusterer m_squad_clusterer;
+  vector<const Unit *> m_squad_units;
+  vector<std::pair<FlowField::DistType, unsigned int>> m_squad_order;
+  map<unsigned int, FlowField> m_flow_fields;
+  vector<uint8_t> m_occupied;
+  vector<uint8_t> m_density;
+  vector<bool> m_is_mover;
+  vector<std::pair<const Unit *, const FlowField *>> m_squad_movers;
+  MoveResolver m_move_resolver;
+  vector<MoveResolver::Move> m_resolved_moves;
+
+  FocusFireSolver m_focus_fire;
+  KitingPlanner m_kiting_planner;
+  SplashGrid m_splash_grid;
+  AbilityPlanner m_ability_planner;
+  vector<AbilityPlanner::Ally> m_ability_allies;
+  vector<AbilityPlanner::Enemy> m_ability_enemies;
+  vector<AbilityPlanner::Action> m_ability_actions;
+  SnipePlanner m_snipe_planner;
+  vector<unsigned int> m_snipe_ready;
+  vector<SnipePlanner::Snipe> m_snipes;
+  CombatSimulator m_combat_simulator;
+  CombatTeam m_our_combat_team;
+  CombatTeam m_their_combat_team;
+  vector<const Unit *> m_our_combat_units;
+  MicroSearch m_micro_search;
+  vector<uint16_t> m_legal_moves;
+  vector<int8_t> m_micro_moves;
+  map<unsigned int, Direction> m_searched_moves;
+  vector<FocusFireSolver::Shooter> m_shooters;
+  vector<Unit> m_mages;
+  vector<FocusFireSolver::Target> m_fire_targets;
+  vector<FocusFireSolver::Shot> m_shots;
 
 };
 
 
-int main(int argv, char **argc) {
+int main(int argc, char **argv) {
 
   srand(0);
 
   GameController gc;
+  // tools/sim runs all four players in one process, where these are shared, so it opens the reports itself
+  const bool shared_outputs = argc > 1 && strcmp(argv[1], "--shared-outputs") == 0;
+  if (!shared_outputs) {
+    profiler_open_report(gc.get_planet() == Planet::Earth ? "profile-earth.csv" : "profile-mars.csv");
+    allocation_open_report(gc.get_planet() == Planet::Earth ? "allocations-earth.csv" : "allocations-mars.csv");
+#ifndef NDEBUG
+    // logs are written out by another thread, so they don't eat into the turn
+    log_open(gc.get_planet() == Planet::Earth ? "log-earth.txt" : "log-mars.txt");
+#endif
+    trace_open(gc, gc.get_planet() == Planet::Earth ? "trace-earth.bin" : "trace-mars.bin");
+  }
+
   Bot bot(gc);
 
   CHECK_ERRORS();
@@ -996,13 +1755,21 @@ int main(int argv, char **argc) {
 
   // loop through the whole game.
   while (true) {
+    trace_record_turn(gc);
     debug_print_status_update(gc);
     shuffle_directions();
     bot.turn();
 
     CHECK_ERRORS();
 
-    fflush(stdout);
+    allocation_end_turn(gc.get_round());
+    if (gc.get_round() >= bot.last_round) {
+      profiler_write_report();
+      allocation_write_report();
+      log_close();
+    }
+
+    log_end_turn();
     gc.next_turn();
   }
 }
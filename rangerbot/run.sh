@@ -16,9 +16,22 @@ else
 fi
 
 debug=1
+# count allocations per turn and per profiler span, see AllocationTracker.h
+track_allocations=0
+# record what the bot sees every turn, for tools/replay. see TurnRecorder.h
+record=0
 
 FLAGS="-fno-rtti -fno-exceptions -march=native"
 
+if [ $track_allocations -eq 1 ]; then
+  # -rdynamic lets the tracker name the std:: frames it skips when finding call sites
+  FLAGS="$FLAGS -DRANGERBOT_TRACK_ALLOCATIONS -rdynamic"
+fi
+
+if [ $record -eq 1 ]; then
+  FLAGS="$FLAGS -DRANGERBOT_RECORD"
+fi
+
 if [ $debug -eq 1 ]; then
   EXTRA_FLAGS="-g -DBACKTRACE"
 else
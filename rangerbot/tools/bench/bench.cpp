@@ -0,0 +1,552 @@
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <malloc.h>
+#include <sys/resource.h>
+
+// through the links in build/src, so the bot's headers pick up the stand-in api
+#include "FlowField.h"
+#include "MapPreprocessor.h"
+#include "PathFinding.h"
+
+#include "../offline/MapLoader.h"
+#include "../offline/Stats.h"
+#include "../offline/World.h"
+
+/*
+ * Times the bot's map preprocessing on every map in a directory, for both planets: each stage of
+ * MapPreprocessor::process() (MapPreprocessor::stageTimes()), the other kinds of BFS the bot runs, and loops over
+ * PathFinder::getDist() like the ones in main.cpp. Build with tools/build.sh bench, and measure every change to
+ * PathFinder or MapPreprocessor with it.
+ *
+ *   bench battlecode-maps > baseline.json          a line per map on stderr, JSON results on stdout
+ *   bench battlecode-maps 20                       20 runs per map rather than 10
+ *   bench battlecode-maps 10 baseline.json         also compares against a saved run, and fails on regressions
+ *
+ * Each run starts from a fresh World, PathFinder and MapPreprocessor, the way a game does. Times are the fastest, p50
+ * and p99 of the runs, memory is what the heap grew by for the PathFinder and MapPreprocessor, all pairs table
+ * included. Comparisons are between the fastest runs, which move the least between runs of the same code: a stage
+ * regresses on a map when its fastest run is slower than the baseline's by the ratio, and so does its total over all
+ * maps. A map that looks slower is run again before it fails the comparison. Compare with as many runs as the baseline
+ * has.
+ *
+ * Besides the stages of process():
+ *   flow_field                FlowField::compute() to each of the goals, around the starting units
+ *   claim_territory           MapPreprocessor::claimTerritory() on each of the goals, one after the other (earth only)
+ *   get_dist_table            getDist() between every pair of tiles
+ *   get_dist_steps            getDist() from every tile next to every passable tile to each of the goals
+ *   get_dist_karbonite        nearest karbonite field from every passable tile, like the workers look for it
+ *
+ * The goals are num_goals passable tiles spread over the map.
+ */
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+typedef PathFinder::DistType DistType;
+
+const char *const planet_names[2] = {"earth", "mars"};
+const unsigned int default_runs = 10;
+const size_t num_goals = 16;
+// a map is a regression when it's slower than the baseline by both the ratio and the floor, which keeps out noise on
+// stages that take microseconds. the fastest runs of the same code move by up to 5% in total between passes, and by up
+// to 25% on a single map, which the rechecks mostly even out.
+const double regression_ratio = 1.15;
+const double total_regression_ratio = 1.08;
+const double regression_floor_ms = 0.1;
+const double regression_floor_mb = 0.5;
+// how many times the maps that look slower are run again, before they count as regressions
+const unsigned int max_rechecks = 3;
+
+// loops add their results here, so they aren't optimized away
+volatile uint64_t sink;
+
+double elapsed_ms(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+double heap_mb() {
+  const struct mallinfo2 info = mallinfo2();
+  return (info.uordblks + info.hblkhd) / static_cast<double>(1 << 20);
+}
+
+std::string map_name(const std::string &path) {
+  const size_t slash = path.rfind('/');
+  const std::string file = slash == std::string::npos ? path : path.substr(slash + 1);
+  return file.substr(0, file.rfind('.'));
+}
+
+// one map on one planet
+struct Case {
+  std::string map;
+  uint8_t planet = World::Earth;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  double memory_mb = 0;
+  // in the order they first ran
+  std::vector<std::pair<std::string, std::vector<double>>> stages;
+
+  void add(const std::string &stage, double ms) {
+    for (auto &entry : stages) {
+      if (entry.first == stage) {
+        entry.second.push_back(ms);
+        return;
+      }
+    }
+    stages.emplace_back(stage, std::vector<double>(1, ms));
+  }
+};
+
+class PreprocessingBenchmark {
+ public:
+  PreprocessingBenchmark(const GameMap &map, uint8_t planet) : m_map(map), m_planet(planet) {}
+
+  void run(Case &result) {
+    World world;
+    World::setCurrent(&world);
+    world.setMap(m_map.maps[World::Earth]);
+    world.setMap(m_map.maps[World::Mars]);
+    world.setAsteroids(m_map.asteroids);
+    world.setPerspective(0, m_planet);
+    for (const TraceMap &map : m_map.maps) {
+      for (const TraceUnit &unit : map.initial_units) {
+        world.addUnit(unit);
+      }
+    }
+    bc::GameController gc;
+    const bc::PlanetMap &planet_map = gc.get_starting_planet(static_cast<bc::Planet>(m_planet));
+
+    const double heap_before = heap_mb();
+    const Clock::time_point start = Clock::now();
+    PathFinder path_finder(gc, planet_map);
+    MapPreprocessor preprocessor(gc, path_finder, planet_map);
+    preprocessor.process();
+    result.add("preprocess", elapsed_ms(start));
+    result.memory_mb = std::max(result.memory_mb, heap_mb() - heap_before);
+    bool has_territory = false;
+    for (const MapPreprocessor::StageTime &stage : preprocessor.stageTimes()) {
+      result.add(stage.name, stage.ms);
+      has_territory |= std::string(stage.name) == "territory";
+    }
+
+    const TraceMap &map = m_map.maps[m_planet];
+    m_rows = static_cast<int>(map.height);
+    m_cols = static_cast<int>(map.width);
+    const std::vector<bool> &passable = preprocessor.passable();
+    std::vector<int> goals = spreadTiles(passable);
+
+    timeFlowField(passable, goals, result);
+    if (has_territory) {
+      timeClaims(preprocessor, goals, result);
+    }
+    timeDistTable(path_finder, result);
+    timeDistSteps(path_finder, passable, goals, result);
+    timeDistToKarbonite(path_finder, preprocessor, result);
+  }
+
+ private:
+  std::vector<int> spreadTiles(const std::vector<bool> &passable) const {
+    std::vector<int> tiles;
+    for (int index = 0; index < m_rows * m_cols; ++index) {
+      if (passable[index]) {
+        tiles.push_back(index);
+      }
+    }
+    std::vector<int> goals;
+    for (size_t i = 0; i < std::min(num_goals, tiles.size()); ++i) {
+      goals.push_back(tiles[i * tiles.size() / std::min(num_goals, tiles.size())]);
+    }
+    return goals;
+  }
+
+  void timeFlowField(const std::vector<bool> &passable, const std::vector<int> &goals, Case &result) const {
+    std::vector<uint8_t> occupied(static_cast<size_t>(m_rows * m_cols), 0);
+    for (const TraceUnit &unit : m_map.maps[m_planet].initial_units) {
+      occupied[unit.y * m_cols + unit.x] = 1;
+    }
+    std::vector<uint8_t> density;
+    FlowField::computeDensity(occupied, m_rows, m_cols, density);
+
+    const Clock::time_point start = Clock::now();
+    FlowField field;
+    for (const int goal : goals) {
+      field.compute(goal % m_cols, goal / m_cols, passable, density, m_rows, m_cols);
+      sink += field.distAt(0, 0);
+    }
+    result.add("flow_field", elapsed_ms(start));
+  }
+
+  void timeClaims(MapPreprocessor &preprocessor, const std::vector<int> &goals, Case &result) const {
+    const Clock::time_point start = Clock::now();
+    for (const int goal : goals) {
+      preprocessor.claimTerritory(bc::MapLocation(static_cast<bc::Planet>(m_planet), goal % m_cols, goal / m_cols));
+    }
+    sink += preprocessor.territoryKarbonite(Territory::Ours);
+    result.add("claim_territory", elapsed_ms(start));
+  }
+
+  void timeDistTable(PathFinder &path_finder, Case &result) const {
+    const Clock::time_point start = Clock::now();
+    uint64_t total = 0;
+    for (DistType from_row = 0; from_row < m_rows; ++from_row) {
+      for (DistType from_col = 0; from_col < m_cols; ++from_col) {
+        for (DistType to_row = 0; to_row < m_rows; ++to_row) {
+          for (DistType to_col = 0; to_col < m_cols; ++to_col) {
+            total += path_finder.getDist(from_row, from_col, to_row, to_col);
+          }
+        }
+      }
+    }
+    sink += total;
+    result.add("get_dist_table", elapsed_ms(start));
+  }
+
+  void timeDistSteps(PathFinder &path_finder, const std::vector<bool> &passable, const std::vector<int> &goals,
+                     Case &result) const {
+    const Clock::time_point start = Clock::now();
+    uint64_t total = 0;
+    for (const int goal : goals) {
+      const PathFinder::RowCol to(static_cast<DistType>(goal / m_cols), static_cast<DistType>(goal % m_cols));
+      for (int row = 0; row < m_rows; ++row) {
+        for (int col = 0; col < m_cols; ++col) {
+          if (!passable[row * m_cols + col]) {
+            continue;
+          }
+          DistType best = path_finder.infinity();
+          for (int dr = -1; dr <= 1; ++dr) {
+            for (int dc = -1; dc <= 1; ++dc) {
+              const int r = row + dr;
+              const int c = col + dc;
+              if (r >= 0 && c >= 0 && r < m_rows && c < m_cols) {
+                best = std::min(best, path_finder.getDist(PathFinder::RowCol(r, c), to));
+              }
+            }
+          }
+          total += best;
+        }
+      }
+    }
+    sink += total;
+    result.add("get_dist_steps", elapsed_ms(start));
+  }
+
+  void timeDistToKarbonite(PathFinder &path_finder, MapPreprocessor &preprocessor, Case &result) const {
+    const std::map<DistType, PathFinder::RowCol> &fields = preprocessor.coarseKarboniteLocationsToAnyFineLocations();
+    const std::vector<bool> &passable = preprocessor.passable();
+    const Clock::time_point start = Clock::now();
+    uint64_t total = 0;
+    for (DistType row = 0; row < m_rows; ++row) {
+      for (DistType col = 0; col < m_cols; ++col) {
+        if (!passable[row * m_cols + col]) {
+          continue;
+        }
+        DistType closest = path_finder.infinity();
+        for (const auto &coarse_and_fine : fields) {
+          closest = std::min(closest, path_finder.getDist(PathFinder::RowCol(row, col), coarse_and_fine.second));
+        }
+        total += closest;
+      }
+    }
+    sink += total;
+    result.add("get_dist_karbonite", elapsed_ms(start));
+  }
+
+  const GameMap &m_map;
+  const uint8_t m_planet;
+  int m_rows = 0;
+  int m_cols = 0;
+};
+
+// p50 of each stage, in ms
+void print_case(const Case &result) {
+  fprintf(stderr, "%-16s %-5s %2ux%-2u %6.2fMB", result.map.c_str(), planet_names[result.planet], result.width,
+          result.height, result.memory_mb);
+  for (const auto &stage : result.stages) {
+    fprintf(stderr, "  %s %.3f", stage.first.c_str(), percentile(stage.second, 0.5));
+  }
+  fprintf(stderr, "\n");
+}
+
+/*
+ * Per stage, over all the maps and planets it ran on: the spread of the p50s, their total, and where it was slowest.
+ */
+void print_summary(const std::vector<Case> &results) {
+  std::vector<std::pair<std::string, std::vector<double>>> by_stage;
+  std::vector<std::string> slowest;
+  for (const Case &result : results) {
+    for (const auto &stage : result.stages) {
+      size_t i = 0;
+      while (i < by_stage.size() && by_stage[i].first != stage.first) {
+        ++i;
+      }
+      if (i == by_stage.size()) {
+        by_stage.emplace_back(stage.first, std::vector<double>());
+        slowest.emplace_back();
+      }
+      const double ms = percentile(stage.second, 0.5);
+      if (by_stage[i].second.empty() || ms > *std::max_element(by_stage[i].second.begin(), by_stage[i].second.end())) {
+        slowest[i] = result.map + " " + planet_names[result.planet];
+      }
+      by_stage[i].second.push_back(ms);
+    }
+  }
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  fprintf(stderr, "\n%zu maps and planets, peak rss %.1fMB. p50 of each, in ms:\n", results.size(),
+          usage.ru_maxrss / 1024.0);
+  for (size_t i = 0; i < by_stage.size(); ++i) {
+    const std::vector<double> &times = by_stage[i].second;
+    double total = 0;
+    for (const double ms : times) {
+      total += ms;
+    }
+    fprintf(stderr, "  %-20s p50 %9.3f  p99 %9.3f  total %10.3f  slowest on %s\n", by_stage[i].first.c_str(),
+            percentile(times, 0.5), percentile(times, 0.99), total, slowest[i].c_str());
+  }
+}
+
+/*
+ * One case per line, so a baseline can be read back a line at a time (see load_baseline()).
+ */
+void write_json(const std::vector<Case> &results, unsigned int runs) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  printf("{\"runs\": %u, \"peak_rss_mb\": %.2f, \"results\": [\n", runs, usage.ru_maxrss / 1024.0);
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Case &result = results[i];
+    printf("{\"map\": \"%s\", \"planet\": \"%s\", \"width\": %u, \"height\": %u, \"memory_mb\": %.3f, \"stages\": {",
+           result.map.c_str(), planet_names[result.planet], result.width, result.height, result.memory_mb);
+    for (size_t j = 0; j < result.stages.size(); ++j) {
+      const std::vector<double> &times = result.stages[j].second;
+      printf("%s\"%s\": {\"min_ms\": %.4f, \"p50_ms\": %.4f, \"p99_ms\": %.4f}", j == 0 ? "" : ", ",
+             result.stages[j].first.c_str(), percentile(times, 0), percentile(times, 0.5), percentile(times, 0.99));
+    }
+    printf("}}%s\n", i + 1 < results.size() ? "," : "");
+  }
+  printf("]}\n");
+}
+
+struct Baseline {
+  unsigned int runs = 0;
+  // by "map planet"
+  std::map<std::string, double> memory_mb;
+  // fastest run, by "map planet stage"
+  std::map<std::string, double> stage_min_ms;
+};
+
+// reads what write_json() wrote
+bool load_baseline(const char *path, Baseline &baseline) {
+  FILE *file = fopen(path, "r");
+  if (file == nullptr) {
+    perror(path);
+    return false;
+  }
+  char line[8192];
+  while (fgets(line, sizeof(line), file) != nullptr) {
+    char map[256];
+    char planet[16];
+    double memory_mb = 0;
+    int length = 0;
+    if (sscanf(line, "{\"runs\": %u", &baseline.runs) == 1) {
+      continue;
+    }
+    if (sscanf(line, "{\"map\": \"%255[^\"]\", \"planet\": \"%15[^\"]\", \"width\": %*u, \"height\": %*u, "
+               "\"memory_mb\": %lf, \"stages\": {%n", map, planet, &memory_mb, &length) < 3 || length == 0) {
+      continue;
+    }
+    const std::string key = std::string(map) + " " + planet;
+    baseline.memory_mb[key] = memory_mb;
+    const char *rest = line + length;
+    char stage[64];
+    double min_ms;
+    while (sscanf(rest, " \"%63[^\"]\": {\"min_ms\": %lf, \"p50_ms\": %*f, \"p99_ms\": %*f}%n", stage, &min_ms,
+                  &length) == 2) {
+      baseline.stage_min_ms[key + " " + stage] = min_ms;
+      rest += length;
+      if (*rest == ',') {
+        ++rest;
+      }
+    }
+  }
+  fclose(file);
+  if (baseline.memory_mb.empty()) {
+    fprintf(stderr, "%s has no results\n", path);
+    return false;
+  }
+  return true;
+}
+
+bool is_regression(double baseline, double now, double ratio, double floor) {
+  return now > baseline * ratio && now - baseline > floor;
+}
+
+/*
+ * Finds the maps and planets where a stage's fastest run got slower than the baseline's, or that take more memory, then
+ * compares the totals of the fastest runs per stage over all maps, and a total that got slower flags every case.
+ * Lists what regressed to out, unless it's null. Returns the indexes of the flagged cases.
+ */
+std::vector<size_t> compare(const std::vector<Case> &results, unsigned int runs, const Baseline &baseline,
+                            const char *baseline_path, FILE *out) {
+  std::vector<size_t> flagged;
+  unsigned int regressions = 0;
+  unsigned int missing = 0;
+  // stage -> totals over the cases in both, baseline then now
+  std::vector<std::pair<std::string, std::pair<double, double>>> totals;
+  if (out != nullptr) {
+    fprintf(out, "\ncompared to %s:\n", baseline_path);
+    if (baseline.runs != runs) {
+      // the fastest of more runs tends to be faster
+      fprintf(out, "  the baseline has %u runs per map, not %u, so it isn't a fair comparison\n", baseline.runs, runs);
+    }
+  }
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Case &result = results[i];
+    const std::string key = result.map + " " + planet_names[result.planet];
+    const auto memory = baseline.memory_mb.find(key);
+    if (memory == baseline.memory_mb.end()) {
+      ++missing;
+      continue;
+    }
+    const unsigned int case_regressions = regressions;
+    if (is_regression(memory->second, result.memory_mb, regression_ratio, regression_floor_mb)) {
+      if (out != nullptr) {
+        fprintf(out, "  %-40s %9.2fMB -> %9.2fMB  %+.0f%%\n", (key + " memory").c_str(), memory->second,
+                result.memory_mb, 100 * (result.memory_mb / memory->second - 1));
+      }
+      ++regressions;
+    }
+    for (const auto &stage : result.stages) {
+      const auto before = baseline.stage_min_ms.find(key + " " + stage.first);
+      if (before == baseline.stage_min_ms.end()) {
+        continue;
+      }
+      const double now = percentile(stage.second, 0);
+      if (is_regression(before->second, now, regression_ratio, regression_floor_ms)) {
+        if (out != nullptr) {
+          fprintf(out, "  %-40s %9.3fms -> %9.3fms  %+.0f%%\n", (key + " " + stage.first).c_str(),
+                  before->second, now, 100 * (now / before->second - 1));
+        }
+        ++regressions;
+      }
+      auto total = std::find_if(totals.begin(), totals.end(),
+                                [&stage](const std::pair<std::string, std::pair<double, double>> &entry) {
+                                  return entry.first == stage.first;
+                                });
+      if (total == totals.end()) {
+        totals.emplace_back(stage.first, std::make_pair(0.0, 0.0));
+        total = totals.end() - 1;
+      }
+      total->second.first += before->second;
+      total->second.second += now;
+    }
+    if (regressions > case_regressions) {
+      flagged.push_back(i);
+    }
+  }
+  if (out != nullptr) {
+    fprintf(out, "totals over all maps, fastest runs:\n");
+  }
+  bool total_regressed = false;
+  for (const auto &total : totals) {
+    const double before = total.second.first;
+    const double now = total.second.second;
+    const bool regressed = is_regression(before, now, total_regression_ratio, regression_floor_ms);
+    if (out != nullptr) {
+      fprintf(out, "  %-40s %9.3fms -> %9.3fms  %+.1f%%%s\n", total.first.c_str(), before, now,
+              before > 0 ? 100 * (now / before - 1) : 0.0, regressed ? "  regression" : "");
+    }
+    regressions += regressed;
+    total_regressed |= regressed;
+  }
+  if (total_regressed) {
+    flagged.clear();
+    for (size_t i = 0; i < results.size(); ++i) {
+      flagged.push_back(i);
+    }
+  }
+  if (out != nullptr) {
+    fprintf(out, "%u regressions", regressions);
+    if (missing > 0) {
+      fprintf(out, ", %u maps and planets aren't in the baseline", missing);
+    }
+    fprintf(out, "\n");
+  }
+  return flagged;
+}
+
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <map directory> [<runs> [<baseline>]]\n", argv[0]);
+    return 1;
+  }
+  const std::vector<std::string> paths = list_maps(argv[1]);
+  if (paths.empty()) {
+    fprintf(stderr, "no maps in %s\n", argv[1]);
+    return 1;
+  }
+  const unsigned int runs = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : default_runs;
+  Baseline baseline;
+  if (argc > 3 && !load_baseline(argv[3], baseline)) {
+    return 1;
+  }
+
+  std::vector<GameMap> maps;
+  std::vector<Case> results;
+  for (const std::string &path : paths) {
+    GameMap map;
+    if (!load_map(path.c_str(), map)) {
+      continue;
+    }
+    maps.push_back(map);
+    for (uint8_t planet = World::Earth; planet <= World::Mars; ++planet) {
+      Case result;
+      result.map = map_name(path);
+      result.planet = planet;
+      result.width = map.maps[planet].width;
+      result.height = map.maps[planet].height;
+      results.push_back(result);
+    }
+  }
+  // a pass over every map per run, rather than all the runs of a map in a row, so a few seconds of a busy machine
+  // slow down one run of many maps instead of every run of a few
+  for (unsigned int run = 0; run < std::max(runs, 1u); ++run) {
+    for (size_t i = 0; i < results.size(); ++i) {
+      // two cases per map, earth then mars
+      PreprocessingBenchmark benchmark(maps[i / 2], results[i].planet);
+      benchmark.run(results[i]);
+    }
+  }
+  for (const Case &result : results) {
+    print_case(result);
+  }
+  print_summary(results);
+  write_json(results, runs);
+  fflush(stdout);
+  if (argc > 3) {
+    // one slow pass is more often the machine than the code, so whatever looks slower runs again before it counts
+    for (unsigned int recheck = 0; recheck < max_rechecks; ++recheck) {
+      const std::vector<size_t> flagged = compare(results, runs, baseline, argv[3], nullptr);
+      if (flagged.empty()) {
+        break;
+      }
+      fprintf(stderr, "\n%zu maps and planets look slower, running them %u more times\n", flagged.size(), runs);
+      for (unsigned int run = 0; run < std::max(runs, 1u); ++run) {
+        for (const size_t i : flagged) {
+          PreprocessingBenchmark benchmark(maps[i / 2], results[i].planet);
+          benchmark.run(results[i]);
+        }
+      }
+    }
+    return compare(results, runs, baseline, argv[3], stderr).empty() ? 0 : 1;
+  }
+  return 0;
+}
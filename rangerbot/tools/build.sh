@@ -0,0 +1,39 @@
+#!/bin/sh
+# build one of the offline tools: sh tools/build.sh <sim|replay|bench>. the binary ends up in the tool's directory,
+# next to its source.
+set -e
+
+if [ $# -ne 1 ] || [ ! -f "$(dirname "$0")/$1/$1.cpp" ]; then
+  echo "usage: $0 <sim|replay|bench>" >&2
+  exit 1
+fi
+
+tools=$(cd "$(dirname "$0")" && pwd)
+tool="$1"
+here="$tools/$tool"
+bot="$tools/.."
+build="$here/build"
+
+# same flags as a release build in run.sh
+FLAGS="-std=c++14 -fno-rtti -fno-exceptions -march=native -O3 -DNDEBUG"
+
+# the bot includes "bcpp_api/bc.hpp" next to its own sources, so compile them from links next to the stand-in api
+rm -rf "$build"
+mkdir -p "$build/src"
+ln -s "$bot"/*.cpp "$bot"/*.h "$bot"/*.hpp "$build/src/"
+ln -s "$tools/offline/bcpp_api" "$build/src/bcpp_api"
+
+cd "$build"
+for source in src/*.cpp; do
+  name=$(basename "$source" .cpp)
+  if [ "$name" = "main" ]; then
+    g++ $FLAGS -Isrc -Dmain=bot_main -c "$source" -o "$name.o"
+  else
+    g++ $FLAGS -Isrc -c "$source" -o "$name.o"
+  fi
+done
+for source in "$tools"/offline/*.cpp; do
+  g++ $FLAGS -c "$source" -o "$(basename "$source" .cpp).o"
+done
+g++ $FLAGS -Isrc -c "$here/$tool.cpp" -o "$tool.o"
+g++ $FLAGS *.o -o "$here/$tool" -pthread
@@ -0,0 +1,807 @@
+
+#include "MapLoader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <dirent.h>
+#include <strings.h>
+
+#include "World.h"
+
+namespace {
+
+const double pi = 3.14159265358979323846;
+
+const char *const team_names[] = {"Red", "Blue"};
+const char *const planet_names[] = {"Earth", "Mars"};
+const char *const unit_type_names[] = {"Worker", "Knight", "Ranger", "Mage", "Healer", "Factory", "Rocket"};
+
+bool read_file(const char *path, std::string &contents) {
+  FILE *file = fopen(path, "rb");
+  if (file == nullptr) {
+    return false;
+  }
+  char buffer[1 << 16];
+  size_t read;
+  while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    contents.append(buffer, read);
+  }
+  const bool ok = ferror(file) == 0;
+  fclose(file);
+  return ok;
+}
+
+/*
+ * Pulls json values out of a buffer as the caller asks for them. Objects and arrays hand their members to a callback
+ * as they go, anything the caller doesn't want is skipped over. The first error sticks, and everything after it fails.
+ */
+class JsonScanner {
+ public:
+  JsonScanner(const char *begin, const char *end) : m_begin(begin), m_next(begin), m_end(end) {}
+
+  const char *error() const { return m_error; }
+
+  size_t offset() const { return static_cast<size_t>(m_next - m_begin); }
+
+  bool fail(const char *error) {
+    if (m_error == nullptr) {
+      m_error = error;
+    }
+    return false;
+  }
+
+  void skipWhitespace() {
+    while (m_next < m_end && (*m_next == ' ' || *m_next == '\n' || *m_next == '\r' || *m_next == '\t')) {
+      ++m_next;
+    }
+  }
+
+  // skips whitespace, then takes c if it's next
+  bool consume(char c) {
+    skipWhitespace();
+    if (m_next < m_end && *m_next == c) {
+      ++m_next;
+      return true;
+    }
+    return false;
+  }
+
+  bool expect(char c, const char *error) { return consume(c) || fail(error); }
+
+  bool atEnd() {
+    skipWhitespace();
+    return m_next == m_end;
+  }
+
+  // escapes are kept as they are, nothing in a map needs them
+  bool readString(std::string &value) {
+    if (!expect('"', "expected a string")) {
+      return false;
+    }
+    const char *start = m_next;
+    while (m_next < m_end && *m_next != '"') {
+      m_next += *m_next == '\\' ? 2 : 1;
+    }
+    if (m_next >= m_end) {
+      return fail("unterminated string");
+    }
+    value.assign(start, m_next);
+    ++m_next;
+    return true;
+  }
+
+  bool readNumber(double &value) {
+    skipWhitespace();
+    bool negative = false;
+    if (m_next < m_end && *m_next == '-') {
+      negative = true;
+      ++m_next;
+    }
+    const char *start = m_next;
+    uint64_t integer = 0;
+    while (m_next < m_end && *m_next >= '0' && *m_next <= '9') {
+      integer = integer * 10 + static_cast<uint64_t>(*m_next++ - '0');
+    }
+    if (m_next == start) {
+      return fail("expected a number");
+    }
+    value = static_cast<double>(integer);
+    if (m_next < m_end && (*m_next == '.' || *m_next == 'e' || *m_next == 'E')) {
+      // rare enough to leave to strtod. load_map's buffer is null terminated, so it can't run off the end.
+      char *parsed_end = nullptr;
+      value = strtod(start, &parsed_end);
+      m_next = parsed_end;
+    }
+    if (negative) {
+      value = -value;
+    }
+    return true;
+  }
+
+  bool readUint(uint32_t &value) {
+    double number = 0;
+    if (!readNumber(number)) {
+      return false;
+    }
+    if (number < 0 || number > UINT32_MAX) {
+      return fail("number out of range");
+    }
+    value = static_cast<uint32_t>(number);
+    return true;
+  }
+
+  bool readBool(bool &value) {
+    if (consumeWord("true")) {
+      value = true;
+      return true;
+    }
+    if (consumeWord("false")) {
+      value = false;
+      return true;
+    }
+    return fail("expected true or false");
+  }
+
+  // index of the string in names, which has num_names entries
+  bool readName(const char *const *names, int num_names, uint8_t &value) {
+    if (!readString(m_name)) {
+      return false;
+    }
+    for (int i = 0; i < num_names; ++i) {
+      if (m_name == names[i]) {
+        value = static_cast<uint8_t>(i);
+        return true;
+      }
+    }
+    return fail("unknown name");
+  }
+
+  // calls member(key) with the scanner at each value, which it has to read or skip
+  template<typename Member>
+  bool readObject(Member &&member) {
+    if (!expect('{', "expected an object")) {
+      return false;
+    }
+    if (consume('}')) {
+      return true;
+    }
+    std::string key;
+    do {
+      if (!readString(key) || !expect(':', "expected a colon") || !member(key)) {
+        return fail("bad object member");
+      }
+    } while (consume(','));
+    return expect('}', "expected the end of an object");
+  }
+
+  // calls element() with the scanner at each element, which it has to read or skip
+  template<typename Element>
+  bool readArray(Element &&element) {
+    if (!expect('[', "expected an array")) {
+      return false;
+    }
+    if (consume(']')) {
+      return true;
+    }
+    do {
+      if (!element()) {
+        return fail("bad array element");
+      }
+    } while (consume(','));
+    return expect(']', "expected the end of an array");
+  }
+
+  bool skipValue() {
+    skipWhitespace();
+    if (m_next == m_end) {
+      return fail("expected a value");
+    }
+    switch (*m_next) {
+      case '{':
+        return readObject([this](const std::string &) { return skipValue(); });
+      case '[':
+        return readArray([this]() { return skipValue(); });
+      case '"':
+        return readString(m_name);
+      case 't':
+      case 'f': {
+        bool ignored;
+        return readBool(ignored);
+      }
+      case 'n':
+        return consumeWord("null") || fail("expected null");
+      default: {
+        double ignored;
+        return readNumber(ignored);
+      }
+    }
+  }
+
+ private:
+  bool consumeWord(const char *word) {
+    skipWhitespace();
+    const size_t length = strlen(word);
+    if (static_cast<size_t>(m_end - m_next) >= length && memcmp(m_next, word, length) == 0) {
+      m_next += length;
+      return true;
+    }
+    return false;
+  }
+
+  const char *m_begin;
+  const char *m_next;
+  const char *m_end;
+  const char *m_error = nullptr;
+  // scratch for strings that are only compared
+  std::string m_name;
+};
+
+/*
+ * A [y][x] array of arrays into a row major grid. Counts the rows, so it can be checked against the map's size, which
+ * may only come later.
+ */
+template<typename Cell, typename ReadCell>
+bool read_grid(JsonScanner &json, std::vector<Cell> &grid, uint32_t &rows, ReadCell &&read_cell) {
+  grid.clear();
+  rows = 0;
+  return json.readArray([&]() {
+    ++rows;
+    return json.readArray([&]() {
+      Cell cell;
+      if (!read_cell(cell)) {
+        return false;
+      }
+      grid.push_back(cell);
+      return true;
+    });
+  });
+}
+
+bool read_map_location(JsonScanner &json, uint8_t &planet, uint8_t &x, uint8_t &y) {
+  return json.readObject([&](const std::string &key) {
+    uint32_t value = 0;
+    if (key == "planet") {
+      return json.readName(planet_names, 2, planet);
+    } else if (key == "x") {
+      const bool ok = json.readUint(value);
+      x = static_cast<uint8_t>(value);
+      return ok;
+    } else if (key == "y") {
+      const bool ok = json.readUint(value);
+      y = static_cast<uint8_t>(value);
+      return ok;
+    }
+    return json.skipValue();
+  });
+}
+
+bool read_unit(JsonScanner &json, TraceUnit &unit) {
+  return json.readObject([&](const std::string &key) {
+    uint32_t value = 0;
+    if (key == "id") {
+      return json.readUint(unit.id);
+    } else if (key == "team") {
+      return json.readName(team_names, 2, unit.team);
+    } else if (key == "unit_type") {
+      return json.readName(unit_type_names, 7, unit.type);
+    } else if (key == "level") {
+      const bool ok = json.readUint(value);
+      unit.level = static_cast<uint8_t>(value);
+      return ok;
+    } else if (key == "health") {
+      return json.readUint(unit.health);
+    } else if (key == "is_built") {
+      return json.readBool(unit.structure_is_built);
+    } else if (key == "location") {
+      // starting units are always on the map
+      return json.readObject([&](const std::string &kind) {
+        if (kind != "OnMap") {
+          return json.fail("initial unit isn't on the map");
+        }
+        unit.location = TraceUnit::OnMap;
+        return read_map_location(json, unit.planet, unit.x, unit.y);
+      });
+    }
+    return json.skipValue();
+  });
+}
+
+bool read_planet_map(JsonScanner &json, TraceMap &map) {
+  uint32_t karbonite_rows = 0;
+  uint32_t passable_rows = 0;
+  const bool ok = json.readObject([&](const std::string &key) {
+    if (key == "planet") {
+      return json.readName(planet_names, 2, map.planet);
+    } else if (key == "width") {
+      return json.readUint(map.width);
+    } else if (key == "height") {
+      return json.readUint(map.height);
+    } else if (key == "initial_karbonite") {
+      return read_grid(json, map.karbonite, karbonite_rows, [&](uint32_t &cell) { return json.readUint(cell); });
+    } else if (key == "is_passable_terrain") {
+      return read_grid(json, map.passable, passable_rows, [&](uint8_t &cell) {
+        bool passable = false;
+        const bool ok = json.readBool(passable);
+        cell = passable;
+        return ok;
+      });
+    } else if (key == "initial_units") {
+      map.initial_units.clear();
+      return json.readArray([&]() {
+        map.initial_units.emplace_back();
+        return read_unit(json, map.initial_units.back());
+      });
+    }
+    return json.skipValue();
+  });
+  if (!ok) {
+    return false;
+  }
+  const size_t tiles = static_cast<size_t>(map.width) * map.height;
+  if (map.width == 0 || karbonite_rows != map.height || passable_rows != map.height || map.karbonite.size() != tiles ||
+      map.passable.size() != tiles) {
+    return json.fail("grids don't match the map's size");
+  }
+  return true;
+}
+
+bool read_asteroids(JsonScanner &json, std::vector<TraceAsteroid> &asteroids) {
+  return json.readObject([&](const std::string &key) {
+    if (key != "pattern") {
+      return json.skipValue();
+    }
+    // keyed by round
+    return json.readObject([&](const std::string &round) {
+      TraceAsteroid asteroid;
+      asteroid.round = static_cast<uint32_t>(strtoul(round.c_str(), nullptr, 10));
+      asteroids.push_back(asteroid);
+      return json.readObject([&](const std::string &field) {
+        TraceAsteroid &strike = asteroids.back();
+        if (field == "karbonite") {
+          return json.readUint(strike.karbonite);
+        } else if (field == "location") {
+          uint8_t planet = 0;
+          return read_map_location(json, planet, strike.x, strike.y);
+        }
+        return json.skipValue();
+      });
+    });
+  });
+}
+
+bool read_orbit(JsonScanner &json, GameMap &map) {
+  return json.readObject([&](const std::string &key) {
+    if (key == "amplitude") {
+      return json.readUint(map.orbit_amplitude);
+    } else if (key == "period") {
+      return json.readUint(map.orbit_period);
+    } else if (key == "center") {
+      return json.readUint(map.orbit_center);
+    }
+    return json.skipValue();
+  });
+}
+
+bool read_game_map(JsonScanner &json, GameMap &map) {
+  const bool ok = json.readObject([&](const std::string &key) {
+    if (key == "seed") {
+      return json.readUint(map.seed);
+    } else if (key == "earth_map" || key == "mars_map") {
+      TraceMap planet_map;
+      if (!read_planet_map(json, planet_map)) {
+        return false;
+      }
+      map.maps[planet_map.planet] = std::move(planet_map);
+      return true;
+    } else if (key == "asteroids") {
+      return read_asteroids(json, map.asteroids);
+    } else if (key == "orbit") {
+      return read_orbit(json, map);
+    }
+    return json.skipValue();
+  });
+  return ok && (json.atEnd() || json.fail("trailing data"));
+}
+
+/*
+ * A line of a .bc18t map, split into words as they're needed.
+ */
+class TextLine {
+ public:
+  TextLine(const char *begin, const char *end) : m_next(begin), m_end(end) {}
+
+  bool atEnd() {
+    skipSpaces();
+    return m_next == m_end;
+  }
+
+  // the next character that isn't a space, or 0 at the end of the line
+  char peek() {
+    skipSpaces();
+    return m_next == m_end ? '\0' : *m_next;
+  }
+
+  char take() {
+    const char c = peek();
+    if (m_next != m_end) {
+      ++m_next;
+    }
+    return c;
+  }
+
+  // up to the next space, or the given delimiter
+  bool word(const char *&begin, const char *&end, char delimiter = ' ') {
+    skipSpaces();
+    begin = m_next;
+    while (m_next != m_end && *m_next != delimiter && *m_next != ' ' && *m_next != '\t') {
+      ++m_next;
+    }
+    end = m_next;
+    return begin != end;
+  }
+
+  bool number(uint32_t &value) {
+    const char *begin;
+    const char *end;
+    if (!word(begin, end)) {
+      return false;
+    }
+    value = 0;
+    for (const char *c = begin; c != end; ++c) {
+      if (*c < '0' || *c > '9') {
+        return false;
+      }
+      value = value * 10 + static_cast<uint32_t>(*c - '0');
+    }
+    return true;
+  }
+
+ private:
+  void skipSpaces() {
+    while (m_next != m_end && (*m_next == ' ' || *m_next == '\t' || *m_next == '\r')) {
+      ++m_next;
+    }
+  }
+
+  const char *m_next;
+  const char *m_end;
+};
+
+bool equals(const char *begin, const char *end, const char *word) {
+  const size_t length = strlen(word);
+  return static_cast<size_t>(end - begin) == length && memcmp(begin, word, length) == 0;
+}
+
+// index of the word in names, or -1. case doesn't matter.
+int find_name(const char *begin, const char *end, const char *const *names, int num_names) {
+  for (int i = 0; i < num_names; ++i) {
+    const size_t length = strlen(names[i]);
+    if (static_cast<size_t>(end - begin) == length && strncasecmp(begin, names[i], length) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*
+ * Reads the commented text format. Symbols are defined as they go (x = impassable, Q = 50k, r = red_worker) and carry
+ * over from earth to mars. Map rows start with >, from the top of the map down, with optional spaces between tiles.
+ * Under a symmetry only part of the map has to be drawn: tiles that aren't take the symbol of their mirror image, with
+ * teams swapped, and anything else is empty.
+ */
+class TextMapReader {
+ public:
+  explicit TextMapReader(GameMap &map) : m_map(map) {}
+
+  bool read(const char *begin, const char *end) {
+    while (begin < end && m_error == nullptr) {
+      const char *line_end = static_cast<const char *>(memchr(begin, '\n', static_cast<size_t>(end - begin)));
+      if (line_end == nullptr) {
+        line_end = end;
+      }
+      ++m_line_number;
+      readLine(TextLine(begin, line_end));
+      begin = line_end + 1;
+    }
+    for (uint8_t planet = 0; planet < 2 && m_error == nullptr; ++planet) {
+      fillIn(planet);
+    }
+    return m_error == nullptr;
+  }
+
+  const char *error() const { return m_error; }
+
+  size_t lineNumber() const { return m_line_number; }
+
+ private:
+  enum Symmetry {None, Vertical, Horizontal, Spiral};
+
+  struct Symbol {
+    bool defined = false;
+    bool passable = true;
+    uint32_t karbonite = 0;
+    bool has_unit = false;
+    uint8_t team = 0;
+    uint8_t unit_type = 0;
+  };
+
+  struct Planet {
+    bool seen = false;
+    Symmetry symmetry = None;
+    // symbols as drawn, row by row from the top, 0 where nothing was
+    std::vector<unsigned char> drawn;
+    uint32_t rows = 0;
+  };
+
+  bool fail(const char *error) {
+    if (m_error == nullptr) {
+      m_error = error;
+    }
+    return false;
+  }
+
+  void readLine(TextLine line) {
+    const char first = line.peek();
+    if (first == '\0' || first == '#') {
+      return;
+    }
+    if (first == '>') {
+      line.take();
+      readRow(line);
+    } else if (first == '*') {
+      line.take();
+      readAsteroid(line);
+    } else {
+      TextLine definition = line;
+      const char name = definition.take();
+      if (definition.take() == '=') {
+        readSymbol(name, definition);
+        return;
+      }
+      const char *begin;
+      const char *end;
+      line.word(begin, end, ':');
+      if (line.take() == ':') {
+        readSetting(begin, end, line);
+      } else {
+        fail("expected a setting, a symbol, a map row or an asteroid");
+      }
+    }
+  }
+
+  void readSetting(const char *key, const char *key_end, TextLine &line) {
+    if (equals(key, key_end, "EARTH") || equals(key, key_end, "MARS")) {
+      m_planet = equals(key, key_end, "EARTH") ? 0 : 1;
+      m_planets[m_planet].seen = true;
+      m_map.maps[m_planet].planet = static_cast<uint8_t>(m_planet);
+      return;
+    }
+    if (equals(key, key_end, "symmetry")) {
+      const char *begin;
+      const char *end;
+      line.word(begin, end);
+      static const char *const symmetries[] = {"none", "vertical", "horizontal", "spiral"};
+      const int symmetry = find_name(begin, end, symmetries, 4);
+      if (m_planet < 0 || symmetry < 0) {
+        fail("bad symmetry");
+        return;
+      }
+      m_planets[m_planet].symmetry = static_cast<Symmetry>(symmetry);
+      return;
+    }
+    uint32_t value = 0;
+    if (!line.number(value)) {
+      fail("expected a number");
+    } else if (equals(key, key_end, "seed")) {
+      m_map.seed = value;
+    } else if (equals(key, key_end, "orbit_amplitude")) {
+      m_map.orbit_amplitude = value;
+    } else if (equals(key, key_end, "orbit_period")) {
+      m_map.orbit_period = value;
+    } else if (equals(key, key_end, "orbit_center")) {
+      m_map.orbit_center = value;
+    } else if (m_planet >= 0 && equals(key, key_end, "width")) {
+      m_map.maps[m_planet].width = value;
+    } else if (m_planet >= 0 && equals(key, key_end, "height")) {
+      m_map.maps[m_planet].height = value;
+    } else {
+      fail("unknown setting");
+    }
+  }
+
+  // an empty definition is an empty tile
+  void readSymbol(char name, TextLine &line) {
+    Symbol symbol;
+    symbol.defined = true;
+    const char *begin;
+    const char *end;
+    while (line.word(begin, end) && *begin != '#') {
+      const char *underscore = static_cast<const char *>(memchr(begin, '_', static_cast<size_t>(end - begin)));
+      if (equals(begin, end, "impassable")) {
+        symbol.passable = false;
+      } else if (end[-1] == 'k' && TextLine(begin, end - 1).number(symbol.karbonite)) {
+        continue;
+      } else if (underscore != nullptr && find_name(begin, underscore, team_names, 2) >= 0 &&
+                 find_name(underscore + 1, end, unit_type_names, 7) >= 0) {
+        symbol.has_unit = true;
+        symbol.team = static_cast<uint8_t>(find_name(begin, underscore, team_names, 2));
+        symbol.unit_type = static_cast<uint8_t>(find_name(underscore + 1, end, unit_type_names, 7));
+      } else {
+        fail("unknown tile attribute");
+        return;
+      }
+    }
+    m_symbols[static_cast<unsigned char>(name)] = symbol;
+  }
+
+  void readRow(TextLine &line) {
+    if (m_planet < 0) {
+      fail("map row before EARTH: or MARS:");
+      return;
+    }
+    const TraceMap &map = m_map.maps[m_planet];
+    Planet &planet = m_planets[m_planet];
+    if (map.width == 0 || map.height == 0) {
+      fail("map row before the width and height");
+      return;
+    }
+    if (planet.rows >= map.height) {
+      fail("more rows than the height");
+      return;
+    }
+    planet.drawn.resize(static_cast<size_t>(map.width) * map.height);
+    unsigned char *row = &planet.drawn[planet.rows * map.width];
+    uint32_t column = 0;
+    for (char c = line.take(); c != '\0'; c = line.take()) {
+      if (column >= map.width) {
+        fail("row is wider than the width");
+        return;
+      }
+      if (!m_symbols[static_cast<unsigned char>(c)].defined) {
+        fail("undefined symbol");
+        return;
+      }
+      row[column++] = static_cast<unsigned char>(c);
+    }
+    ++planet.rows;
+  }
+
+  // y is from the bottom, like the map
+  void readAsteroid(TextLine &line) {
+    TraceAsteroid asteroid;
+    uint32_t x = 0;
+    uint32_t y = 0;
+    if (!line.number(asteroid.round) || !line.number(x) || !line.number(y) || !line.number(asteroid.karbonite)) {
+      fail("expected round, x, y and karbonite");
+      return;
+    }
+    asteroid.x = static_cast<uint8_t>(x);
+    asteroid.y = static_cast<uint8_t>(y);
+    m_map.asteroids.push_back(asteroid);
+  }
+
+  void fillIn(uint8_t planet_index) {
+    const Planet &planet = m_planets[planet_index];
+    TraceMap &map = m_map.maps[planet_index];
+    if (!planet.seen || map.width == 0 || map.height == 0) {
+      fail(planet_index == 0 ? "no earth map" : "no mars map");
+      return;
+    }
+    const uint32_t width = map.width;
+    const uint32_t height = map.height;
+    const size_t tiles = static_cast<size_t>(width) * height;
+    map.passable.assign(tiles, 1);
+    map.karbonite.assign(tiles, 0);
+    std::vector<unsigned char> drawn = planet.drawn;
+    drawn.resize(tiles);
+
+    for (uint32_t y = 0; y < height; ++y) {
+      for (uint32_t x = 0; x < width; ++x) {
+        const uint32_t row = height - 1 - y;
+        unsigned char name = drawn[row * width + x];
+        bool mirrored = false;
+        if (name == 0 && planet.symmetry != None) {
+          const uint32_t mirror_row = planet.symmetry == Horizontal ? row : height - 1 - row;
+          const uint32_t mirror_x = planet.symmetry == Vertical ? x : width - 1 - x;
+          name = drawn[mirror_row * width + mirror_x];
+          mirrored = true;
+        }
+        if (name == 0) {
+          continue;
+        }
+        const Symbol &symbol = m_symbols[name];
+        const size_t tile = y * width + x;
+        map.passable[tile] = symbol.passable;
+        map.karbonite[tile] = symbol.karbonite;
+        if (symbol.has_unit) {
+          TraceUnit unit;
+          unit.id = m_next_id++;
+          unit.team = static_cast<uint8_t>(mirrored ? 1 - symbol.team : symbol.team);
+          unit.type = symbol.unit_type;
+          unit.planet = planet_index;
+          unit.x = static_cast<uint8_t>(x);
+          unit.y = static_cast<uint8_t>(y);
+          unit.health = World::defaultStats(unit.type, 0).max_health;
+          map.initial_units.push_back(unit);
+        }
+      }
+    }
+  }
+
+  GameMap &m_map;
+  Symbol m_symbols[256];
+  Planet m_planets[2];
+  int m_planet = -1;
+  uint32_t m_next_id = 0;
+  const char *m_error = nullptr;
+  size_t m_line_number = 0;
+};
+
+bool ends_with(const char *path, const char *suffix) {
+  const size_t length = strlen(path);
+  const size_t suffix_length = strlen(suffix);
+  return length >= suffix_length && strcmp(path + length - suffix_length, suffix) == 0;
+}
+
+}
+
+uint32_t GameMap::flightRounds(uint32_t round) const {
+  const double offset = orbit_amplitude * sin(2 * pi * round / std::max<uint32_t>(orbit_period, 1));
+  return static_cast<uint32_t>(static_cast<int64_t>(orbit_center) + static_cast<int64_t>(offset));
+}
+
+bool load_map(const char *path, GameMap &map) {
+  std::string contents;
+  if (!read_file(path, contents)) {
+    fprintf(stderr, "can't read %s\n", path);
+    return false;
+  }
+  map = GameMap();
+  const char *begin = contents.data();
+  const char *end = begin + contents.size();
+  if (ends_with(path, ".bc18t")) {
+    TextMapReader reader(map);
+    if (!reader.read(begin, end)) {
+      fprintf(stderr, "%s:%zu: %s\n", path, reader.lineNumber(), reader.error());
+      return false;
+    }
+  } else {
+    JsonScanner json(begin, end);
+    if (!read_game_map(json, map)) {
+      fprintf(stderr, "%s: %s at byte %zu\n", path, json.error(), json.offset());
+      return false;
+    }
+  }
+  std::stable_sort(map.asteroids.begin(), map.asteroids.end(),
+                   [](const TraceAsteroid &a, const TraceAsteroid &b) { return a.round < b.round; });
+  return true;
+}
+
+std::vector<std::string> list_maps(const char *directory) {
+  std::vector<std::string> paths;
+  DIR *dir = opendir(directory);
+  if (dir == nullptr) {
+    return paths;
+  }
+  while (const dirent *entry = readdir(dir)) {
+    if (ends_with(entry->d_name, ".bc18map") || ends_with(entry->d_name, ".bc18t")) {
+      paths.push_back(std::string(directory) + "/" + entry->d_name);
+    }
+  }
+  closedir(dir);
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+std::vector<bool> passable_grid(const TraceMap &map) {
+  return std::vector<bool>(map.passable.begin(), map.passable.end());
+}
+
+std::vector<unsigned int> karbonite_grid(const TraceMap &map) {
+  return std::vector<unsigned int>(map.karbonite.begin(), map.karbonite.end());
+}
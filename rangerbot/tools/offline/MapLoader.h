@@ -0,0 +1,43 @@
+#ifndef RANGERBOT_TOOLS_MAPLOADER_H
+#define RANGERBOT_TOOLS_MAPLOADER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../../TurnTrace.h"
+
+/*
+ * The maps in battlecode-maps/, read without the engine, into the same structures a trace starts with, so they can go
+ * straight into a World. Grids are indexed like PathFinder::index(), so they line up with MapPreprocessor's.
+ *
+ * Reads both formats: the .bc18map json the engine writes, and the commented .bc18t text that's drawn by hand. Both
+ * parsers make one pass over the file and only keep what ends up in the map, there's no document tree.
+ */
+
+struct GameMap {
+  // indexed by planet
+  TraceMap maps[2];
+  // sorted by round
+  std::vector<TraceAsteroid> asteroids;
+  uint32_t seed = 0;
+  uint32_t orbit_amplitude = 0;
+  uint32_t orbit_period = 1;
+  uint32_t orbit_center = 0;
+
+  // how long a rocket launched in the given round is in space
+  uint32_t flightRounds(uint32_t round) const;
+};
+
+// picks the format by extension. false, with the reason on stderr, if it can't be read or isn't a map.
+bool load_map(const char *path, GameMap &map);
+
+// paths of the .bc18map and .bc18t files in a directory, sorted
+std::vector<std::string> list_maps(const char *directory);
+
+// the grids the way MapPreprocessor keeps them
+std::vector<bool> passable_grid(const TraceMap &map);
+
+std::vector<unsigned int> karbonite_grid(const TraceMap &map);
+
+#endif //RANGERBOT_TOOLS_MAPLOADER_H
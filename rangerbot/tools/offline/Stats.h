@@ -0,0 +1,12 @@
+#ifndef RANGERBOT_TOOLS_STATS_H
+#define RANGERBOT_TOOLS_STATS_H
+
+#include <vector>
+
+/*
+ * The value below which the given fraction of the values fall, by nearest rank: 0 is the smallest, 0.5 the median
+ * and 1 the largest. 0 if there are no values.
+ */
+double percentile(std::vector<double> values, double fraction);
+
+#endif //RANGERBOT_TOOLS_STATS_H
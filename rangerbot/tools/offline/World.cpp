@@ -0,0 +1,1038 @@
+
+#include "World.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+const int World::num_directions;
+const int World::direction_dx[World::num_directions] = {0, 1, 1, 1, 0, -1, -1, -1, 0};
+const int World::direction_dy[World::num_directions] = {1, 1, 0, -1, -1, -1, 0, 1, 0};
+const uint32_t World::max_ready_heat;
+const uint32_t World::team_array_length;
+const uint32_t World::no_unit;
+const uint32_t World::flood_round;
+const uint32_t World::last_round;
+
+World *World::s_current = nullptr;
+
+namespace {
+
+const uint8_t max_levels[TraceTurn::num_branches] = {4, 3, 3, 4, 3, 3};
+// rounds to research each level, indexed by level - 1
+const uint32_t research_rounds[TraceTurn::num_branches][4] = {
+    {25, 75, 75, 75}, {25, 75, 100}, {25, 100, 200}, {25, 75, 100, 75}, {25, 100, 100}, {50, 100, 100}};
+
+const uint32_t heat_loss_per_round = 10;
+const uint32_t rocket_blast_damage = 50;
+const uint32_t karbonite_per_round = 10;
+// income goes down by one for every this much karbonite in the bank
+const uint32_t karbonite_decrease_ratio = 40;
+
+uint32_t distanceSquared(int x0, int y0, int x1, int y1) {
+  return static_cast<uint32_t>((x0 - x1) * (x0 - x1) + (y0 - y1) * (y0 - y1));
+}
+
+uint32_t distanceSquared(const TraceUnit &a, const TraceUnit &b) {
+  return distanceSquared(a.x, a.y, b.x, b.y);
+}
+
+bool onSamePlanet(const TraceUnit &a, const TraceUnit &b) {
+  return a.location == TraceUnit::OnMap && b.location == TraceUnit::OnMap && a.planet == b.planet;
+}
+
+}
+
+uint32_t World::blueprintCost(uint8_t type) {
+  return type == Factory ? 200 : 150;
+}
+
+uint32_t World::factoryCost(uint8_t type) {
+  return type == Worker ? 50 : 40;
+}
+
+uint32_t World::replicateCost() {
+  return 60;
+}
+
+int World::researchBranch(uint8_t type) {
+  if (type == Rocket) {
+    return TraceTurn::num_branches - 1;
+  }
+  return type < Factory ? type : -1;
+}
+
+uint8_t World::maxResearchLevel(int branch) {
+  return branch >= 0 && branch < TraceTurn::num_branches ? max_levels[branch] : 0;
+}
+
+uint32_t World::researchRounds(int branch, uint8_t level) {
+  if (level == 0 || level > maxResearchLevel(branch)) {
+    return 0;
+  }
+  return research_rounds[branch][level - 1];
+}
+
+TraceUnitStats World::defaultStats(uint8_t type, uint8_t level) {
+  TraceUnitStats stats;
+  stats.type = type;
+  stats.level = level;
+  switch (type) {
+    case Worker:
+      stats.max_health = 100;
+      stats.vision_range = 50;
+      stats.movement_cooldown = 20;
+      stats.is_ability_unlocked = true;
+      stats.ability_cooldown = 500;
+      stats.ability_range = 2;
+      stats.worker_build_health = 5 + (level >= 2) + (level >= 3) + (level >= 4);
+      stats.worker_repair_health = 10 + (level >= 2) + (level >= 3) + (level >= 4);
+      stats.worker_harvest_amount = 3 + (level >= 1);
+      break;
+    case Knight:
+      stats.max_health = 250;
+      stats.vision_range = 50;
+      stats.damage = 80;
+      stats.attack_range = 2;
+      stats.movement_cooldown = 15;
+      stats.attack_cooldown = 20;
+      stats.is_ability_unlocked = level >= 3;
+      stats.ability_cooldown = 50;
+      stats.ability_range = 10;
+      stats.knight_defense = 5 + 5 * std::min<uint8_t>(level, 2);
+      break;
+    case Ranger:
+      stats.max_health = 200;
+      stats.vision_range = level >= 2 ? 100 : 70;
+      stats.damage = 40;
+      stats.attack_range = 50;
+      stats.movement_cooldown = level >= 1 ? 15 : 20;
+      stats.attack_cooldown = 20;
+      stats.is_ability_unlocked = level >= 3;
+      stats.ability_cooldown = 200;
+      stats.ranger_cannot_attack_range = 10;
+      stats.ranger_max_countdown = 50;
+      break;
+    case Mage:
+      stats.max_health = 80;
+      stats.vision_range = 30;
+      stats.damage = 60 + 15 * std::min<uint8_t>(level, 3);
+      stats.attack_range = 30;
+      stats.movement_cooldown = 20;
+      stats.attack_cooldown = 20;
+      stats.is_ability_unlocked = level >= 4;
+      stats.ability_cooldown = 250;
+      stats.ability_range = 8;
+      break;
+    case Healer:
+      stats.max_health = 100;
+      stats.vision_range = 50;
+      stats.damage = -10 - (level >= 1 ? 2 : 0) - (level >= 2 ? 5 : 0);
+      stats.attack_range = 30;
+      stats.movement_cooldown = 25;
+      stats.attack_cooldown = 10;
+      stats.is_ability_unlocked = level >= 3;
+      stats.ability_cooldown = 100;
+      stats.ability_range = 30;
+      break;
+    case Factory:
+      stats.max_health = 300;
+      stats.vision_range = 2;
+      stats.structure_max_capacity = 8;
+      break;
+    case Rocket:
+      stats.max_health = 200;
+      stats.vision_range = 2;
+      stats.structure_max_capacity = level >= 3 ? 12 : 8;
+      break;
+    default:
+      break;
+  }
+  return stats;
+}
+
+void World::nextTurn() {
+  if (m_driver == nullptr) {
+    // nothing comes after this turn
+    exit(0);
+  }
+  m_driver->nextTurn(*this);
+}
+
+void World::setMap(const TraceMap &map) {
+  m_maps[map.planet] = map;
+  m_karbonite[map.planet] = map.karbonite;
+  m_occupants[map.planet].assign(map.width * map.height, no_unit);
+  m_vision_dirty = true;
+}
+
+void World::setPerspective(uint8_t team, uint8_t planet) {
+  m_team = team;
+  m_planet = planet;
+  m_vision_dirty = true;
+}
+
+void World::addStats(const TraceUnitStats &stats) {
+  m_stats[stats.type * 16u + stats.level] = stats;
+}
+
+const TraceUnitStats *World::stats(uint8_t type, uint8_t level) {
+  auto found = m_stats.find(type * 16u + level);
+  if (found == m_stats.end()) {
+    found = m_stats.emplace(type * 16u + level, defaultStats(type, level)).first;
+  }
+  return &found->second;
+}
+
+void World::addUnit(const TraceUnit &unit) {
+  WorldUnit &added = m_units[unit.id];
+  added = WorldUnit();
+  added.state = unit;
+  added.stats = stats(unit.type, unit.level);
+  if (unit.location == TraceUnit::OnMap && isOnMap(unit.planet, unit.x, unit.y)) {
+    m_occupants[unit.planet][tile(unit.planet, unit.x, unit.y)] = unit.id;
+  }
+  m_next_id = std::max(m_next_id, unit.id + 1);
+  m_vision_dirty = true;
+}
+
+void World::removeUnit(uint32_t id) {
+  auto found = m_units.find(id);
+  if (found == m_units.end()) {
+    return;
+  }
+  TraceUnit &state = found->second.state;
+  if (state.location == TraceUnit::OnMap) {
+    m_occupants[state.planet][tile(state.planet, state.x, state.y)] = no_unit;
+  } else if (state.location == TraceUnit::InGarrison) {
+    WorldUnit *structure = findUnit(state.structure_id);
+    if (structure != nullptr) {
+      std::vector<uint32_t> &garrison = structure->state.garrison;
+      garrison.erase(std::remove(garrison.begin(), garrison.end(), id), garrison.end());
+    }
+  }
+  const std::vector<uint32_t> garrison = state.garrison;
+  m_units.erase(found);
+  for (uint32_t garrisoned : garrison) {
+    removeUnit(garrisoned);
+  }
+  m_vision_dirty = true;
+}
+
+void World::clearUnits() {
+  m_units.clear();
+  for (std::vector<uint32_t> &occupants : m_occupants) {
+    std::fill(occupants.begin(), occupants.end(), no_unit);
+  }
+  m_vision_dirty = true;
+}
+
+bool World::isOnMap(uint8_t planet, int x, int y) const {
+  return planet < 2 && x >= 0 && y >= 0 && x < static_cast<int>(m_maps[planet].width) &&
+         y < static_cast<int>(m_maps[planet].height);
+}
+
+void World::updateVision() const {
+  const TraceMap &map = m_maps[m_planet];
+  m_vision.assign(map.width * map.height, 0);
+  for (const auto &entry : m_units) {
+    const TraceUnit &state = entry.second.state;
+    if (state.team != m_team || state.location != TraceUnit::OnMap || state.planet != m_planet) {
+      continue;
+    }
+    const uint32_t range = entry.second.stats->vision_range;
+    int radius = 0;
+    while (static_cast<uint32_t>((radius + 1) * (radius + 1)) <= range) {
+      ++radius;
+    }
+    for (int y = std::max(0, state.y - radius); y <= std::min<int>(map.height - 1, state.y + radius); ++y) {
+      for (int x = std::max(0, state.x - radius); x <= std::min<int>(map.width - 1, state.x + radius); ++x) {
+        if (distanceSquared(x, y, state.x, state.y) <= range) {
+          m_vision[y * map.width + x] = 1;
+        }
+      }
+    }
+  }
+  m_vision_dirty = false;
+}
+
+bool World::canSense(uint8_t planet, int x, int y) const {
+  if (planet != m_planet || !isOnMap(planet, x, y)) {
+    return false;
+  }
+  if (m_vision_dirty) {
+    updateVision();
+  }
+  return m_vision[tile(planet, x, y)] != 0;
+}
+
+uint32_t World::karboniteAt(uint8_t planet, int x, int y) const {
+  if (!canSense(planet, x, y)) {
+    fail("InvalidLocation: can't sense the karbonite there");
+    return 0;
+  }
+  return m_karbonite[planet][tile(planet, x, y)];
+}
+
+void World::setKarboniteAt(uint8_t planet, int x, int y, uint32_t karbonite) {
+  if (isOnMap(planet, x, y)) {
+    m_karbonite[planet][tile(planet, x, y)] = karbonite;
+  }
+}
+
+WorldUnit *World::findUnit(uint32_t id) {
+  auto found = m_units.find(id);
+  return found == m_units.end() ? nullptr : &found->second;
+}
+
+bool World::canSenseUnit(uint32_t id) const {
+  auto found = m_units.find(id);
+  if (found == m_units.end()) {
+    return false;
+  }
+  const TraceUnit &state = found->second.state;
+  if (state.team == m_team) {
+    return state.location == TraceUnit::InSpace || state.planet == m_planet;
+  }
+  return state.location == TraceUnit::OnMap && canSense(state.planet, state.x, state.y);
+}
+
+const WorldUnit *World::unit(uint32_t id) const {
+  if (!canSenseUnit(id)) {
+    fail("NoSuchUnit: " + std::to_string(id));
+    return nullptr;
+  }
+  return &m_units.find(id)->second;
+}
+
+uint32_t World::unitAt(uint8_t planet, int x, int y) const {
+  return isOnMap(planet, x, y) ? m_occupants[planet][tile(planet, x, y)] : no_unit;
+}
+
+std::vector<const WorldUnit *> World::visibleUnits() const {
+  std::vector<const WorldUnit *> units;
+  for (const auto &entry : m_units) {
+    const TraceUnit &state = entry.second.state;
+    if (state.location == TraceUnit::InSpace || state.planet != m_planet) {
+      continue;
+    }
+    if (state.team == m_team || (state.location == TraceUnit::OnMap && canSense(state.planet, state.x, state.y))) {
+      units.push_back(&entry.second);
+    }
+  }
+  return units;
+}
+
+std::vector<const WorldUnit *> World::myUnits() const {
+  std::vector<const WorldUnit *> units;
+  for (const auto &entry : m_units) {
+    const TraceUnit &state = entry.second.state;
+    if (state.team == m_team && state.location != TraceUnit::InSpace && state.planet == m_planet) {
+      units.push_back(&entry.second);
+    }
+  }
+  return units;
+}
+
+std::vector<const WorldUnit *> World::myUnitsInSpace() const {
+  std::vector<const WorldUnit *> units;
+  for (const auto &entry : m_units) {
+    if (entry.second.state.team == m_team && entry.second.state.location == TraceUnit::InSpace) {
+      units.push_back(&entry.second);
+    }
+  }
+  return units;
+}
+
+std::vector<const WorldUnit *> World::nearbyUnits(uint8_t planet, int x, int y, uint32_t radius_squared, int team,
+                                                  int type) const {
+  std::vector<const WorldUnit *> units;
+  for (const auto &entry : m_units) {
+    const TraceUnit &state = entry.second.state;
+    if (state.location != TraceUnit::OnMap || state.planet != planet ||
+        distanceSquared(state.x, state.y, x, y) > radius_squared) {
+      continue;
+    }
+    if ((team == 0 || team == 1) && state.team != team) {
+      continue;
+    }
+    if (type >= Worker && type <= Rocket && state.type != type) {
+      continue;
+    }
+    if (state.team == m_team || canSense(state.planet, state.x, state.y)) {
+      units.push_back(&entry.second);
+    }
+  }
+  return units;
+}
+
+bool World::isOccupiable(uint8_t planet, int x, int y) const {
+  return canSense(planet, x, y) && m_maps[planet].passable[tile(planet, x, y)] != 0 && unitAt(planet, x, y) == no_unit;
+}
+
+WorldUnit *World::myUnit(uint32_t id, const char *action) {
+  return const_cast<WorldUnit *>(static_cast<const World *>(this)->myUnit(id, action));
+}
+
+const WorldUnit *World::myUnit(uint32_t id, const char *action) const {
+  auto found = m_units.find(id);
+  if (found == m_units.end() || !canSenseUnit(id)) {
+    fail(std::string("NoSuchUnit: ") + action + " with " + std::to_string(id));
+    return nullptr;
+  }
+  if (found->second.state.team != m_team) {
+    fail(std::string("TeamNotAllowed: ") + action + " with " + std::to_string(id));
+    return nullptr;
+  }
+  return &found->second;
+}
+
+const WorldUnit *World::myRobotOnMap(uint32_t id, const char *action) const {
+  const WorldUnit *unit = myUnit(id, action);
+  if (unit == nullptr) {
+    return nullptr;
+  }
+  if (isStructure(unit->state.type) || unit->state.location != TraceUnit::OnMap) {
+    return nullptr;
+  }
+  return unit;
+}
+
+void World::place(WorldUnit &unit, uint8_t planet, int x, int y) {
+  unit.state.location = TraceUnit::OnMap;
+  unit.state.planet = planet;
+  unit.state.x = static_cast<uint8_t>(x);
+  unit.state.y = static_cast<uint8_t>(y);
+  m_occupants[planet][tile(planet, x, y)] = unit.state.id;
+  m_vision_dirty = true;
+}
+
+void World::lift(WorldUnit &unit) {
+  if (unit.state.location == TraceUnit::OnMap) {
+    m_occupants[unit.state.planet][tile(unit.state.planet, unit.state.x, unit.state.y)] = no_unit;
+  }
+  m_vision_dirty = true;
+}
+
+bool World::canMove(uint32_t id, int direction) const {
+  const WorldUnit *robot = myRobotOnMap(id, "move");
+  if (robot == nullptr || direction < 0 || direction >= num_directions - 1) {
+    return false;
+  }
+  const TraceUnit &state = robot->state;
+  return isOccupiable(state.planet, state.x + direction_dx[direction], state.y + direction_dy[direction]);
+}
+
+bool World::isMoveReady(uint32_t id) const {
+  const WorldUnit *unit = myUnit(id, "move");
+  return unit != nullptr && !isStructure(unit->state.type) && unit->state.movement_heat < max_ready_heat;
+}
+
+void World::moveRobot(uint32_t id, int direction) {
+  if (!isMoveReady(id) || !canMove(id, direction)) {
+    fail("InvalidAction: " + std::to_string(id) + " can't move");
+    return;
+  }
+  WorldUnit &robot = *findUnit(id);
+  lift(robot);
+  place(robot, robot.state.planet, robot.state.x + direction_dx[direction], robot.state.y + direction_dy[direction]);
+  robot.state.movement_heat += robot.stats->movement_cooldown;
+}
+
+bool World::canAttack(uint32_t id, uint32_t target_id) const {
+  const WorldUnit *robot = myRobotOnMap(id, "attack");
+  if (robot == nullptr || robot->state.type == Worker || robot->state.type == Healer || !canSenseUnit(target_id)) {
+    return false;
+  }
+  const TraceUnit &target = m_units.find(target_id)->second.state;
+  if (!onSamePlanet(robot->state, target)) {
+    return false;
+  }
+  const uint32_t distance = distanceSquared(robot->state, target);
+  return distance <= robot->stats->attack_range &&
+         (robot->state.type != Ranger || distance > robot->stats->ranger_cannot_attack_range);
+}
+
+bool World::isAttackReady(uint32_t id) const {
+  const WorldUnit *unit = myUnit(id, "attack");
+  return unit != nullptr && !isStructure(unit->state.type) && unit->state.attack_heat < max_ready_heat;
+}
+
+void World::attack(uint32_t id, uint32_t target_id) {
+  if (!isAttackReady(id) || !canAttack(id, target_id)) {
+    fail("InvalidAction: " + std::to_string(id) + " can't attack " + std::to_string(target_id));
+    return;
+  }
+  WorldUnit &robot = *findUnit(id);
+  robot.state.attack_heat += robot.stats->attack_cooldown;
+  const int32_t damage = robot.stats->damage;
+  if (robot.state.type != Mage) {
+    damageUnit(target_id, damage);
+    return;
+  }
+  // mages hit everything around the target too, friends included
+  const TraceUnit &target = findUnit(target_id)->state;
+  std::vector<uint32_t> hit;
+  for (int direction = 0; direction < num_directions; ++direction) {
+    const uint32_t occupant = unitAt(target.planet, target.x + direction_dx[direction],
+                                     target.y + direction_dy[direction]);
+    if (occupant != no_unit) {
+      hit.push_back(occupant);
+    }
+  }
+  for (uint32_t hit_id : hit) {
+    damageUnit(hit_id, damage);
+  }
+}
+
+void World::damageUnit(uint32_t id, int32_t damage) {
+  WorldUnit *unit = findUnit(id);
+  if (unit == nullptr) {
+    return;
+  }
+  if (damage < 0) {
+    unit->state.health = std::min<uint32_t>(unit->stats->max_health, unit->state.health - damage);
+    return;
+  }
+  if (unit->state.type == Knight) {
+    damage = std::max<int32_t>(0, damage - static_cast<int32_t>(unit->stats->knight_defense));
+  }
+  if (static_cast<uint32_t>(damage) >= unit->state.health) {
+    removeUnit(id);
+  } else {
+    unit->state.health -= damage;
+  }
+}
+
+void World::endRound() {
+  std::vector<uint32_t> ids;
+  ids.reserve(m_units.size());
+  for (const auto &entry : m_units) {
+    ids.push_back(entry.first);
+  }
+  for (uint32_t id : ids) {
+    // snipes can kill units further down the list
+    WorldUnit *unit = findUnit(id);
+    if (unit == nullptr) {
+      continue;
+    }
+    TraceUnit &state = unit->state;
+    state.movement_heat -= std::min(state.movement_heat, heat_loss_per_round);
+    state.attack_heat -= std::min(state.attack_heat, heat_loss_per_round);
+    state.ability_heat -= std::min(state.ability_heat, heat_loss_per_round);
+    state.worker_has_acted = false;
+    if (state.ranger_is_sniping && --state.ranger_countdown == 0) {
+      fireSnipe(*unit);
+    }
+    if (state.factory_is_producing) {
+      finishProduction(*unit);
+    }
+  }
+  for (uint8_t team = 0; team < 2; ++team) {
+    finishResearch(team);
+    karbonite[team] += karbonite_per_round - std::min(karbonite_per_round, karbonite[team] / karbonite_decrease_ratio);
+  }
+
+  ++round;
+  if (round == flood_round) {
+    for (uint32_t id : ids) {
+      const WorldUnit *unit = findUnit(id);
+      if (unit != nullptr && unit->state.location == TraceUnit::OnMap && unit->state.planet == Earth) {
+        removeUnit(id);
+      }
+    }
+  }
+  for (const RocketLanding &landing : landings) {
+    if (landing.round == round) {
+      landRocket(landing);
+    }
+  }
+  landings.erase(std::remove_if(landings.begin(), landings.end(),
+                                [this](const RocketLanding &landing) { return landing.round <= round; }),
+                 landings.end());
+  for (const TraceAsteroid &asteroid : m_asteroids) {
+    if (asteroid.round == round) {
+      m_karbonite[Mars][tile(Mars, asteroid.x, asteroid.y)] += asteroid.karbonite;
+    }
+  }
+  m_vision_dirty = true;
+}
+
+void World::fireSnipe(WorldUnit &ranger) {
+  TraceUnit &state = ranger.state;
+  state.ranger_is_sniping = false;
+  state.movement_heat = 0;
+  state.attack_heat = 0;
+  const uint32_t target = unitAt(state.planet, state.ranger_target_x, state.ranger_target_y);
+  if (target != no_unit) {
+    damageUnit(target, ranger.stats->damage);
+  }
+}
+
+void World::finishProduction(WorldUnit &factory) {
+  if (factory.factory_rounds_left > 0) {
+    --factory.factory_rounds_left;
+  }
+  // a full factory holds on to the robot until there's room
+  if (factory.factory_rounds_left > 0 || factory.state.garrison.size() >= factory.stats->structure_max_capacity) {
+    return;
+  }
+  TraceUnit robot;
+  robot.id = newUnitId();
+  robot.team = factory.state.team;
+  robot.type = factory.factory_unit_type;
+  robot.level = research_levels[robot.team][researchBranch(robot.type)];
+  robot.location = TraceUnit::InGarrison;
+  robot.planet = factory.state.planet;
+  robot.structure_id = factory.state.id;
+  robot.health = stats(robot.type, robot.level)->max_health;
+  factory.state.garrison.push_back(robot.id);
+  factory.state.factory_is_producing = false;
+  addUnit(robot);
+}
+
+void World::finishResearch(uint8_t team) {
+  std::vector<int> &queue = research_queues[team];
+  if (queue.empty()) {
+    return;
+  }
+  const int branch = queue.front();
+  const uint8_t level = research_levels[team][branch] + 1;
+  if (++m_research_progress[team] < researchRounds(branch, level)) {
+    return;
+  }
+  m_research_progress[team] = 0;
+  queue.erase(queue.begin());
+  research_levels[team][branch] = level;
+  // upgrades apply to units that are already out there too
+  for (auto &entry : m_units) {
+    WorldUnit &unit = entry.second;
+    if (unit.state.team == team && researchBranch(unit.state.type) == branch) {
+      unit.state.level = level;
+      unit.stats = stats(unit.state.type, level);
+    }
+  }
+  m_vision_dirty = true;
+}
+
+void World::landRocket(const RocketLanding &landing) {
+  WorldUnit *rocket = findUnit(landing.rocket_id);
+  if (rocket == nullptr) {
+    return;
+  }
+  // whatever is on the landing site is crushed, and everything around it takes blast damage
+  removeUnit(unitAt(landing.planet, landing.x, landing.y));
+  place(*rocket, landing.planet, landing.x, landing.y);
+  for (uint32_t passenger : rocket->state.garrison) {
+    findUnit(passenger)->state.planet = landing.planet;
+  }
+  for (int direction = 0; direction < num_directions - 1; ++direction) {
+    const uint32_t neighbor = unitAt(landing.planet, landing.x + direction_dx[direction],
+                                     landing.y + direction_dy[direction]);
+    if (neighbor != no_unit) {
+      damageUnit(neighbor, rocket_blast_damage);
+    }
+  }
+}
+
+bool World::canHarvest(uint32_t id, int direction) const {
+  const WorldUnit *worker = myRobotOnMap(id, "harvest");
+  if (worker == nullptr || worker->state.type != Worker || worker->state.worker_has_acted || direction < 0 ||
+      direction >= num_directions) {
+    return false;
+  }
+  const int x = worker->state.x + direction_dx[direction];
+  const int y = worker->state.y + direction_dy[direction];
+  return isOnMap(worker->state.planet, x, y) && m_karbonite[worker->state.planet][tile(worker->state.planet, x, y)] > 0;
+}
+
+void World::harvest(uint32_t id, int direction) {
+  if (!canHarvest(id, direction)) {
+    fail("InvalidAction: " + std::to_string(id) + " can't harvest");
+    return;
+  }
+  WorldUnit &worker = *findUnit(id);
+  uint32_t &deposit = m_karbonite[worker.state.planet][tile(worker.state.planet,
+                                                            worker.state.x + direction_dx[direction],
+                                                            worker.state.y + direction_dy[direction])];
+  const uint32_t amount = std::min(deposit, worker.stats->worker_harvest_amount);
+  deposit -= amount;
+  karbonite[m_team] += amount;
+  worker.state.worker_has_acted = true;
+}
+
+bool World::canBlueprint(uint32_t id, uint8_t type, int direction) const {
+  const WorldUnit *worker = myRobotOnMap(id, "blueprint");
+  if (worker == nullptr || worker->state.type != Worker || worker->state.worker_has_acted || !isStructure(type) ||
+      direction < 0 || direction >= num_directions - 1) {
+    return false;
+  }
+  if (worker->state.planet != Earth || karbonite[m_team] < blueprintCost(type) ||
+      (type == Rocket && research_levels[m_team][researchBranch(Rocket)] == 0)) {
+    return false;
+  }
+  return isOccupiable(worker->state.planet, worker->state.x + direction_dx[direction],
+                      worker->state.y + direction_dy[direction]);
+}
+
+void World::blueprint(uint32_t id, uint8_t type, int direction) {
+  if (!canBlueprint(id, type, direction)) {
+    fail("InvalidAction: " + std::to_string(id) + " can't blueprint");
+    return;
+  }
+  WorldUnit &worker = *findUnit(id);
+  worker.state.worker_has_acted = true;
+  karbonite[m_team] -= blueprintCost(type);
+
+  TraceUnit blueprint;
+  blueprint.id = newUnitId();
+  blueprint.team = m_team;
+  blueprint.type = type;
+  blueprint.level = type == Rocket ? research_levels[m_team][researchBranch(Rocket)] : 0;
+  blueprint.planet = worker.state.planet;
+  blueprint.x = static_cast<uint8_t>(worker.state.x + direction_dx[direction]);
+  blueprint.y = static_cast<uint8_t>(worker.state.y + direction_dy[direction]);
+  blueprint.health = stats(type, blueprint.level)->max_health / 4;
+  addUnit(blueprint);
+}
+
+bool World::canBuild(uint32_t id, uint32_t blueprint_id) const {
+  const WorldUnit *worker = myRobotOnMap(id, "build");
+  if (worker == nullptr || worker->state.type != Worker || worker->state.worker_has_acted ||
+      !canSenseUnit(blueprint_id)) {
+    return false;
+  }
+  const TraceUnit &blueprint = m_units.find(blueprint_id)->second.state;
+  return isStructure(blueprint.type) && blueprint.team == m_team && !blueprint.structure_is_built &&
+         onSamePlanet(worker->state, blueprint) && distanceSquared(worker->state, blueprint) <= 2;
+}
+
+void World::build(uint32_t id, uint32_t blueprint_id) {
+  if (!canBuild(id, blueprint_id)) {
+    fail("InvalidAction: " + std::to_string(id) + " can't build " + std::to_string(blueprint_id));
+    return;
+  }
+  WorldUnit &worker = *findUnit(id);
+  WorldUnit &blueprint = *findUnit(blueprint_id);
+  worker.state.worker_has_acted = true;
+  blueprint.state.health = std::min(blueprint.stats->max_health,
+                                    blueprint.state.health + worker.stats->worker_build_health);
+  if (blueprint.state.health == blueprint.stats->max_health) {
+    blueprint.state.structure_is_built = true;
+  }
+}
+
+bool World::canRepair(uint32_t id, uint32_t structure_id) const {
+  const WorldUnit *worker = myRobotOnMap(id, "repair");
+  if (worker == nullptr || worker->state.type != Worker || worker->state.worker_has_acted ||
+      !canSenseUnit(structure_id)) {
+    return false;
+  }
+  const TraceUnit &structure = m_units.find(structure_id)->second.state;
+  return isStructure(structure.type) && structure.structure_is_built && onSamePlanet(worker->state, structure) &&
+         distanceSquared(worker->state, structure) <= 2;
+}
+
+void World::repair(uint32_t id, uint32_t structure_id) {
+  if (!canRepair(id, structure_id)) {
+    fail("InvalidAction: " + std::to_string(id) + " can't repair " + std::to_string(structure_id));
+    return;
+  }
+  WorldUnit &worker = *findUnit(id);
+  WorldUnit &structure = *findUnit(structure_id);
+  worker.state.worker_has_acted = true;
+  structure.state.health = std::min(structure.stats->max_health,
+                                    structure.state.health + worker.stats->worker_repair_health);
+}
+
+bool World::canReplicate(uint32_t id, int direction) const {
+  const WorldUnit *worker = myRobotOnMap(id, "replicate");
+  if (worker == nullptr || worker->state.type != Worker || worker->state.worker_has_acted ||
+      worker->state.ability_heat >= max_ready_heat || karbonite[m_team] < replicateCost() || direction < 0 ||
+      direction >= num_directions - 1) {
+    return false;
+  }
+  return isOccupiable(worker->state.planet, worker->state.x + direction_dx[direction],
+                      worker->state.y + direction_dy[direction]);
+}
+
+void World::replicate(uint32_t id, int direction) {
+  if (!canReplicate(id, direction)) {
+    fail("InvalidAction: " + std::to_string(id) + " can't replicate");
+    return;
+  }
+  WorldUnit &worker = *findUnit(id);
+  worker.state.worker_has_acted = true;
+  worker.state.ability_heat += worker.stats->ability_cooldown;
+  karbonite[m_team] -= replicateCost();
+
+  TraceUnit copy;
+  copy.id = newUnitId();
+  copy.team = m_team;
+  copy.type = Worker;
+  copy.level = worker.state.level;
+  copy.planet = worker.state.planet;
+  copy.x = static_cast<uint8_t>(worker.state.x + direction_dx[direction]);
+  copy.y = static_cast<uint8_t>(worker.state.y + direction_dy[direction]);
+  copy.health = worker.stats->max_health;
+  addUnit(copy);
+}
+
+bool World::canJavelin(uint32_t id, uint32_t target_id) const {
+  const WorldUnit *knight = myRobotOnMap(id, "javelin");
+  if (knight == nullptr || knight->state.type != Knight || !knight->stats->is_ability_unlocked ||
+      !canSenseUnit(target_id)) {
+    return false;
+  }
+  const TraceUnit &target = m_units.find(target_id)->second.state;
+  return onSamePlanet(knight->state, target) && distanceSquared(knight->state, target) <= knight->stats->ability_range;
+}
+
+bool World::isJavelinReady(uint32_t id) const {
+  const WorldUnit *knight = myUnit(id, "javelin");
+  return knight != nullptr && knight->state.type == Knight && knight->stats->is_ability_unlocked &&
+         knight->state.ability_heat < max_ready_heat;
+}
+
+void World::javelin(uint32_t id, uint32_t target_id) {
+  if (!isJavelinReady(id) || !canJavelin(id, target_id)) {
+    fail("InvalidAction: " + std::to_string(id) + " can't javelin " + std::to_string(target_id));
+    return;
+  }
+  WorldUnit &knight = *findUnit(id);
+  knight.state.ability_heat += knight.stats->ability_cooldown;
+  damageUnit(target_id, knight.stats->damage);
+}
+
+bool World::canBeginSnipe(uint32_t id, uint8_t planet, int x, int y) const {
+  const WorldUnit *ranger = myRobotOnMap(id, "snipe");
+  return ranger != nullptr && ranger->state.type == Ranger && ranger->stats->is_ability_unlocked &&
+         ranger->state.planet == planet && isOnMap(planet, x, y);
+}
+
+bool World::isBeginSnipeReady(uint32_t id) const {
+  const WorldUnit *ranger = myUnit(id, "snipe");
+  return ranger != nullptr && ranger->state.type == Ranger && ranger->stats->is_ability_unlocked &&
+         ranger->state.ability_heat < max_ready_heat;
+}
+
+void World::beginSnipe(uint32_t id, uint8_t planet, int x, int y) {
+  if (!isBeginSnipeReady(id) || !canBeginSnipe(id, planet, x, y)) {
+    fail("InvalidAction: " + std::to_string(id) + " can't snipe");
+    return;
+  }
+  WorldUnit &ranger = *findUnit(id);
+  ranger.state.ranger_is_sniping = true;
+  ranger.state.ranger_countdown = ranger.stats->ranger_max_countdown;
+  ranger.state.ranger_target_x = static_cast<uint8_t>(x);
+  ranger.state.ranger_target_y = static_cast<uint8_t>(y);
+  ranger.state.ability_heat += ranger.stats->ability_cooldown;
+  // it can't do anything else until the shot goes off
+  ranger.state.movement_heat = UINT32_MAX;
+  ranger.state.attack_heat = UINT32_MAX;
+}
+
+bool World::canBlink(uint32_t id, uint8_t planet, int x, int y) const {
+  const WorldUnit *mage = myRobotOnMap(id, "blink");
+  return mage != nullptr && mage->state.type == Mage && mage->stats->is_ability_unlocked &&
+         mage->state.planet == planet && distanceSquared(mage->state.x, mage->state.y, x, y) <=
+                                         mage->stats->ability_range && isOccupiable(planet, x, y);
+}
+
+bool World::isBlinkReady(uint32_t id) const {
+  const WorldUnit *mage = myUnit(id, "blink");
+  return mage != nullptr && mage->state.type == Mage && mage->stats->is_ability_unlocked &&
+         mage->state.ability_heat < max_ready_heat;
+}
+
+void World::blink(uint32_t id, uint8_t planet, int x, int y) {
+  if (!isBlinkReady(id) || !canBlink(id, planet, x, y)) {
+    fail("InvalidAction: " + std::to_string(id) + " can't blink");
+    return;
+  }
+  WorldUnit &mage = *findUnit(id);
+  lift(mage);
+  place(mage, planet, x, y);
+  mage.state.ability_heat += mage.stats->ability_cooldown;
+}
+
+bool World::canHeal(uint32_t id, uint32_t target_id) const {
+  const WorldUnit *healer = myRobotOnMap(id, "heal");
+  if (healer == nullptr || healer->state.type != Healer || !canSenseUnit(target_id)) {
+    return false;
+  }
+  const TraceUnit &target = m_units.find(target_id)->second.state;
+  return !isStructure(target.type) && onSamePlanet(healer->state, target) &&
+         distanceSquared(healer->state, target) <= healer->stats->attack_range;
+}
+
+bool World::isHealReady(uint32_t id) const {
+  const WorldUnit *healer = myUnit(id, "heal");
+  return healer != nullptr && healer->state.type == Healer && healer->state.attack_heat < max_ready_heat;
+}
+
+void World::heal(uint32_t id, uint32_t target_id) {
+  if (!isHealReady(id) || !canHeal(id, target_id)) {
+    fail("InvalidAction: " + std::to_string(id) + " can't heal " + std::to_string(target_id));
+    return;
+  }
+  WorldUnit &healer = *findUnit(id);
+  healer.state.attack_heat += healer.stats->attack_cooldown;
+  damageUnit(target_id, healer.stats->damage);
+}
+
+bool World::canOvercharge(uint32_t id, uint32_t target_id) const {
+  const WorldUnit *healer = myRobotOnMap(id, "overcharge");
+  if (healer == nullptr || healer->state.type != Healer || !healer->stats->is_ability_unlocked ||
+      !canSenseUnit(target_id)) {
+    return false;
+  }
+  const TraceUnit &target = m_units.find(target_id)->second.state;
+  return target.team == m_team && !isStructure(target.type) && onSamePlanet(healer->state, target) &&
+         distanceSquared(healer->state, target) <= healer->stats->ability_range;
+}
+
+bool World::isOverchargeReady(uint32_t id) const {
+  const WorldUnit *healer = myUnit(id, "overcharge");
+  return healer != nullptr && healer->state.type == Healer && healer->stats->is_ability_unlocked &&
+         healer->state.ability_heat < max_ready_heat;
+}
+
+void World::overcharge(uint32_t id, uint32_t target_id) {
+  if (!isOverchargeReady(id) || !canOvercharge(id, target_id)) {
+    fail("InvalidAction: " + std::to_string(id) + " can't overcharge " + std::to_string(target_id));
+    return;
+  }
+  WorldUnit &healer = *findUnit(id);
+  WorldUnit &target = *findUnit(target_id);
+  healer.state.ability_heat += healer.stats->ability_cooldown;
+  target.state.movement_heat = 0;
+  target.state.attack_heat = 0;
+  target.state.ability_heat = 0;
+}
+
+bool World::canLoad(uint32_t structure_id, uint32_t robot_id) const {
+  const WorldUnit *structure = myUnit(structure_id, "load");
+  const WorldUnit *robot = myRobotOnMap(robot_id, "load");
+  if (structure == nullptr || robot == nullptr || structure->state.type != Rocket ||
+      !structure->state.structure_is_built || structure->state.location != TraceUnit::OnMap) {
+    return false;
+  }
+  return structure->state.garrison.size() < structure->stats->structure_max_capacity &&
+         robot->state.movement_heat < max_ready_heat && onSamePlanet(structure->state, robot->state) &&
+         distanceSquared(structure->state, robot->state) <= 2;
+}
+
+void World::load(uint32_t structure_id, uint32_t robot_id) {
+  if (!canLoad(structure_id, robot_id)) {
+    fail("InvalidAction: " + std::to_string(structure_id) + " can't load " + std::to_string(robot_id));
+    return;
+  }
+  WorldUnit &structure = *findUnit(structure_id);
+  WorldUnit &robot = *findUnit(robot_id);
+  lift(robot);
+  robot.state.location = TraceUnit::InGarrison;
+  robot.state.structure_id = structure_id;
+  robot.state.movement_heat += robot.stats->movement_cooldown;
+  structure.state.garrison.push_back(robot_id);
+}
+
+bool World::canUnload(uint32_t structure_id, int direction) const {
+  const WorldUnit *structure = myUnit(structure_id, "unload");
+  if (structure == nullptr || !isStructure(structure->state.type) || !structure->state.structure_is_built ||
+      structure->state.location != TraceUnit::OnMap || structure->state.garrison.empty() || direction < 0 ||
+      direction >= num_directions - 1) {
+    return false;
+  }
+  const WorldUnit &first = m_units.find(structure->state.garrison.front())->second;
+  return first.state.movement_heat < max_ready_heat &&
+         isOccupiable(structure->state.planet, structure->state.x + direction_dx[direction],
+                      structure->state.y + direction_dy[direction]);
+}
+
+void World::unload(uint32_t structure_id, int direction) {
+  if (!canUnload(structure_id, direction)) {
+    fail("InvalidAction: " + std::to_string(structure_id) + " can't unload");
+    return;
+  }
+  WorldUnit &structure = *findUnit(structure_id);
+  WorldUnit &robot = *findUnit(structure.state.garrison.front());
+  structure.state.garrison.erase(structure.state.garrison.begin());
+  place(robot, structure.state.planet, structure.state.x + direction_dx[direction],
+        structure.state.y + direction_dy[direction]);
+  robot.state.movement_heat += robot.stats->movement_cooldown;
+}
+
+bool World::canProduceRobot(uint32_t factory_id, uint8_t type) const {
+  const WorldUnit *factory = myUnit(factory_id, "produce");
+  return factory != nullptr && factory->state.type == Factory && factory->state.structure_is_built &&
+         !factory->state.factory_is_producing && !isStructure(type) && type <= Healer &&
+         karbonite[m_team] >= factoryCost(type);
+}
+
+void World::produceRobot(uint32_t factory_id, uint8_t type) {
+  if (!canProduceRobot(factory_id, type)) {
+    fail("InvalidAction: " + std::to_string(factory_id) + " can't produce");
+    return;
+  }
+  WorldUnit &factory = *findUnit(factory_id);
+  karbonite[m_team] -= factoryCost(type);
+  factory.state.factory_is_producing = true;
+  factory.factory_unit_type = type;
+  factory.factory_rounds_left = 5;
+}
+
+bool World::canLaunchRocket(uint32_t rocket_id, uint8_t planet, int x, int y) const {
+  const WorldUnit *rocket = myUnit(rocket_id, "launch");
+  return rocket != nullptr && rocket->state.type == Rocket && rocket->state.structure_is_built &&
+         !rocket->rocket_is_used && rocket->state.location == TraceUnit::OnMap && planet != rocket->state.planet &&
+         isOnMap(planet, x, y) && m_maps[planet].passable[tile(planet, x, y)] != 0;
+}
+
+void World::launchRocket(uint32_t rocket_id, uint8_t planet, int x, int y) {
+  if (!canLaunchRocket(rocket_id, planet, x, y)) {
+    fail("InvalidAction: " + std::to_string(rocket_id) + " can't launch");
+    return;
+  }
+  WorldUnit &rocket = *findUnit(rocket_id);
+  lift(rocket);
+  rocket.state.location = TraceUnit::InSpace;
+  rocket.rocket_is_used = true;
+  landings.push_back(RocketLanding{round + flight_rounds, rocket_id, planet, static_cast<uint8_t>(x),
+                                   static_cast<uint8_t>(y)});
+}
+
+bool World::queueResearch(uint8_t branch_type) {
+  const int branch = researchBranch(branch_type);
+  if (branch < 0) {
+    return false;
+  }
+  std::vector<int> &queue = research_queues[m_team];
+  const long queued = std::count(queue.begin(), queue.end(), branch);
+  if (research_levels[m_team][branch] + queued >= maxResearchLevel(branch)) {
+    return false;
+  }
+  queue.push_back(branch);
+  return true;
+}
+
+void World::writeTeamArray(uint32_t index, int32_t value) {
+  std::vector<int32_t> &array = team_arrays[m_team][m_planet];
+  if (index >= team_array_length) {
+    fail("ArrayOutOfBounds: team array index " + std::to_string(index));
+    return;
+  }
+  if (array.size() < team_array_length) {
+    array.resize(team_array_length);
+  }
+  array[index] = value;
+}
+
+std::string World::takeError() {
+  std::string error;
+  error.swap(m_error);
+  return error;
+}
+
+void World::fail(const std::string &error) const {
+  m_error = error;
+}
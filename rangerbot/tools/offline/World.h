@@ -0,0 +1,331 @@
+#ifndef RANGERBOT_TOOLS_WORLD_H
+#define RANGERBOT_TOOLS_WORLD_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../../TurnTrace.h"
+
+/*
+ * Game state behind the stand-in bc::GameController in bcpp_api/bc.hpp, for running the bot without the engine.
+ *
+ * Like the real api, everything is seen by one player at a time, the team and planet whose turn it is: their own
+ * units on that planet, and other units and karbonite within the vision range of those units. Units in a garrison
+ * have the planet of their structure. Actions follow the documented rules of the api, e.g. can_ checks ignore heat and
+ * is_ready checks only look at heat. A failed action records an error for CHECK_ERRORS() to report, and changes
+ * nothing.
+ *
+ * What happens between turns is up to a TurnDriver. next_turn() hands it control, and it returns once it's the
+ * bot's turn again, e.g. tools/replay loads the next recorded turn, and tools/sim lets the other players move and
+ * runs endRound().
+ *
+ * Units reuse TraceUnit for their state. Stats come from a table keyed by type and research level, which the driver
+ * can fill in, e.g. from a trace, and which falls back to the stats in the game specs.
+ */
+
+struct WorldUnit {
+  TraceUnit state;
+  // points into the world's stats table, which never removes anything
+  const TraceUnitStats *stats = nullptr;
+  // not in the trace, the api doesn't expose them
+  uint8_t factory_unit_type = 0;
+  uint32_t factory_rounds_left = 0;
+  bool rocket_is_used = false;
+};
+
+struct RocketLanding {
+  uint32_t round;
+  uint32_t rocket_id;
+  uint8_t planet;
+  uint8_t x;
+  uint8_t y;
+};
+
+class World;
+
+class TurnDriver {
+ public:
+  virtual ~TurnDriver() = default;
+
+  // called from next_turn(), returns once it's the bot's turn again
+  virtual void nextTurn(World &world) = 0;
+};
+
+class World {
+ public:
+  // unit types, planets, teams and directions, as in the api
+  enum : uint8_t {Worker, Knight, Ranger, Mage, Healer, Factory, Rocket};
+  enum : uint8_t {Earth, Mars};
+  static const int num_directions = 9;
+  static const int direction_dx[num_directions];
+  static const int direction_dy[num_directions];
+
+  // a robot can act while the heat for it is below this
+  static const uint32_t max_ready_heat = 10;
+  static const uint32_t team_array_length = 100;
+  static const uint32_t no_unit = UINT32_MAX;
+  static const uint32_t flood_round = 750;
+  static const uint32_t last_round = 1000;
+
+  static World *current() { return s_current; }
+
+  static void setCurrent(World *world) { s_current = world; }
+
+  static uint32_t blueprintCost(uint8_t type);
+
+  static uint32_t factoryCost(uint8_t type);
+
+  static uint32_t replicateCost();
+
+  static bool isStructure(uint8_t type) { return type == Factory || type == Rocket; }
+
+  // the stats in the game specs, for units that aren't in a trace
+  static TraceUnitStats defaultStats(uint8_t type, uint8_t level);
+
+  // research branches are indexed like TraceTurn::research_levels, -1 if the type has none
+  static int researchBranch(uint8_t type);
+
+  static uint8_t maxResearchLevel(int branch);
+
+  // rounds it takes to research the given level, 0 past the last one
+  static uint32_t researchRounds(int branch, uint8_t level);
+
+  void setDriver(TurnDriver *driver) { m_driver = driver; }
+
+  void nextTurn();
+
+  /*
+   * Setup, for drivers.
+   */
+
+  void setMap(const TraceMap &map);
+
+  void setAsteroids(const std::vector<TraceAsteroid> &asteroids) { m_asteroids = asteroids; }
+
+  void setPerspective(uint8_t team, uint8_t planet);
+
+  void addStats(const TraceUnitStats &stats);
+
+  // falls back to the default stats, so it's never nullptr
+  const TraceUnitStats *stats(uint8_t type, uint8_t level);
+
+  void addUnit(const TraceUnit &unit);
+
+  // along with anything in its garrison
+  void removeUnit(uint32_t id);
+
+  void clearUnits();
+
+  uint32_t newUnitId() { return m_next_id++; }
+
+  uint32_t round = 1;
+  uint32_t time_left_ms = 10000;
+  uint32_t karbonite[2] = {};
+  uint8_t research_levels[2][TraceTurn::num_branches] = {};
+  // [team][planet]
+  std::vector<int32_t> team_arrays[2][2];
+  std::vector<int> research_queues[2];
+  std::vector<RocketLanding> landings;
+
+  /*
+   * Queries, as the current player sees them.
+   */
+
+  uint8_t team() const { return m_team; }
+
+  uint8_t planet() const { return m_planet; }
+
+  const TraceMap &map(uint8_t planet) const { return m_maps[planet]; }
+
+  const std::vector<TraceAsteroid> &asteroids() const { return m_asteroids; }
+
+  bool isOnMap(uint8_t planet, int x, int y) const;
+
+  bool canSense(uint8_t planet, int x, int y) const;
+
+  uint32_t karboniteAt(uint8_t planet, int x, int y) const;
+
+  void setKarboniteAt(uint8_t planet, int x, int y, uint32_t karbonite);
+
+  // any unit, visible or not. for drivers.
+  WorldUnit *findUnit(uint32_t id);
+
+  const std::map<uint32_t, WorldUnit> &allUnits() const { return m_units; }
+
+  // nullptr, with an error, if the current player can't see it
+  const WorldUnit *unit(uint32_t id) const;
+
+  bool canSenseUnit(uint32_t id) const;
+
+  // no_unit if there's nothing there
+  uint32_t unitAt(uint8_t planet, int x, int y) const;
+
+  std::vector<const WorldUnit *> visibleUnits() const;
+
+  std::vector<const WorldUnit *> myUnits() const;
+
+  std::vector<const WorldUnit *> myUnitsInSpace() const;
+
+  // team and type are ignored when they're out of range
+  std::vector<const WorldUnit *> nearbyUnits(uint8_t planet, int x, int y, uint32_t radius_squared, int team,
+                                             int type) const;
+
+  bool isOccupiable(uint8_t planet, int x, int y) const;
+
+  /*
+   * Actions, for the current player's units.
+   */
+
+  bool canMove(uint32_t id, int direction) const;
+
+  bool isMoveReady(uint32_t id) const;
+
+  void moveRobot(uint32_t id, int direction);
+
+  bool canAttack(uint32_t id, uint32_t target_id) const;
+
+  bool isAttackReady(uint32_t id) const;
+
+  void attack(uint32_t id, uint32_t target_id);
+
+  bool canHarvest(uint32_t id, int direction) const;
+
+  void harvest(uint32_t id, int direction);
+
+  bool canBlueprint(uint32_t id, uint8_t type, int direction) const;
+
+  void blueprint(uint32_t id, uint8_t type, int direction);
+
+  bool canBuild(uint32_t id, uint32_t blueprint_id) const;
+
+  void build(uint32_t id, uint32_t blueprint_id);
+
+  bool canRepair(uint32_t id, uint32_t structure_id) const;
+
+  void repair(uint32_t id, uint32_t structure_id);
+
+  bool canReplicate(uint32_t id, int direction) const;
+
+  void replicate(uint32_t id, int direction);
+
+  bool canJavelin(uint32_t id, uint32_t target_id) const;
+
+  bool isJavelinReady(uint32_t id) const;
+
+  void javelin(uint32_t id, uint32_t target_id);
+
+  bool canBeginSnipe(uint32_t id, uint8_t planet, int x, int y) const;
+
+  bool isBeginSnipeReady(uint32_t id) const;
+
+  void beginSnipe(uint32_t id, uint8_t planet, int x, int y);
+
+  bool canBlink(uint32_t id, uint8_t planet, int x, int y) const;
+
+  bool isBlinkReady(uint32_t id) const;
+
+  void blink(uint32_t id, uint8_t planet, int x, int y);
+
+  bool canHeal(uint32_t id, uint32_t target_id) const;
+
+  bool isHealReady(uint32_t id) const;
+
+  void heal(uint32_t id, uint32_t target_id);
+
+  bool canOvercharge(uint32_t id, uint32_t target_id) const;
+
+  bool isOverchargeReady(uint32_t id) const;
+
+  void overcharge(uint32_t id, uint32_t target_id);
+
+  bool canLoad(uint32_t structure_id, uint32_t robot_id) const;
+
+  void load(uint32_t structure_id, uint32_t robot_id);
+
+  bool canUnload(uint32_t structure_id, int direction) const;
+
+  void unload(uint32_t structure_id, int direction);
+
+  bool canProduceRobot(uint32_t factory_id, uint8_t type) const;
+
+  void produceRobot(uint32_t factory_id, uint8_t type);
+
+  bool canLaunchRocket(uint32_t rocket_id, uint8_t planet, int x, int y) const;
+
+  void launchRocket(uint32_t rocket_id, uint8_t planet, int x, int y);
+
+  bool queueResearch(uint8_t branch_type);
+
+  void writeTeamArray(uint32_t index, int32_t value);
+
+  // rounds from launch to landing. the driver keeps it up to date.
+  uint32_t flight_rounds = 100;
+
+  /*
+   * Rules shared with drivers.
+   */
+
+  // negative damage heals. applies knight defense, and removes the unit if it dies.
+  void damageUnit(uint32_t id, int32_t damage);
+
+  /*
+   * What the engine does once all four players have moved: heat goes down, snipes go off, factories and research
+   * make progress and both teams get their karbonite income. Then the next round starts, and earth floods, rockets
+   * land and asteroids hit mars if it's their round.
+   */
+  void endRound();
+
+  // the last error, cleared by reading it
+  std::string takeError();
+
+  void fail(const std::string &error) const;
+
+ private:
+  // the current player's unit, or nullptr with an error
+  WorldUnit *myUnit(uint32_t id, const char *action);
+
+  const WorldUnit *myUnit(uint32_t id, const char *action) const;
+
+  // the current player's robot on the map, or nullptr with an error
+  const WorldUnit *myRobotOnMap(uint32_t id, const char *action) const;
+
+  void place(WorldUnit &unit, uint8_t planet, int x, int y);
+
+  void lift(WorldUnit &unit);
+
+  size_t tile(uint8_t planet, int x, int y) const { return y * m_maps[planet].width + x; }
+
+  void updateVision() const;
+
+  void fireSnipe(WorldUnit &ranger);
+
+  void finishProduction(WorldUnit &factory);
+
+  void finishResearch(uint8_t team);
+
+  void landRocket(const RocketLanding &landing);
+
+  static World *s_current;
+
+  TurnDriver *m_driver = nullptr;
+  TraceMap m_maps[2];
+  std::vector<TraceAsteroid> m_asteroids;
+  std::vector<uint32_t> m_karbonite[2];
+  std::vector<uint32_t> m_occupants[2];
+  std::map<uint32_t, WorldUnit> m_units;
+  std::map<unsigned int, TraceUnitStats> m_stats;
+  uint32_t m_next_id = 1;
+  // rounds spent on the research at the front of each team's queue
+  uint32_t m_research_progress[2] = {};
+  uint8_t m_team = 0;
+  uint8_t m_planet = 0;
+
+  // what the current player can see, recomputed when their units change
+  mutable std::vector<uint8_t> m_vision;
+  mutable bool m_vision_dirty = true;
+  mutable std::string m_error;
+};
+
+#endif //RANGERBOT_TOOLS_WORLD_H
@@ -0,0 +1,513 @@
+#ifndef RANGERBOT_TOOLS_BC_HPP
+#define RANGERBOT_TOOLS_BC_HPP
+
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../World.h"
+
+/*
+ * Stand-in for the engine's C++ api, with the surface the bot uses, backed by a World instead of the engine. Tools
+ * build the bot's sources against this instead of the real bcpp_api, see tools/build.sh.
+ *
+ * GameController talks to World::current(), which has to be set up before it's constructed. Like the real api, units
+ * are snapshots, so they don't change when the world does.
+ */
+
+#define CHECK_ERRORS() bc::check_errors()
+
+namespace bc {
+
+enum Planet {Earth = 0, Mars = 1};
+
+enum Direction {North = 0, Northeast, East, Southeast, South, Southwest, West, Northwest, Center};
+
+enum Team {Red = 0, Blue = 1};
+
+enum UnitType {Worker = 0, Knight, Ranger, Mage, Healer, Factory, Rocket};
+
+inline void check_errors() {
+  const std::string error = World::current()->takeError();
+  if (!error.empty()) {
+    fprintf(stderr, "api error: %s\n", error.c_str());
+  }
+}
+
+inline unsigned int unit_type_get_blueprint_cost(UnitType type) { return World::blueprintCost(type); }
+
+inline unsigned int unit_type_get_factory_cost(UnitType type) { return World::factoryCost(type); }
+
+inline unsigned int unit_type_get_replicate_cost() { return World::replicateCost(); }
+
+inline int direction_dx(Direction direction) { return World::direction_dx[direction]; }
+
+inline int direction_dy(Direction direction) { return World::direction_dy[direction]; }
+
+class MapLocation {
+ public:
+  MapLocation() = default;
+
+  MapLocation(Planet planet, int x, int y) : m_planet(planet), m_x(x), m_y(y) {}
+
+  Planet get_planet() const { return m_planet; }
+
+  int get_x() const { return m_x; }
+
+  int get_y() const { return m_y; }
+
+  MapLocation add(Direction direction) const { return translate(direction_dx(direction), direction_dy(direction)); }
+
+  MapLocation subtract(Direction direction) const {
+    return translate(-direction_dx(direction), -direction_dy(direction));
+  }
+
+  MapLocation add_multiple(Direction direction, int multiple) const {
+    return translate(multiple * direction_dx(direction), multiple * direction_dy(direction));
+  }
+
+  MapLocation translate(int dx, int dy) const { return MapLocation(m_planet, m_x + dx, m_y + dy); }
+
+  unsigned int distance_squared_to(const MapLocation &other) const {
+    return (m_x - other.m_x) * (m_x - other.m_x) + (m_y - other.m_y) * (m_y - other.m_y);
+  }
+
+  Direction direction_to(const MapLocation &other) const {
+    const int dx = (other.m_x > m_x) - (other.m_x < m_x);
+    const int dy = (other.m_y > m_y) - (other.m_y < m_y);
+    for (int direction = 0; direction < World::num_directions; ++direction) {
+      if (World::direction_dx[direction] == dx && World::direction_dy[direction] == dy) {
+        return static_cast<Direction>(direction);
+      }
+    }
+    return Center;
+  }
+
+  bool is_adjacent_to(const MapLocation &other) const { return distance_squared_to(other) <= 2; }
+
+  bool is_within_range(unsigned int range, const MapLocation &other) const {
+    return distance_squared_to(other) <= range;
+  }
+
+  bool operator==(const MapLocation &other) const {
+    return m_planet == other.m_planet && m_x == other.m_x && m_y == other.m_y;
+  }
+
+ private:
+  Planet m_planet = Earth;
+  int m_x = 0;
+  int m_y = 0;
+};
+
+class Location {
+ public:
+  Location() = default;
+
+  explicit Location(const TraceUnit &state) : m_state(state) {}
+
+  bool is_on_map() const { return m_state.location == TraceUnit::OnMap; }
+
+  bool is_on_planet(Planet planet) const { return is_on_map() && m_state.planet == planet; }
+
+  bool is_in_garrison() const { return m_state.location == TraceUnit::InGarrison; }
+
+  bool is_in_space() const { return m_state.location == TraceUnit::InSpace; }
+
+  MapLocation get_map_location() const {
+    return MapLocation(static_cast<Planet>(m_state.planet), m_state.x, m_state.y);
+  }
+
+  unsigned int get_structure() const { return m_state.structure_id; }
+
+ private:
+  TraceUnit m_state;
+};
+
+class Unit {
+ public:
+  // what a failed get_unit() returns. it has no stats, but reading them gives zeros rather than a crash.
+  Unit() { m_unit.stats = &no_stats(); }
+
+  explicit Unit(const WorldUnit &unit) : m_unit(unit) {}
+
+  unsigned int get_id() const { return m_unit.state.id; }
+
+  Team get_team() const { return static_cast<Team>(m_unit.state.team); }
+
+  UnitType get_unit_type() const { return static_cast<UnitType>(m_unit.state.type); }
+
+  unsigned int get_research_level() const { return m_unit.state.level; }
+
+  Location get_location() const { return Location(m_unit.state); }
+
+  bool is_on_map() const { return m_unit.state.location == TraceUnit::OnMap; }
+
+  MapLocation get_map_location() const {
+    return MapLocation(static_cast<Planet>(m_unit.state.planet), m_unit.state.x, m_unit.state.y);
+  }
+
+  bool is_robot() const { return !is_structure(); }
+
+  bool is_structure() const { return World::isStructure(m_unit.state.type); }
+
+  unsigned int get_health() const { return m_unit.state.health; }
+
+  unsigned int get_max_health() const { return m_unit.stats->max_health; }
+
+  unsigned int get_vision_range() const { return m_unit.stats->vision_range; }
+
+  int get_damage() const { return m_unit.stats->damage; }
+
+  unsigned int get_attack_range() const { return m_unit.stats->attack_range; }
+
+  unsigned int get_movement_heat() const { return m_unit.state.movement_heat; }
+
+  unsigned int get_attack_heat() const { return m_unit.state.attack_heat; }
+
+  unsigned int get_movement_cooldown() const { return m_unit.stats->movement_cooldown; }
+
+  unsigned int get_attack_cooldown() const { return m_unit.stats->attack_cooldown; }
+
+  bool is_ability_unlocked() const { return m_unit.stats->is_ability_unlocked; }
+
+  unsigned int get_ability_heat() const { return m_unit.state.ability_heat; }
+
+  unsigned int get_ability_cooldown() const { return m_unit.stats->ability_cooldown; }
+
+  unsigned int get_ability_range() const { return m_unit.stats->ability_range; }
+
+  bool worker_has_acted() const { return m_unit.state.worker_has_acted; }
+
+  unsigned int get_worker_build_health() const { return m_unit.stats->worker_build_health; }
+
+  unsigned int get_worker_repair_health() const { return m_unit.stats->worker_repair_health; }
+
+  unsigned int get_worker_harvest_amount() const { return m_unit.stats->worker_harvest_amount; }
+
+  unsigned int get_knight_defense() const { return m_unit.stats->knight_defense; }
+
+  unsigned int get_ranger_cannot_attack_range() const { return m_unit.stats->ranger_cannot_attack_range; }
+
+  unsigned int get_ranger_max_countdown() const { return m_unit.stats->ranger_max_countdown; }
+
+  bool ranger_is_sniping() const { return m_unit.state.ranger_is_sniping; }
+
+  unsigned int get_ranger_countdown() const { return m_unit.state.ranger_countdown; }
+
+  MapLocation get_ranger_target_location() const {
+    return MapLocation(static_cast<Planet>(m_unit.state.planet), m_unit.state.ranger_target_x,
+                       m_unit.state.ranger_target_y);
+  }
+
+  bool structure_is_built() const { return m_unit.state.structure_is_built; }
+
+  unsigned int get_structure_max_capacity() const { return m_unit.stats->structure_max_capacity; }
+
+  std::vector<unsigned int> get_structure_garrison() const {
+    return std::vector<unsigned int>(m_unit.state.garrison.begin(), m_unit.state.garrison.end());
+  }
+
+  bool is_factory_producing() const { return m_unit.state.factory_is_producing; }
+
+ private:
+  static const TraceUnitStats &no_stats() {
+    static const TraceUnitStats stats = TraceUnitStats();
+    return stats;
+  }
+
+  WorldUnit m_unit;
+};
+
+class AsteroidStrike {
+ public:
+  AsteroidStrike() = default;
+
+  AsteroidStrike(const MapLocation &location, unsigned int karbonite) : m_location(location), m_karbonite(karbonite) {}
+
+  MapLocation get_map_location() const { return m_location; }
+
+  unsigned int get_karbonite() const { return m_karbonite; }
+
+ private:
+  MapLocation m_location;
+  unsigned int m_karbonite = 0;
+};
+
+class AsteroidPattern {
+ public:
+  std::unordered_map<unsigned int, AsteroidStrike> get_all_strikes() const {
+    std::unordered_map<unsigned int, AsteroidStrike> strikes;
+    for (const TraceAsteroid &asteroid : World::current()->asteroids()) {
+      strikes[asteroid.round] = AsteroidStrike(MapLocation(Mars, asteroid.x, asteroid.y), asteroid.karbonite);
+    }
+    return strikes;
+  }
+};
+
+class PlanetMap {
+ public:
+  PlanetMap() = default;
+
+  PlanetMap(World &world, Planet planet) : m_map(&world.map(planet)) {
+    for (const TraceUnit &unit : m_map->initial_units) {
+      WorldUnit initial;
+      initial.state = unit;
+      initial.stats = world.stats(unit.type, unit.level);
+      m_initial_units.push_back(Unit(initial));
+    }
+  }
+
+  Planet get_planet() const { return static_cast<Planet>(m_map->planet); }
+
+  unsigned int get_width() const { return m_map->width; }
+
+  unsigned int get_height() const { return m_map->height; }
+
+  bool is_on_map(const MapLocation &location) const {
+    return location.get_planet() == get_planet() && location.get_x() >= 0 && location.get_y() >= 0 &&
+           location.get_x() < static_cast<int>(m_map->width) && location.get_y() < static_cast<int>(m_map->height);
+  }
+
+  bool is_passable_terrain_at(const MapLocation &location) const {
+    return is_on_map(location) && m_map->passable[location.get_y() * m_map->width + location.get_x()] != 0;
+  }
+
+  unsigned int get_initial_karbonite_at(const MapLocation &location) const {
+    return is_on_map(location) ? m_map->karbonite[location.get_y() * m_map->width + location.get_x()] : 0;
+  }
+
+  std::vector<Unit> get_initial_units() const { return m_initial_units; }
+
+ private:
+  const TraceMap *m_map = nullptr;
+  std::vector<Unit> m_initial_units;
+};
+
+class ResearchInfo {
+ public:
+  explicit ResearchInfo(const uint8_t *levels) {
+    for (int i = 0; i < TraceTurn::num_branches; ++i) {
+      m_levels[i] = levels[i];
+    }
+  }
+
+  unsigned int get_level(UnitType branch) const {
+    const int index = World::researchBranch(branch);
+    return index < 0 ? 0 : m_levels[index];
+  }
+
+ private:
+  unsigned int m_levels[TraceTurn::num_branches] = {};
+};
+
+class GameController {
+ public:
+  GameController() : m_world(*World::current()), m_earth(m_world, Earth), m_mars(m_world, Mars) {}
+
+  void next_turn() { m_world.nextTurn(); }
+
+  unsigned int get_round() const { return m_world.round; }
+
+  Planet get_planet() const { return static_cast<Planet>(m_world.planet()); }
+
+  Team get_team() const { return static_cast<Team>(m_world.team()); }
+
+  unsigned int get_time_left_ms() const { return m_world.time_left_ms; }
+
+  unsigned int get_karbonite() const { return m_world.karbonite[m_world.team()]; }
+
+  const PlanetMap &get_starting_planet(Planet planet) const { return planet == Earth ? m_earth : m_mars; }
+
+  AsteroidPattern get_asteroid_pattern() const { return AsteroidPattern(); }
+
+  ResearchInfo get_research_info() const { return ResearchInfo(m_world.research_levels[m_world.team()]); }
+
+  bool queue_research(UnitType branch) { return m_world.queueResearch(branch); }
+
+  std::vector<int> get_team_array(Planet planet) const {
+    const std::vector<int32_t> &array = m_world.team_arrays[m_world.team()][planet];
+    std::vector<int> values(array.begin(), array.end());
+    values.resize(World::team_array_length);
+    return values;
+  }
+
+  void write_team_array(unsigned int index, int value) { m_world.writeTeamArray(index, value); }
+
+  /*
+   * Sensing
+   */
+
+  bool has_unit(unsigned int id) const { return m_world.canSenseUnit(id); }
+
+  bool can_sense_unit(unsigned int id) const { return m_world.canSenseUnit(id); }
+
+  Unit get_unit(unsigned int id) const {
+    const WorldUnit *unit = m_world.unit(id);
+    return unit == nullptr ? Unit() : Unit(*unit);
+  }
+
+  std::vector<Unit> get_units() const { return units(m_world.visibleUnits()); }
+
+  std::vector<Unit> get_my_units() const { return units(m_world.myUnits()); }
+
+  std::vector<Unit> get_units_in_space() const { return units(m_world.myUnitsInSpace()); }
+
+  bool can_sense_location(const MapLocation &location) const {
+    return m_world.canSense(location.get_planet(), location.get_x(), location.get_y());
+  }
+
+  unsigned int get_karbonite_at(const MapLocation &location) const {
+    return m_world.karboniteAt(location.get_planet(), location.get_x(), location.get_y());
+  }
+
+  bool is_occupiable(const MapLocation &location) const {
+    return m_world.isOccupiable(location.get_planet(), location.get_x(), location.get_y());
+  }
+
+  bool has_unit_at_location(const MapLocation &location) const {
+    return can_sense_location(location) &&
+           m_world.unitAt(location.get_planet(), location.get_x(), location.get_y()) != World::no_unit;
+  }
+
+  Unit sense_unit_at_location(const MapLocation &location) const {
+    return get_unit(m_world.unitAt(location.get_planet(), location.get_x(), location.get_y()));
+  }
+
+  std::vector<Unit> sense_nearby_units(const MapLocation &location, unsigned int radius_squared) const {
+    return units(m_world.nearbyUnits(location.get_planet(), location.get_x(), location.get_y(), radius_squared, -1,
+                                     -1));
+  }
+
+  std::vector<Unit> sense_nearby_units_by_team(const MapLocation &location, unsigned int radius_squared,
+                                               Team team) const {
+    return units(m_world.nearbyUnits(location.get_planet(), location.get_x(), location.get_y(), radius_squared, team,
+                                     -1));
+  }
+
+  std::vector<Unit> sense_nearby_units_by_type(const MapLocation &location, unsigned int radius_squared,
+                                               UnitType type) const {
+    return units(m_world.nearbyUnits(location.get_planet(), location.get_x(), location.get_y(), radius_squared, -1,
+                                     type));
+  }
+
+  /*
+   * Actions
+   */
+
+  bool can_move(unsigned int id, Direction direction) const { return m_world.canMove(id, direction); }
+
+  bool is_move_ready(unsigned int id) const { return m_world.isMoveReady(id); }
+
+  void move_robot(unsigned int id, Direction direction) { m_world.moveRobot(id, direction); }
+
+  bool can_attack(unsigned int id, unsigned int target_id) const { return m_world.canAttack(id, target_id); }
+
+  bool is_attack_ready(unsigned int id) const { return m_world.isAttackReady(id); }
+
+  void attack(unsigned int id, unsigned int target_id) { m_world.attack(id, target_id); }
+
+  bool can_harvest(unsigned int id, Direction direction) const { return m_world.canHarvest(id, direction); }
+
+  void harvest(unsigned int id, Direction direction) { m_world.harvest(id, direction); }
+
+  bool can_blueprint(unsigned int id, UnitType type, Direction direction) const {
+    return m_world.canBlueprint(id, type, direction);
+  }
+
+  void blueprint(unsigned int id, UnitType type, Direction direction) { m_world.blueprint(id, type, direction); }
+
+  bool can_build(unsigned int id, unsigned int blueprint_id) const { return m_world.canBuild(id, blueprint_id); }
+
+  void build(unsigned int id, unsigned int blueprint_id) { m_world.build(id, blueprint_id); }
+
+  bool can_repair(unsigned int id, unsigned int structure_id) const { return m_world.canRepair(id, structure_id); }
+
+  void repair(unsigned int id, unsigned int structure_id) { m_world.repair(id, structure_id); }
+
+  bool can_replicate(unsigned int id, Direction direction) const { return m_world.canReplicate(id, direction); }
+
+  void replicate(unsigned int id, Direction direction) { m_world.replicate(id, direction); }
+
+  bool can_javelin(unsigned int id, unsigned int target_id) const { return m_world.canJavelin(id, target_id); }
+
+  bool is_javelin_ready(unsigned int id) const { return m_world.isJavelinReady(id); }
+
+  void javelin(unsigned int id, unsigned int target_id) { m_world.javelin(id, target_id); }
+
+  bool can_begin_snipe(unsigned int id, const MapLocation &location) const {
+    return m_world.canBeginSnipe(id, location.get_planet(), location.get_x(), location.get_y());
+  }
+
+  bool is_begin_snipe_ready(unsigned int id) const { return m_world.isBeginSnipeReady(id); }
+
+  void begin_snipe(unsigned int id, const MapLocation &location) {
+    m_world.beginSnipe(id, location.get_planet(), location.get_x(), location.get_y());
+  }
+
+  bool can_blink(unsigned int id, const MapLocation &location) const {
+    return m_world.canBlink(id, location.get_planet(), location.get_x(), location.get_y());
+  }
+
+  bool is_blink_ready(unsigned int id) const { return m_world.isBlinkReady(id); }
+
+  void blink(unsigned int id, const MapLocation &location) {
+    m_world.blink(id, location.get_planet(), location.get_x(), location.get_y());
+  }
+
+  bool can_heal(unsigned int id, unsigned int target_id) const { return m_world.canHeal(id, target_id); }
+
+  bool is_heal_ready(unsigned int id) const { return m_world.isHealReady(id); }
+
+  void heal(unsigned int id, unsigned int target_id) { m_world.heal(id, target_id); }
+
+  bool can_overcharge(unsigned int id, unsigned int target_id) const { return m_world.canOvercharge(id, target_id); }
+
+  bool is_overcharge_ready(unsigned int id) const { return m_world.isOverchargeReady(id); }
+
+  void overcharge(unsigned int id, unsigned int target_id) { m_world.overcharge(id, target_id); }
+
+  bool can_load(unsigned int structure_id, unsigned int robot_id) const {
+    return m_world.canLoad(structure_id, robot_id);
+  }
+
+  void load(unsigned int structure_id, unsigned int robot_id) { m_world.load(structure_id, robot_id); }
+
+  bool can_unload(unsigned int structure_id, Direction direction) const {
+    return m_world.canUnload(structure_id, direction);
+  }
+
+  void unload(unsigned int structure_id, Direction direction) { m_world.unload(structure_id, direction); }
+
+  bool can_produce_robot(unsigned int factory_id, UnitType type) const {
+    return m_world.canProduceRobot(factory_id, type);
+  }
+
+  void produce_robot(unsigned int factory_id, UnitType type) { m_world.produceRobot(factory_id, type); }
+
+  bool can_launch_rocket(unsigned int rocket_id, const MapLocation &destination) const {
+    return m_world.canLaunchRocket(rocket_id, destination.get_planet(), destination.get_x(), destination.get_y());
+  }
+
+  void launch_rocket(unsigned int rocket_id, const MapLocation &destination) {
+    m_world.launchRocket(rocket_id, destination.get_planet(), destination.get_x(), destination.get_y());
+  }
+
+ private:
+  static std::vector<Unit> units(const std::vector<const WorldUnit *> &world_units) {
+    std::vector<Unit> units;
+    units.reserve(world_units.size());
+    for (const WorldUnit *unit : world_units) {
+      units.push_back(Unit(*unit));
+    }
+    return units;
+  }
+
+  World &m_world;
+  PlanetMap m_earth;
+  PlanetMap m_mars;
+};
+
+}
+
+#endif //RANGERBOT_TOOLS_BC_HPP
@@ -0,0 +1,204 @@
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../../Profiler.h"
+#include "../offline/Stats.h"
+#include "../offline/World.h"
+
+/*
+ * Replays a game recorded with record=1 in run.sh (see TurnRecorder.h). The bot runs against the stand-in api in
+ * ../offline, and before each of its turns the world is loaded with what it saw in that turn of the real game, so it
+ * makes the same decisions, whatever it did the turn before. Build with tools/build.sh replay.
+ *
+ *   replay trace-earth.bin              times every turn, one CSV line per round, and writes the profiler report
+ *   replay trace-earth.bin 312 1000     runs up to round 312, then runs that turn 1000 times and times them
+ *
+ * Repeats each run in a fork, so they all start from the bot's exact state going into the turn. They're
+ * deterministic, except for work that's cut off by wall clock time, like the micro search.
+ */
+
+int bot_main(int argc, char **argv);
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+class ReplayDriver : public TurnDriver {
+ public:
+  ReplayDriver(TraceReader &reader, unsigned int target_round, unsigned int repeats)
+      : m_reader(reader), m_target_round(target_round), m_repeats(repeats) {}
+
+  bool start(World &world) {
+    TraceHeader header;
+    if (!m_reader.readHeader(header)) {
+      return false;
+    }
+    world.setMap(header.maps[World::Earth]);
+    world.setMap(header.maps[World::Mars]);
+    world.setAsteroids(header.asteroids);
+    world.setPerspective(header.team, header.planet);
+    for (const TraceUnitStats &stats : header.stats) {
+      world.addStats(stats);
+    }
+    // the first turn replaces these, but units the bot creates get ids after them, like in the game
+    for (const TraceMap &map : header.maps) {
+      for (const TraceUnit &unit : map.initial_units) {
+        world.addUnit(unit);
+      }
+    }
+    world.setDriver(this);
+    beginTurn(world);
+    return true;
+  }
+
+  void nextTurn(World &world) override {
+    const double ms = std::chrono::duration<double, std::milli>(Clock::now() - m_turn_start).count();
+    if (m_result_fd >= 0) {
+      // a repeat, and it's done
+      const ssize_t written = write(m_result_fd, &ms, sizeof(ms));
+      _exit(written == sizeof(ms) ? 0 : 1);
+    }
+    if (m_target_round == 0) {
+      printf("%u,%.3f\n", world.round, ms);
+      m_times.push_back(ms);
+      if (ms > m_slowest_ms) {
+        m_slowest_ms = ms;
+        m_slowest_round = world.round;
+      }
+    }
+    beginTurn(world);
+  }
+
+ private:
+  void beginTurn(World &world) {
+    TraceTurn turn;
+    if (!m_reader.readTurn(turn)) {
+      finish();
+    }
+    load(world, turn);
+    if (turn.round == m_target_round) {
+      repeat(world);
+    }
+    m_turn_start = Clock::now();
+  }
+
+  void load(World &world, const TraceTurn &turn) {
+    const uint8_t team = world.team();
+    const uint8_t planet = world.planet();
+    world.round = turn.round;
+    world.time_left_ms = turn.time_left_ms;
+    world.karbonite[team] = turn.karbonite;
+    std::copy(turn.research_levels, turn.research_levels + TraceTurn::num_branches, world.research_levels[team]);
+    world.team_arrays[team][World::Earth] = turn.team_arrays[World::Earth];
+    world.team_arrays[team][World::Mars] = turn.team_arrays[World::Mars];
+    for (const TraceUnitStats &stats : turn.stats) {
+      world.addStats(stats);
+    }
+    // whatever the bot did last turn is replaced by what really happened
+    world.clearUnits();
+    for (TraceUnit unit : turn.units) {
+      if (unit.location == TraceUnit::InGarrison) {
+        // traces only say which structure it's in, and that's on the planet the trace is from
+        unit.planet = planet;
+      }
+      world.addUnit(unit);
+    }
+    const uint32_t width = world.map(planet).width;
+    for (const TraceKarbonite &change : turn.karbonite_changes) {
+      world.setKarboniteAt(planet, change.index % width, change.index / width, change.karbonite);
+    }
+  }
+
+  /*
+   * Runs the turn that's about to start in m_repeats forks, one after the other so they don't compete for the cpu,
+   * then reports and exits. Returns in the forks, which run the turn and exit from nextTurn().
+   */
+  void repeat(World &world) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+      perror("pipe");
+      exit(1);
+    }
+    fflush(stdout);
+    fflush(stderr);
+    std::vector<double> times;
+    for (unsigned int i = 0; i < m_repeats; ++i) {
+      const pid_t pid = fork();
+      if (pid < 0) {
+        perror("fork");
+        break;
+      }
+      if (pid == 0) {
+        close(fds[0]);
+        m_result_fd = fds[1];
+        return;
+      }
+      double ms = 0;
+      const bool finished = read(fds[0], &ms, sizeof(ms)) == sizeof(ms);
+      int status = 0;
+      waitpid(pid, &status, 0);
+      if (!finished) {
+        fprintf(stderr, "round %u didn't finish, status %d\n", world.round, status);
+        exit(1);
+      }
+      times.push_back(ms);
+    }
+    printf("round %u, %zu runs: min %.3fms p50 %.3fms p99 %.3fms max %.3fms\n", world.round, times.size(),
+           percentile(times, 0), percentile(times, 0.5), percentile(times, 0.99), percentile(times, 1));
+    exit(0);
+  }
+
+  void finish() {
+    if (m_target_round != 0) {
+      fprintf(stderr, "round %u isn't in the trace\n", m_target_round);
+      exit(1);
+    }
+    fprintf(stderr, "%zu turns: p50 %.3fms p99 %.3fms, slowest %.3fms in round %u\n", m_times.size(),
+            percentile(m_times, 0.5), percentile(m_times, 0.99), m_slowest_ms, m_slowest_round);
+    profiler_write_report();
+    exit(0);
+  }
+
+  TraceReader &m_reader;
+  const unsigned int m_target_round;
+  const unsigned int m_repeats;
+  Clock::time_point m_turn_start;
+  std::vector<double> m_times;
+  double m_slowest_ms = 0;
+  unsigned int m_slowest_round = 0;
+  // where a repeat reports its time, -1 outside of them
+  int m_result_fd = -1;
+};
+
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <trace> [<round> [<repeats>]]\n", argv[0]);
+    return 1;
+  }
+  TraceReader reader;
+  if (!reader.open(argv[1])) {
+    fprintf(stderr, "%s isn't a trace\n", argv[1]);
+    return 1;
+  }
+  const unsigned int target_round = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 0;
+  const unsigned int repeats = argc > 3 ? static_cast<unsigned int>(atoi(argv[3])) : 100;
+
+  World world;
+  World::setCurrent(&world);
+  ReplayDriver driver(reader, target_round, repeats);
+  if (!driver.start(world)) {
+    fprintf(stderr, "%s has no header\n", argv[1]);
+    return 1;
+  }
+  // never returns, the driver exits when the trace runs out
+  return bot_main(argc, argv);
+}
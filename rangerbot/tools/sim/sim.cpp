@@ -0,0 +1,254 @@
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../../AllocationTracker.h"
+#include "../../Profiler.h"
+#include "../offline/MapLoader.h"
+#include "../offline/Stats.h"
+#include "../offline/World.h"
+
+/*
+ * Plays the bot against itself on a map from battlecode-maps/, without the engine or the manager. Each of the four
+ * players (red and blue, on earth and mars) is a copy of the bot on its own thread, but only one runs at a time: the
+ * main thread hands out turns in the engine's order, and applies the rules between rounds (World::endRound()). Build
+ * with tools/build.sh sim.
+ *
+ *   sim battlecode-maps/BigWall.bc18map          plays a whole game, then reports who won and how fast it went
+ *   sim battlecode-maps/BigWall.bc18map 200      stops after round 200
+ *
+ * The players share the bot's globals, like the turn arena and the profiler. That works because turns never overlap
+ * and nothing turn scoped outlives next_turn(). For the same reason the bots are started with --shared-outputs, so
+ * they don't each open the profiler report, the allocation report, the log and the trace on top of each other.
+ * Instead the sim writes one profile-sim.csv (and allocations-sim.csv) adding up all four. The log goes to stdout and
+ * nothing is recorded.
+ *
+ * Like the engine, each player starts with 10s of time and gets 50ms more every turn, and what's written to a team
+ * array shows up on the other planet 50 rounds later. A game is over once a team has no units left, or after the last
+ * round, when the team with more units wins.
+ */
+
+int bot_main(int argc, char **argv);
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// in turn order
+const int num_players = 4;
+const uint8_t player_teams[num_players] = {0, 1, 0, 1};
+const uint8_t player_planets[num_players] = {World::Earth, World::Earth, World::Mars, World::Mars};
+const char *const player_names[num_players] = {"red earth", "blue earth", "red mars", "blue mars"};
+const char *const team_names[2] = {"red", "blue"};
+
+const uint32_t starting_karbonite = 100;
+const int64_t starting_time_ms = 10000;
+const int64_t time_per_turn_ms = 50;
+// rounds before what's written to a team array can be read on the other planet
+const uint32_t communication_delay = 50;
+
+class SelfPlayDriver : public TurnDriver {
+ public:
+  SelfPlayDriver(const GameMap &map, char *program) : m_map(map), m_bot_argv{program, shared_outputs_flag, nullptr} {
+    for (auto &team_history : m_team_array_history) {
+      for (std::vector<std::vector<int32_t>> &history : team_history) {
+        history.emplace_back();
+      }
+    }
+  }
+
+  void setUp(World &world) {
+    world.setMap(m_map.maps[World::Earth]);
+    world.setMap(m_map.maps[World::Mars]);
+    world.setAsteroids(m_map.asteroids);
+    for (const TraceMap &map : m_map.maps) {
+      for (const TraceUnit &unit : map.initial_units) {
+        world.addUnit(unit);
+      }
+    }
+    world.karbonite[0] = starting_karbonite;
+    world.karbonite[1] = starting_karbonite;
+    world.setDriver(this);
+  }
+
+  // never returns
+  void play(World &world, uint32_t last_round) {
+    m_start = Clock::now();
+    while (true) {
+      world.flight_rounds = m_map.flightRounds(world.round);
+      for (int player = 0; player < num_players; ++player) {
+        runTurn(world, player);
+      }
+      if (world.round >= last_round) {
+        finish(world, leader(world), world.round);
+      }
+      world.endRound();
+      checkForSurvivor(world, world.round - 1);
+    }
+  }
+
+  // on the player's thread, returns when it's their turn again
+  void nextTurn(World &) override {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const int player = m_running;
+    m_running = scheduler;
+    m_wake[scheduler].notify_one();
+    m_wake[player].wait(lock, [this, player] { return m_running == player; });
+  }
+
+ private:
+  static const int scheduler = num_players;
+  static char shared_outputs_flag[];
+  static const int no_winner = -1;
+
+  void runTurn(World &world, int player) {
+    const uint8_t team = player_teams[player];
+    const uint8_t planet = player_planets[player];
+    world.setPerspective(team, planet);
+    world.time_left_ms = static_cast<uint32_t>(m_time_left_ms[player]);
+    showTeamArrays(world, team, planet);
+
+    const Clock::time_point start = Clock::now();
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_running = player;
+      if (m_started[player]) {
+        m_wake[player].notify_one();
+      } else {
+        // the bot's main() runs until its first next_turn()
+        m_started[player] = true;
+        std::thread(bot_main, 2, m_bot_argv).detach();
+      }
+      m_wake[scheduler].wait(lock, [this] { return m_running == scheduler; });
+    }
+    const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    m_times[player].push_back(ms);
+
+    m_time_left_ms[player] -= static_cast<int64_t>(ms);
+    if (m_time_left_ms[player] < 0) {
+      ++m_overruns[player];
+      m_time_left_ms[player] = 0;
+    }
+    m_time_left_ms[player] += time_per_turn_ms;
+    m_team_array_history[team][planet].push_back(world.team_arrays[team][planet]);
+  }
+
+  /*
+   * A player sees its own planet's team array as it left it, and the other planet's as it was communication_delay
+   * rounds ago.
+   */
+  void showTeamArrays(World &world, uint8_t team, uint8_t planet) {
+    world.team_arrays[team][planet] = m_team_array_history[team][planet].back();
+    const std::vector<std::vector<int32_t>> &sent = m_team_array_history[team][1 - planet];
+    const uint32_t sent_round = world.round > communication_delay ? world.round - communication_delay : 0;
+    world.team_arrays[team][1 - planet] = sent_round < sent.size() ? sent[sent_round] : std::vector<int32_t>();
+  }
+
+  // ends the game if a team is out of units
+  void checkForSurvivor(const World &world, uint32_t round) {
+    bool has_units[2] = {false, false};
+    for (const auto &entry : world.allUnits()) {
+      has_units[entry.second.state.team] = true;
+    }
+    if (!has_units[0] || !has_units[1]) {
+      finish(world, has_units[0] ? 0 : has_units[1] ? 1 : no_winner, round);
+    }
+  }
+
+  // the team with more units, then more karbonite
+  static int leader(const World &world) {
+    size_t units[2] = {0, 0};
+    for (const auto &entry : world.allUnits()) {
+      ++units[entry.second.state.team];
+    }
+    if (units[0] != units[1]) {
+      return units[0] > units[1] ? 0 : 1;
+    }
+    if (world.karbonite[0] != world.karbonite[1]) {
+      return world.karbonite[0] > world.karbonite[1] ? 0 : 1;
+    }
+    return no_winner;
+  }
+
+  void finish(const World &world, int winner, uint32_t round) {
+    const double seconds = std::chrono::duration<double>(Clock::now() - m_start).count();
+    size_t turns = 0;
+    for (const std::vector<double> &times : m_times) {
+      turns += times.size();
+    }
+    if (winner == no_winner) {
+      printf("draw after round %u", round);
+    } else {
+      printf("%s won after round %u", team_names[winner], round);
+    }
+    printf(", %zu turns in %.2fs, %.0f turns/s\n", turns, seconds, seconds > 0 ? turns / seconds : 0.0);
+    size_t units[2][World::Rocket + 1] = {};
+    for (const auto &entry : world.allUnits()) {
+      ++units[entry.second.state.team][entry.second.state.type];
+    }
+    for (uint8_t team = 0; team < 2; ++team) {
+      fprintf(stderr, "%-10s %zu workers, %zu knights, %zu rangers, %zu mages, %zu healers, %zu factories, "
+              "%zu rockets, %u karbonite\n", team_names[team], units[team][World::Worker], units[team][World::Knight],
+              units[team][World::Ranger], units[team][World::Mage], units[team][World::Healer],
+              units[team][World::Factory], units[team][World::Rocket], world.karbonite[team]);
+    }
+    for (int player = 0; player < num_players; ++player) {
+      fprintf(stderr, "%-10s p50 %.3fms p99 %.3fms max %.3fms, out of time %u times\n", player_names[player],
+              percentile(m_times[player], 0.5), percentile(m_times[player], 0.99),
+              percentile(m_times[player], 1), m_overruns[player]);
+    }
+    profiler_write_report();
+    allocation_write_report();
+    fflush(stdout);
+    // the players are parked in next_turn() for good
+    exit(0);
+  }
+
+  const GameMap &m_map;
+  // what every player's main() gets
+  char *m_bot_argv[3];
+
+  std::mutex m_mutex;
+  // one per player, and one for the main thread
+  std::condition_variable m_wake[num_players + 1];
+  int m_running = scheduler;
+  bool m_started[num_players] = {};
+
+  Clock::time_point m_start;
+  std::vector<double> m_times[num_players];
+  int64_t m_time_left_ms[num_players] = {starting_time_ms, starting_time_ms, starting_time_ms, starting_time_ms};
+  unsigned int m_overruns[num_players] = {};
+  // [team][planet][round], each team array as it was at the end of the round, starting from an empty one
+  std::vector<std::vector<int32_t>> m_team_array_history[2][2];
+};
+
+char SelfPlayDriver::shared_outputs_flag[] = "--shared-outputs";
+
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <map> [<last round>]\n", argv[0]);
+    return 1;
+  }
+  GameMap map;
+  if (!load_map(argv[1], map)) {
+    return 1;
+  }
+  const uint32_t last_round = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : World::last_round;
+
+  profiler_open_report("profile-sim.csv");
+  allocation_open_report("allocations-sim.csv");
+
+  World world;
+  World::setCurrent(&world);
+  SelfPlayDriver driver(map, argv[0]);
+  driver.setUp(world);
+  driver.play(world, last_round);
+  return 0;
+}